@@ -0,0 +1,98 @@
+/*
+ * A2DP Packet Arrival Trace Recorder Implementation
+ *
+ * Date: 2026-10-16
+ */
+
+#include "a2dp_trace.h"
+
+#ifdef A2DP_TRACE_CAPTURE
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "A2DP_TRACE";
+
+#define DUMP_TASK_STACK_SIZE    3072
+#define DUMP_TASK_PRIORITY      1       /* Below everything audio related */
+
+/* Trace is flushed in small bursts so the console UART keeps up */
+#define DUMP_LINES_PER_BURST    16
+#define DUMP_BURST_DELAY_MS     20
+
+typedef enum {
+    TRACE_IDLE = 0,
+    TRACE_RECORDING,
+    TRACE_DUMPING,
+} trace_state_t;
+
+typedef struct {
+    uint32_t arrival_us;            /* Relative to the first packet */
+    uint32_t len;
+} trace_entry_t;
+
+static trace_entry_t s_entries[A2DP_TRACE_ENTRIES];
+static uint32_t s_count;
+static int64_t s_first_us;
+static uint32_t s_sample_rate;
+static _Atomic int s_state = TRACE_IDLE;
+
+static void trace_dump_task(void *arg)
+{
+    /* printf rather than ESP_LOG: one bare CSV line per packet */
+    printf("A2DPTRACE,BEGIN,%lu,%lu\n", (unsigned long)s_sample_rate, (unsigned long)s_count);
+    for (uint32_t i = 0; i < s_count; i++) {
+        printf("A2DPTRACE,%lu,%lu,%lu\n", (unsigned long)i,
+               (unsigned long)s_entries[i].arrival_us, (unsigned long)s_entries[i].len);
+        if ((i + 1) % DUMP_LINES_PER_BURST == 0) {
+            vTaskDelay(pdMS_TO_TICKS(DUMP_BURST_DELAY_MS));
+        }
+    }
+    printf("A2DPTRACE,END\n");
+
+    atomic_store(&s_state, TRACE_IDLE);
+    vTaskDelete(NULL);
+}
+
+/*
+ * Public API Implementation
+ */
+
+void a2dp_trace_arm(uint32_t sample_rate)
+{
+    if (atomic_load(&s_state) == TRACE_DUMPING) {
+        return;
+    }
+    s_sample_rate = sample_rate;
+    s_count = 0;
+    atomic_store(&s_state, TRACE_RECORDING);
+    ESP_LOGI(TAG, "Capturing %d packet arrivals @ %lu Hz", A2DP_TRACE_ENTRIES,
+             (unsigned long)sample_rate);
+}
+
+void a2dp_trace_record(int64_t now_us, uint32_t len)
+{
+    if (atomic_load_explicit(&s_state, memory_order_relaxed) != TRACE_RECORDING) {
+        return;
+    }
+
+    if (s_count == 0) {
+        s_first_us = now_us;
+    }
+    s_entries[s_count].arrival_us = (uint32_t)(now_us - s_first_us);
+    s_entries[s_count].len = len;
+
+    if (++s_count == A2DP_TRACE_ENTRIES) {
+        atomic_store(&s_state, TRACE_DUMPING);
+        if (xTaskCreate(trace_dump_task, "a2dp_trace", DUMP_TASK_STACK_SIZE, NULL,
+                        DUMP_TASK_PRIORITY, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create dump task");
+            atomic_store(&s_state, TRACE_IDLE);
+        }
+    }
+}
+
+#endif /* A2DP_TRACE_CAPTURE */
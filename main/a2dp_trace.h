@@ -0,0 +1,67 @@
+/*
+ * A2DP Packet Arrival Trace Recorder
+ * Captures (timestamp, size) per A2DP packet for offline buffer tuning
+ *
+ * Records the arrival time and length of the first A2DP_TRACE_ENTRIES
+ * packets after a stream (re)starts, then prints them on the console from
+ * a low-priority task, one CSV line per packet:
+ *
+ *   A2DPTRACE,BEGIN,<sample_rate>,<count>
+ *   A2DPTRACE,<index>,<arrival_us>,<len_bytes>
+ *   A2DPTRACE,END
+ *
+ * arrival_us is relative to the first packet. Traces can be grepped out
+ * of a monitor log and replayed against the buffering code off-target.
+ *
+ * Compiled in only when A2DP_TRACE_CAPTURE is defined (audio_pipeline.h);
+ * otherwise the calls are empty inlines.
+ *
+ * Threading: a2dp_trace_record() is called from the BTC task only.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef A2DP_TRACE_H
+#define A2DP_TRACE_H
+
+#include <stdint.h>
+#include "audio_pipeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Packets captured per trace (8 bytes each) */
+#define A2DP_TRACE_ENTRIES      1024
+
+#ifdef A2DP_TRACE_CAPTURE
+
+/*
+ * Arm a new capture (stream start or sample rate change)
+ * Ignored while a previous trace is still being printed.
+ *
+ * @param sample_rate Stream sample rate in Hz (written to the header)
+ */
+void a2dp_trace_arm(uint32_t sample_rate);
+
+/*
+ * Record one packet arrival (BTC task)
+ * Starts the dump task once the trace is full.
+ *
+ * @param now_us Arrival timestamp (esp_timer_get_time())
+ * @param len Packet length in bytes
+ */
+void a2dp_trace_record(int64_t now_us, uint32_t len);
+
+#else
+
+static inline void a2dp_trace_arm(uint32_t sample_rate) { (void)sample_rate; }
+static inline void a2dp_trace_record(int64_t now_us, uint32_t len) { (void)now_us; (void)len; }
+
+#endif /* A2DP_TRACE_CAPTURE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* A2DP_TRACE_H */
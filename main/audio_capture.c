@@ -0,0 +1,321 @@
+/*
+ * Output PCM Capture Tap Implementation
+ *
+ * The PCM buffer is sized in frames at arm time and cut into slots of the
+ * first recorded block's size, used as a circular buffer; the capture
+ * length is counted in those blocks, so a 240-frame profile records as
+ * long as a 480-frame one. The dump task is created at
+ * arm time and sleeps until the writer hands the capture over, so the
+ * writer never allocates or prints.
+ *
+ * Dump lines are written with stdout locked, so log output from other
+ * tasks cannot land in the middle of one.
+ *
+ * Date: 2026-10-16
+ */
+
+#include "audio_capture.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "AUDIO_CAPTURE";
+
+#define DUMP_TASK_STACK_SIZE    3072
+#define DUMP_TASK_PRIORITY      1       /* Below everything audio related */
+
+/* Pause between dump lines so the console UART keeps up */
+#define DUMP_LINE_DELAY_MS      5
+
+/* Slots are sized for the highest output rate */
+#define CAPTURE_MAX_RATE        48000
+
+#define MAX_SLOT_BYTES          (AUDIO_CAPTURE_SLOT_FRAMES * AUDIO_CAPTURE_FRAME_BYTES)
+
+typedef enum {
+    CAP_IDLE = 0,
+    CAP_RECORDING,                  /* Writer stores blocks */
+    CAP_CANCEL,                     /* Cancel requested; writer hands over */
+    CAP_DUMPING,                    /* Dump task owns the buffers */
+} capture_state_t;
+
+/* Per-block metadata */
+typedef struct {
+    uint32_t t_us;                  /* esp_timer, low 32 bits */
+    uint32_t ring_fill;
+    uint16_t frames;
+    uint8_t state;
+    uint8_t flags;
+} capture_meta_t;
+
+/* Capture state: set up by audio_capture_arm(), then owned by the writer
+ * while recording and by the dump task while dumping */
+typedef struct {
+    uint8_t *pcm;
+    capture_meta_t *meta;
+    uint32_t buf_frames;            /* PCM buffer size in frames */
+    uint32_t max_blocks;            /* Metadata entries */
+    uint32_t slot_frames;           /* Block size, set by the first block */
+    uint32_t slots;                 /* buf_frames / slot_frames, capped to max_blocks */
+    uint8_t seconds;
+    audio_capture_trigger_t trigger;
+    uint32_t sample_rate;
+    uint32_t count;                 /* Blocks recorded (may exceed slots) */
+    uint32_t stop_at;               /* Count at which recording ends */
+    int32_t trigger_at;             /* Count index of the trigger, -1 = none */
+    bool cancelled;
+    TaskHandle_t dump_task;
+} capture_t;
+
+static capture_t s_cap;
+static _Atomic int s_state = CAP_IDLE;
+
+static void capture_free(void)
+{
+    heap_caps_free(s_cap.pcm);
+    heap_caps_free(s_cap.meta);
+    s_cap.pcm = NULL;
+    s_cap.meta = NULL;
+}
+
+/*
+ * Size the slots from the first block and set the stop point (writer task)
+ */
+static void capture_start(size_t frames, uint32_t sample_rate)
+{
+    s_cap.sample_rate = sample_rate;
+    s_cap.slot_frames = (uint32_t)frames;
+    s_cap.slots = s_cap.buf_frames / s_cap.slot_frames;
+    if (s_cap.slots > s_cap.max_blocks) {
+        s_cap.slots = s_cap.max_blocks;
+    }
+    if (s_cap.trigger == AUDIO_CAPTURE_NOW) {
+        uint32_t blocks = ((uint32_t)s_cap.seconds * sample_rate + s_cap.slot_frames - 1) /
+                          s_cap.slot_frames;
+        s_cap.stop_at = (blocks < s_cap.slots) ? blocks : s_cap.slots;
+    }
+}
+
+/*
+ * Hand the capture to the dump task (writer task)
+ */
+static void capture_finish(bool cancelled)
+{
+    s_cap.cancelled = cancelled;
+    atomic_store_explicit(&s_state, CAP_DUMPING, memory_order_release);
+    xTaskNotifyGive(s_cap.dump_task);
+}
+
+/*
+ * Print bytes as base64 (stdout locked by the caller)
+ */
+static void print_base64(const uint8_t *data, size_t len)
+{
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char out[128];
+    size_t n = 0;
+
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < len) {
+            v |= (uint32_t)data[i + 1] << 8;
+        }
+        if (i + 2 < len) {
+            v |= data[i + 2];
+        }
+        out[n++] = alphabet[(v >> 18) & 0x3F];
+        out[n++] = alphabet[(v >> 12) & 0x3F];
+        out[n++] = (i + 1 < len) ? alphabet[(v >> 6) & 0x3F] : '=';
+        out[n++] = (i + 2 < len) ? alphabet[v & 0x3F] : '=';
+        if (n == sizeof(out)) {
+            fwrite(out, 1, n, stdout);
+            n = 0;
+        }
+    }
+    fwrite(out, 1, n, stdout);
+}
+
+static void capture_dump_task(void *arg)
+{
+    (void)arg;
+
+    /* Wait for the writer to finish (or cancel) the capture */
+    while (atomic_load_explicit(&s_state, memory_order_acquire) != CAP_DUMPING) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+
+    if (s_cap.cancelled) {
+        ESP_LOGI(TAG, "Capture cancelled");
+    } else {
+        uint32_t blocks = (s_cap.count < s_cap.slots) ? s_cap.count : s_cap.slots;
+        uint32_t first = s_cap.count - blocks;
+        int32_t trigger = (s_cap.trigger_at >= (int32_t)first) ?
+                          s_cap.trigger_at - (int32_t)first : -1;
+        uint32_t t0 = blocks ? s_cap.meta[first % s_cap.slots].t_us : 0;
+
+        ESP_LOGI(TAG, "Dumping %lu blocks", (unsigned long)blocks);
+
+        /* printf rather than ESP_LOG: bare lines for a host script to grep */
+        printf("PCMCAP,BEGIN,%lu,%d,%lu,%ld\n", (unsigned long)s_cap.sample_rate,
+               AUDIO_CAPTURE_FRAME_BYTES * 4, (unsigned long)blocks, (long)trigger);
+        for (uint32_t i = 0; i < blocks; i++) {
+            uint32_t slot = (first + i) % s_cap.slots;
+            const capture_meta_t *m = &s_cap.meta[slot];
+            const uint8_t *pcm = &s_cap.pcm[(size_t)slot * s_cap.slot_frames *
+                                            AUDIO_CAPTURE_FRAME_BYTES];
+            size_t len = (size_t)m->frames * AUDIO_CAPTURE_FRAME_BYTES;
+
+            flockfile(stdout);
+            printf("PCMCAP,%lu,%lu,%lu,%u,%u,%u,", (unsigned long)i,
+                   (unsigned long)(m->t_us - t0), (unsigned long)m->ring_fill,
+                   (unsigned)m->frames, (unsigned)m->state, (unsigned)m->flags);
+            print_base64(pcm, len);
+            printf(",%08lX\n", (unsigned long)esp_rom_crc32_le(0, pcm, len));
+            funlockfile(stdout);
+
+            vTaskDelay(pdMS_TO_TICKS(DUMP_LINE_DELAY_MS));
+        }
+        printf("PCMCAP,END\n");
+    }
+
+    capture_free();
+    s_cap.dump_task = NULL;
+    atomic_store_explicit(&s_state, CAP_IDLE, memory_order_release);
+    vTaskDelete(NULL);
+}
+
+/*
+ * Public API Implementation
+ */
+
+esp_err_t audio_capture_arm(uint8_t seconds, audio_capture_trigger_t trigger)
+{
+    if (seconds == 0) {
+        int expected = CAP_RECORDING;
+        if (atomic_compare_exchange_strong(&s_state, &expected, CAP_CANCEL)) {
+            return ESP_OK;
+        }
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (seconds > AUDIO_CAPTURE_MAX_S || trigger >= AUDIO_CAPTURE_TRIGGER_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (atomic_load_explicit(&s_state, memory_order_acquire) != CAP_IDLE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /*
+     * PSRAM takes the full length; internal RAM only a capped amount. Whole
+     * 480-frame units, so every block size divides the buffer; metadata for
+     * the smallest block size.
+     */
+    uint32_t buf_frames = (uint32_t)seconds * CAPTURE_MAX_RATE;
+    uint8_t *pcm = NULL;
+#if CONFIG_SPIRAM
+    pcm = heap_caps_malloc((size_t)buf_frames * AUDIO_CAPTURE_FRAME_BYTES,
+                           MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#endif
+    if (pcm == NULL) {
+        uint32_t max_frames = AUDIO_CAPTURE_INTERNAL_MAX_BYTES / MAX_SLOT_BYTES *
+                              AUDIO_CAPTURE_SLOT_FRAMES;
+        if (buf_frames > max_frames) {
+            ESP_LOGW(TAG, "No PSRAM, capture limited to %lu frames", (unsigned long)max_frames);
+            buf_frames = max_frames;
+        }
+        pcm = heap_caps_malloc((size_t)buf_frames * AUDIO_CAPTURE_FRAME_BYTES,
+                               MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    uint32_t max_blocks = buf_frames / AUDIO_CAPTURE_MIN_BLOCK_FRAMES;
+    capture_meta_t *meta = heap_caps_malloc(max_blocks * sizeof(capture_meta_t),
+                                            MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (pcm == NULL || meta == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate capture buffer (%lu frames)", (unsigned long)buf_frames);
+        heap_caps_free(pcm);
+        heap_caps_free(meta);
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(&s_cap, 0, sizeof(s_cap));
+    s_cap.pcm = pcm;
+    s_cap.meta = meta;
+    s_cap.buf_frames = buf_frames;
+    s_cap.max_blocks = max_blocks;
+    s_cap.seconds = seconds;
+    s_cap.trigger = trigger;
+    s_cap.stop_at = UINT32_MAX;     /* NOW: set by the first block */
+    s_cap.trigger_at = -1;
+
+    if (xTaskCreate(capture_dump_task, "pcm_capture", DUMP_TASK_STACK_SIZE, NULL,
+                    DUMP_TASK_PRIORITY, &s_cap.dump_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create dump task");
+        capture_free();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Capture armed: %lu frames, trigger %s", (unsigned long)buf_frames,
+             (trigger == AUDIO_CAPTURE_NOW) ? "now" : "on underrun");
+    atomic_store_explicit(&s_state, CAP_RECORDING, memory_order_release);
+    return ESP_OK;
+}
+
+bool audio_capture_is_recording(void)
+{
+    int state = atomic_load_explicit(&s_state, memory_order_relaxed);
+    return state == CAP_RECORDING || state == CAP_CANCEL;
+}
+
+void audio_capture_block(const void *block, size_t frames, uint32_t sample_rate,
+                         uint32_t ring_fill, uint8_t state, uint8_t flags)
+{
+    int cap_state = atomic_load_explicit(&s_state, memory_order_acquire);
+    if (cap_state == CAP_CANCEL) {
+        capture_finish(true);
+        return;
+    }
+    if (cap_state != CAP_RECORDING) {
+        return;
+    }
+
+    if (frames > AUDIO_CAPTURE_SLOT_FRAMES) {
+        frames = AUDIO_CAPTURE_SLOT_FRAMES;
+    }
+
+    /* One rate and block size per capture: switching either ends it */
+    if (s_cap.count == 0) {
+        capture_start(frames, sample_rate);
+    } else if (sample_rate != s_cap.sample_rate || frames != s_cap.slot_frames) {
+        capture_finish(false);
+        return;
+    }
+
+    uint32_t slot = s_cap.count % s_cap.slots;
+    memcpy(&s_cap.pcm[(size_t)slot * s_cap.slot_frames * AUDIO_CAPTURE_FRAME_BYTES], block,
+           frames * AUDIO_CAPTURE_FRAME_BYTES);
+    s_cap.meta[slot] = (capture_meta_t) {
+        .t_us = (uint32_t)esp_timer_get_time(),
+        .ring_fill = ring_fill,
+        .frames = (uint16_t)frames,
+        .state = state,
+        .flags = flags,
+    };
+    s_cap.count++;
+
+    /* Underrun trigger: keep half the buffer from before it, fill the rest */
+    if (s_cap.trigger == AUDIO_CAPTURE_ON_UNDERRUN && s_cap.trigger_at < 0 &&
+        (flags & AUDIO_CAPTURE_FLAG_CONCEALED)) {
+        s_cap.trigger_at = (int32_t)(s_cap.count - 1);
+        s_cap.stop_at = s_cap.count + s_cap.slots / 2;
+    }
+
+    if (s_cap.count >= s_cap.stop_at) {
+        capture_finish(false);
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * Output PCM Capture Tap
+ * Records what the writer hands to I2S, then dumps it on the console
+ *
+ * For field reports of crackle: the capture holds the exact output blocks
+ * plus, per block, a timestamp, the ring fill, the writer state and marks
+ * for concealed (underrun) and deliberately faded blocks. Silence between
+ * blocks (pre-buffering, standby) shows up as a gap in the timestamps.
+ * Comparing the marks with the audio tells an A2DP ingress problem (ring
+ * drains, blocks concealed) from one downstream of the bridge (clean
+ * capture, crackle at the speaker).
+ *
+ * Triggers:
+ * - NOW: record the next N seconds.
+ * - ON_UNDERRUN: record continuously into a circular buffer; the first
+ *   concealed block triggers, and recording stops N/2 seconds later, so
+ *   the dump holds the run-up to the fault as well as its aftermath.
+ *
+ * The buffer is allocated when armed (PSRAM if present, else a capped
+ * amount of internal RAM) and freed once dumped. When disarmed the writer
+ * pays one relaxed atomic load per block.
+ *
+ * Dump format (console, one line per block, base64 PCM as sent on the wire):
+ *
+ *   PCMCAP,BEGIN,<sample_rate>,<bits_per_slot>,<blocks>,<trigger_block|-1>
+ *   PCMCAP,<index>,<t_us>,<ring_fill>,<frames>,<state>,<flags>,<base64>,<crc32>
+ *   PCMCAP,END
+ *
+ * Threading: audio_capture_is_recording() and audio_capture_block() belong
+ * to the I2S writer task. audio_capture_arm() may be called from any one
+ * task at a time (the control handler serializes BLE and UART).
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef AUDIO_CAPTURE_H
+#define AUDIO_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "audio_pipeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest capture */
+#define AUDIO_CAPTURE_MAX_S             10
+
+/* Frames per stored block: the writer's largest block (480-frame DMA) */
+#define AUDIO_CAPTURE_SLOT_FRAMES       480
+
+/* Smallest writer block (240-frame DMA, low-latency profile) */
+#define AUDIO_CAPTURE_MIN_BLOCK_FRAMES  240
+
+/* Capture size cap without PSRAM (~0.35 s at 48 kHz, 16-bit) */
+#define AUDIO_CAPTURE_INTERNAL_MAX_BYTES    (64 * 1024)
+
+/* Bytes per captured frame: the I2S slot format */
+#ifdef I2S_32BIT_OUTPUT
+#define AUDIO_CAPTURE_FRAME_BYTES       8
+#else
+#define AUDIO_CAPTURE_FRAME_BYTES       4
+#endif
+
+/* Per-block flags */
+#define AUDIO_CAPTURE_FLAG_CONCEALED    0x01    /* Ring ran dry: block partly synthesized */
+#define AUDIO_CAPTURE_FLAG_FADE         0x02    /* Deliberate fade-out or silence flush */
+#define AUDIO_CAPTURE_FLAG_SIGNAL       0x04    /* Test signal, not A2DP audio */
+
+/*
+ * Capture triggers (BLE/UART command byte 2)
+ */
+typedef enum {
+    AUDIO_CAPTURE_NOW = 0,
+    AUDIO_CAPTURE_ON_UNDERRUN,
+    AUDIO_CAPTURE_TRIGGER_COUNT,
+} audio_capture_trigger_t;
+
+/*
+ * Arm a capture, or cancel the one in progress
+ *
+ * @param seconds Capture length, 1..AUDIO_CAPTURE_MAX_S; 0 cancels
+ * @param trigger When recording stops (see above)
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE while a
+ *         capture is recording or being dumped, ESP_ERR_NO_MEM
+ */
+esp_err_t audio_capture_arm(uint8_t seconds, audio_capture_trigger_t trigger);
+
+/*
+ * Whether the writer must pass its blocks in (writer task)
+ *
+ * @return true while armed or recording
+ */
+bool audio_capture_is_recording(void);
+
+/*
+ * Record one output block (writer task)
+ * Ends the capture early if the output rate or block size changes.
+ *
+ * @param block Output block in I2S slot format
+ * @param frames Block length in frames
+ * @param sample_rate Output sample rate in Hz
+ * @param ring_fill Ring fill in bytes after the block was produced
+ * @param state Writer state (see docs/audio-path.md)
+ * @param flags AUDIO_CAPTURE_FLAG_*
+ */
+void audio_capture_block(const void *block, size_t frames, uint32_t sample_rate,
+                         uint32_t ring_fill, uint8_t state, uint8_t flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_CAPTURE_H */
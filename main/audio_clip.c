@@ -0,0 +1,77 @@
+/*
+ * Clipping Detector Implementation
+ *
+ * The per-sample path is two compares and a counter per sample; the clock
+ * is only read when a run completes.
+ *
+ * Date: 2026-10-16
+ */
+
+#include "audio_clip.h"
+#include <stdatomic.h>
+#include "esp_timer.h"
+
+/* Full-scale run length per channel — owned by the writer task */
+static uint8_t s_run[2];
+
+/* Last clip and last notification time in ms (0 = never); 32-bit so they
+ * stay lock-free */
+static _Atomic uint32_t s_last_clip_ms;
+static uint32_t s_last_notify_ms;
+static _Atomic uint32_t s_events;
+
+static inline uint32_t now_ms(void)
+{
+    /* Never 0, which means "never" above */
+    return (uint32_t)(esp_timer_get_time() / 1000) | 1;
+}
+
+void audio_clip_reset(void)
+{
+    s_run[0] = 0;
+    s_run[1] = 0;
+}
+
+bool audio_clip_scan(const int16_t *pcm, size_t frames)
+{
+    bool clipped = false;
+
+    for (size_t i = 0; i < frames * 2; i++) {
+        int32_t x = pcm[i];
+        uint8_t *run = &s_run[i & 1];
+        if (x >= AUDIO_CLIP_THRESHOLD || x <= -AUDIO_CLIP_THRESHOLD) {
+            if (++*run == AUDIO_CLIP_RUN) {
+                clipped = true;
+                atomic_fetch_add_explicit(&s_events, 1, memory_order_relaxed);
+            }
+            if (*run > AUDIO_CLIP_RUN) {
+                *run = AUDIO_CLIP_RUN;  /* Saturate: one event per run */
+            }
+        } else {
+            *run = 0;
+        }
+    }
+
+    if (!clipped) {
+        return false;
+    }
+
+    uint32_t now = now_ms();
+    atomic_store_explicit(&s_last_clip_ms, now, memory_order_relaxed);
+    if (s_last_notify_ms != 0 && now - s_last_notify_ms < AUDIO_CLIP_HOLD_MS) {
+        return false;
+    }
+    s_last_notify_ms = now;
+    return true;
+}
+
+bool audio_clip_is_active(void)
+{
+    uint32_t last = atomic_load_explicit(&s_last_clip_ms, memory_order_relaxed);
+    return last != 0 && now_ms() - last < AUDIO_CLIP_HOLD_MS;
+}
+
+uint32_t audio_clip_get_events(void)
+{
+    return atomic_load_explicit(&s_events, memory_order_relaxed);
+}
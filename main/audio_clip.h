@@ -0,0 +1,69 @@
+/*
+ * Clipping Detector
+ * Spots sources that arrive already clipped
+ *
+ * Scans the A2DP PCM as the writer consumes it from the ring, before any
+ * resampling or gain, for runs of AUDIO_CLIP_RUN consecutive samples at
+ * full scale on one channel — a single full-scale sample can be legitimate,
+ * a flat run cannot. A detection holds the clip flag for AUDIO_CLIP_HOLD_MS
+ * after the most recent run, after which it decays back to clear.
+ *
+ * Threading: audio_clip_scan() belongs to the I2S writer task. Getters are
+ * lock-free and safe from any task.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef AUDIO_CLIP_H
+#define AUDIO_CLIP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* |sample| at or above this counts as full scale */
+#define AUDIO_CLIP_THRESHOLD    32767
+
+/* Consecutive full-scale samples (per channel) that count as clipping */
+#define AUDIO_CLIP_RUN          3
+
+/* Flag hold time after the last clip; also the notification throttle */
+#define AUDIO_CLIP_HOLD_MS      2000
+
+/*
+ * Reset detector state (new stream)
+ */
+void audio_clip_reset(void);
+
+/*
+ * Scan incoming PCM (writer task)
+ *
+ * @param pcm Interleaved 16-bit stereo samples
+ * @param frames Frame count
+ * @return true if this clip should be notified (first in a hold window)
+ */
+bool audio_clip_scan(const int16_t *pcm, size_t frames);
+
+/*
+ * Check whether the clip flag is currently held
+ *
+ * @return true within AUDIO_CLIP_HOLD_MS of the last clip
+ */
+bool audio_clip_is_active(void);
+
+/*
+ * Get number of clip runs detected
+ *
+ * @return Clip runs since boot
+ */
+uint32_t audio_clip_get_events(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_CLIP_H */
@@ -0,0 +1,139 @@
+/*
+ * Underrun Concealment Implementation
+ *
+ * Fresh frames are copied into a short loop buffer as they pass. Missing
+ * frames replay that loop, oldest first, under a linear Q15 gain ramp.
+ *
+ * Date: 2026-10-16
+ */
+
+#include "audio_conceal.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#define GAIN_ONE            (1 << 15)
+
+/* Loop buffer sized for the highest A2DP rate (48 kHz) */
+#define HIST_MAX_FRAMES     (48 * CONCEAL_HIST_MS)
+
+/* Concealment state — owned by the writer task */
+typedef struct {
+    int32_t gain;                   /* Q15 */
+    int32_t step_out;               /* Gain decrement per synthesized frame */
+    int32_t step_in;                /* Gain increment per fresh frame */
+    uint16_t hist_len;              /* Loop length in frames (rate dependent) */
+    uint16_t hist_pos;              /* Next write slot == oldest frame */
+    uint16_t rep_pos;               /* Replay position while concealing */
+    bool concealing;
+    int16_t hist[HIST_MAX_FRAMES][2];
+} conceal_state_t;
+
+static conceal_state_t s_conceal;
+
+/* Published counters (read from any task) */
+static _Atomic uint32_t s_events;
+static _Atomic uint32_t s_frames;
+
+static inline int16_t apply_gain(int16_t x, int32_t gain)
+{
+    return (int16_t)(((int32_t)x * gain) >> 15);
+}
+
+/* Fill frames [from, to) by replaying the loop under the fade-out ramp */
+static void synthesize(conceal_state_t *c, int16_t *block, size_t from, size_t to)
+{
+    for (size_t i = from; i < to; i++) {
+        if (c->gain > 0) {
+            c->gain -= c->step_out;
+            if (c->gain < 0) {
+                c->gain = 0;
+            }
+        }
+        block[2 * i] = apply_gain(c->hist[c->rep_pos][0], c->gain);
+        block[2 * i + 1] = apply_gain(c->hist[c->rep_pos][1], c->gain);
+        if (++c->rep_pos == c->hist_len) {
+            c->rep_pos = 0;
+        }
+    }
+}
+
+void audio_conceal_reset(uint32_t sample_rate)
+{
+    memset(&s_conceal, 0, sizeof(s_conceal));
+
+    uint32_t hist = sample_rate * CONCEAL_HIST_MS / 1000;
+    s_conceal.hist_len = (uint16_t)((hist > HIST_MAX_FRAMES) ? HIST_MAX_FRAMES :
+                                    (hist == 0) ? 1 : hist);
+
+    uint32_t out_frames = sample_rate * CONCEAL_FADE_OUT_MS / 1000;
+    uint32_t in_frames = sample_rate * CONCEAL_FADE_IN_MS / 1000;
+    s_conceal.step_out = GAIN_ONE / (int32_t)(out_frames ? out_frames : 1);
+    s_conceal.step_in = GAIN_ONE / (int32_t)(in_frames ? in_frames : 1);
+
+    /* Start silent: the first audio after a reset is ramped in */
+    s_conceal.gain = 0;
+    s_conceal.concealing = true;
+}
+
+bool audio_conceal_process(int16_t *block, size_t real_frames, size_t block_frames)
+{
+    conceal_state_t *c = &s_conceal;
+
+    for (size_t i = 0; i < real_frames; i++) {
+        c->hist[c->hist_pos][0] = block[2 * i];
+        c->hist[c->hist_pos][1] = block[2 * i + 1];
+        if (++c->hist_pos == c->hist_len) {
+            c->hist_pos = 0;
+        }
+
+        if (c->gain < GAIN_ONE) {
+            c->gain += c->step_in;
+            if (c->gain > GAIN_ONE) {
+                c->gain = GAIN_ONE;
+            }
+            block[2 * i] = apply_gain(block[2 * i], c->gain);
+            block[2 * i + 1] = apply_gain(block[2 * i + 1], c->gain);
+        }
+    }
+
+    if (real_frames > 0) {
+        c->concealing = false;
+    }
+
+    if (real_frames < block_frames) {
+        if (!c->concealing) {
+            c->concealing = true;
+            c->rep_pos = c->hist_pos;
+            atomic_fetch_add_explicit(&s_events, 1, memory_order_relaxed);
+        }
+        atomic_fetch_add_explicit(&s_frames, (uint32_t)(block_frames - real_frames),
+                                  memory_order_relaxed);
+
+        synthesize(c, block, real_frames, block_frames);
+    }
+
+    return c->gain == 0;
+}
+
+bool audio_conceal_fade_out(int16_t *block, size_t block_frames)
+{
+    conceal_state_t *c = &s_conceal;
+
+    if (!c->concealing) {
+        c->concealing = true;
+        c->rep_pos = c->hist_pos;
+    }
+    synthesize(c, block, 0, block_frames);
+
+    return c->gain == 0;
+}
+
+uint32_t audio_conceal_get_events(void)
+{
+    return atomic_load_explicit(&s_events, memory_order_relaxed);
+}
+
+uint32_t audio_conceal_get_frames(void)
+{
+    return atomic_load_explicit(&s_frames, memory_order_relaxed);
+}
@@ -0,0 +1,88 @@
+/*
+ * Underrun Concealment
+ * Ring starvation → repeated, faded audio instead of a hard cut to zero
+ *
+ * When the writer cannot fill a whole output block, the missing frames are
+ * synthesized by looping the most recent CONCEAL_HIST_MS of output while
+ * ramping the gain down over CONCEAL_FADE_OUT_MS. A short gap is bridged
+ * by the repeat; a longer one ends in silence instead of a click. Once
+ * real data flows again it is ramped back in over CONCEAL_FADE_IN_MS.
+ *
+ * Every block that needed concealment after a real one counts as an
+ * event, so the behaviour can be measured from other tasks.
+ *
+ * Threading: audio_conceal_reset(), audio_conceal_process() and
+ * audio_conceal_fade_out() belong to the I2S writer task. Getters are
+ * lock-free and safe from any task.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef AUDIO_CONCEAL_H
+#define AUDIO_CONCEAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Fade lengths */
+#define CONCEAL_FADE_OUT_MS     10
+#define CONCEAL_FADE_IN_MS      5
+
+/* Length of the recent-output loop used to fill gaps */
+#define CONCEAL_HIST_MS         5
+
+/*
+ * Reset concealment state for a new stream or output rate
+ * Output starts faded out, so the first real audio is ramped in.
+ *
+ * @param sample_rate Output sample rate in Hz
+ */
+void audio_conceal_reset(uint32_t sample_rate);
+
+/*
+ * Apply concealment to one output block (writer task)
+ * Frames [0, real_frames) hold fresh audio; the rest of the block is
+ * synthesized. Fresh audio is faded in if the previous block was cut.
+ *
+ * @param block Interleaved 16-bit stereo block, block_frames long
+ * @param real_frames Frames of fresh audio at the start of the block
+ * @param block_frames Total block length in frames
+ * @return true if the output has fully faded to silence
+ */
+bool audio_conceal_process(int16_t *block, size_t real_frames, size_t block_frames);
+
+/*
+ * Synthesize one block that fades out from recent output (writer task)
+ * For deliberate stops (e.g. reconfiguring I2S) that must not cut off the
+ * audio mid-waveform; not counted as concealment.
+ *
+ * @param block Interleaved 16-bit stereo block, block_frames long
+ * @param block_frames Block length in frames
+ * @return true if the output has fully faded to silence
+ */
+bool audio_conceal_fade_out(int16_t *block, size_t block_frames);
+
+/*
+ * Get number of concealment events (real audio → synthesized)
+ *
+ * @return Events since boot
+ */
+uint32_t audio_conceal_get_events(void);
+
+/*
+ * Get number of frames synthesized (repeat or silence)
+ *
+ * @return Frames since boot
+ */
+uint32_t audio_conceal_get_frames(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_CONCEAL_H */
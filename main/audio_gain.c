@@ -0,0 +1,304 @@
+/*
+ * Bridge Gain Stage Implementation
+ *
+ * Gain is tracked in dB per block (float, once per block) and applied per
+ * sample in Q15 fixed point. Unity and silent blocks skip the multiply.
+ *
+ * Dither (32-bit output only) is TPDF: the difference of two uniform 8-bit
+ * draws from one LCG step, scaled to ±1 LSB of the I2S_DITHER_BITS word,
+ * added with a half-LSB offset before truncating, so requantization rounds
+ * to nearest and leaves white noise instead of gain-dependent distortion.
+ *
+ * Date: 2026-10-16
+ */
+
+#include "audio_gain.h"
+#include "audio_pipeline.h"
+#include <math.h>
+#include <string.h>
+#include <stdatomic.h>
+
+/* Targets (any task writes, writer reads) */
+static atomic_bool s_mute = false;
+static atomic_bool s_duck = false;
+static _Atomic uint32_t s_volume = 100;
+static atomic_bool s_local_stage = false;
+
+/* Ramp state — owned by the writer task */
+static float s_cur_db = 0.0f;
+static int32_t s_cur_gain = AUDIO_GAIN_UNITY;
+
+/* Volume curve points (volume, dB), every 20 steps from 0 to 100 */
+#define VOLUME_CURVE_STEP   20
+static const float s_volume_curve_db[] = {-50.0f, -35.0f, -20.0f, -12.0f, -6.0f, 0.0f};
+
+#if defined(I2S_32BIT_OUTPUT) && defined(I2S_OUTPUT_DITHER)
+/* Bits below the DSP word that dither must cover */
+#define DITHER_SHIFT        (32 - I2S_DITHER_BITS)
+
+/* Dither LCG state (writer task) */
+static uint32_t s_dither_seed = 22222;
+#endif
+
+/*
+ * Volume trim in dB, interpolated along the documented curve (1-100)
+ */
+static float volume_db(uint32_t volume)
+{
+    uint32_t seg = volume / VOLUME_CURVE_STEP;
+    if (seg >= sizeof(s_volume_curve_db) / sizeof(s_volume_curve_db[0]) - 1) {
+        return 0.0f;
+    }
+    float t = (float)(volume % VOLUME_CURVE_STEP) / (float)VOLUME_CURVE_STEP;
+    return s_volume_curve_db[seg] + (s_volume_curve_db[seg + 1] - s_volume_curve_db[seg]) * t;
+}
+
+static float target_db(void)
+{
+    if (atomic_load_explicit(&s_mute, memory_order_relaxed)) {
+        return AUDIO_GAIN_FLOOR_DB;
+    }
+
+    float db = 0.0f;
+#ifndef AUDIO_GAIN_STAGE
+    if (!atomic_load_explicit(&s_local_stage, memory_order_relaxed)) {
+        return db;
+    }
+#endif
+    uint32_t volume = atomic_load_explicit(&s_volume, memory_order_relaxed);
+    if (volume == 0) {
+        return AUDIO_GAIN_FLOOR_DB;
+    }
+    db += volume_db(volume);
+    if (atomic_load_explicit(&s_duck, memory_order_relaxed)) {
+        db += AUDIO_GAIN_DUCK_DB;
+    }
+    return (db < AUDIO_GAIN_FLOOR_DB) ? AUDIO_GAIN_FLOOR_DB : db;
+}
+
+static int32_t db_to_q15(float db)
+{
+    if (db <= AUDIO_GAIN_FLOOR_DB) {
+        return 0;
+    }
+    if (db >= 0.0f) {
+        return AUDIO_GAIN_UNITY;
+    }
+    return (int32_t)lroundf(AUDIO_GAIN_UNITY * powf(10.0f, db / 20.0f));
+}
+
+/*
+ * Advance the dB ramp by one block and return the Q15 gain to end it on
+ */
+static int32_t ramp_block(size_t frames, uint32_t sample_rate)
+{
+    float target = target_db();
+
+    if (s_cur_db != target) {
+        float max_step = AUDIO_GAIN_RAMP_DB_PER_SEC * (float)frames / (float)sample_rate;
+        if (target > s_cur_db) {
+            s_cur_db = (target - s_cur_db > max_step) ? s_cur_db + max_step : target;
+        } else {
+            s_cur_db = (s_cur_db - target > max_step) ? s_cur_db - max_step : target;
+        }
+    }
+
+    return db_to_q15(s_cur_db);
+}
+
+#if defined(I2S_32BIT_OUTPUT) && defined(I2S_OUTPUT_DITHER)
+/*
+ * TPDF-dither 32-bit samples down to I2S_DITHER_BITS
+ */
+static void dither_block(int32_t *out, size_t samples)
+{
+    uint32_t seed = s_dither_seed;
+    const int32_t lsb_mask = ~((1 << DITHER_SHIFT) - 1);
+
+    for (size_t i = 0; i < samples; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        /* High LCG bits only: the low ones have short periods */
+        int32_t tpdf = (int32_t)(seed >> 24) - (int32_t)((seed >> 16) & 0xFF);
+        int64_t v = (int64_t)out[i] + (tpdf << (DITHER_SHIFT - 8)) + (1 << (DITHER_SHIFT - 1));
+        if (v > INT32_MAX) {
+            v = INT32_MAX;
+        } else if (v < INT32_MIN) {
+            v = INT32_MIN;
+        }
+        out[i] = (int32_t)v & lsb_mask;
+    }
+
+    s_dither_seed = seed;
+}
+#endif
+
+void audio_gain_set_mute(bool mute)
+{
+    atomic_store_explicit(&s_mute, mute, memory_order_relaxed);
+}
+
+void audio_gain_set_duck(bool duck)
+{
+    atomic_store_explicit(&s_duck, duck, memory_order_relaxed);
+}
+
+void audio_gain_set_volume(uint8_t volume)
+{
+    atomic_store_explicit(&s_volume, (volume > 100) ? 100 : volume, memory_order_relaxed);
+}
+
+void audio_gain_set_local_stage(bool local)
+{
+    atomic_store_explicit(&s_local_stage, local, memory_order_relaxed);
+}
+
+void audio_gain_process(int16_t *block, size_t frames, uint32_t sample_rate)
+{
+    int32_t g_end = ramp_block(frames, sample_rate);
+    audio_gain_apply_q15(block, frames, s_cur_gain, g_end);
+    s_cur_gain = g_end;
+}
+
+void audio_gain_process_wide(const int16_t *in, int32_t *out, size_t frames,
+                             uint32_t sample_rate)
+{
+    int32_t g_end = ramp_block(frames, sample_rate);
+    audio_gain_apply_wide_q15(in, out, frames, s_cur_gain, g_end);
+
+#if defined(I2S_32BIT_OUTPUT) && defined(I2S_OUTPUT_DITHER)
+    /* Unity is already exact in the DSP word, and silence stays silent */
+    bool exact = (s_cur_gain == g_end) && (g_end == AUDIO_GAIN_UNITY || g_end == 0);
+    if (!exact) {
+        dither_block(out, frames * 2);
+    }
+#endif
+
+    s_cur_gain = g_end;
+}
+
+void audio_gain_process_32(int32_t *block, size_t frames, uint32_t sample_rate)
+{
+    int32_t g_end = ramp_block(frames, sample_rate);
+    audio_gain_apply_q15_32(block, frames, s_cur_gain, g_end);
+
+#if defined(I2S_32BIT_OUTPUT) && defined(I2S_OUTPUT_DITHER)
+    /* Wide input has bits below the DSP word even at unity; only silence
+     * is exact */
+    if (s_cur_gain != 0 || g_end != 0) {
+        dither_block(block, frames * 2);
+    }
+#endif
+
+    s_cur_gain = g_end;
+}
+
+void audio_gain_widen(const int16_t *in, int32_t *out, size_t samples)
+{
+    /* Four at a time keeps loads and stores paired on Xtensa */
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        int32_t a = in[i];
+        int32_t b = in[i + 1];
+        int32_t c = in[i + 2];
+        int32_t d = in[i + 3];
+        out[i] = (int32_t)((uint32_t)a << 16);
+        out[i + 1] = (int32_t)((uint32_t)b << 16);
+        out[i + 2] = (int32_t)((uint32_t)c << 16);
+        out[i + 3] = (int32_t)((uint32_t)d << 16);
+    }
+    for (; i < samples; i++) {
+        out[i] = (int32_t)((uint32_t)(int32_t)in[i] << 16);
+    }
+}
+
+void audio_gain_apply_q15(int16_t *block, size_t frames, int32_t g_start, int32_t g_end)
+{
+    if (g_start == g_end) {
+        if (g_end == AUDIO_GAIN_UNITY) {
+            return;
+        }
+        if (g_end == 0) {
+            memset(block, 0, frames * 2 * sizeof(int16_t));
+            return;
+        }
+        for (size_t i = 0; i < frames * 2; i++) {
+            block[i] = (int16_t)(((int32_t)block[i] * g_end + (1 << 14)) >> 15);
+        }
+        return;
+    }
+
+    if (frames == 0) {
+        return;
+    }
+
+    int32_t step = ((g_end - g_start) * (1 << 15)) / (int32_t)frames;
+    int32_t acc = g_start * (1 << 15);
+    for (size_t i = 0; i < frames; i++) {
+        int32_t g = acc >> 15;
+        block[2 * i] = (int16_t)(((int32_t)block[2 * i] * g + (1 << 14)) >> 15);
+        block[2 * i + 1] = (int16_t)(((int32_t)block[2 * i + 1] * g + (1 << 14)) >> 15);
+        acc += step;
+    }
+}
+
+void audio_gain_apply_wide_q15(const int16_t *in, int32_t *out, size_t frames,
+                               int32_t g_start, int32_t g_end)
+{
+    if (g_start == g_end) {
+        if (g_end == AUDIO_GAIN_UNITY) {
+            audio_gain_widen(in, out, frames * 2);
+            return;
+        }
+        if (g_end == 0) {
+            memset(out, 0, frames * 2 * sizeof(int32_t));
+            return;
+        }
+        for (size_t i = 0; i < frames * 2; i++) {
+            out[i] = (int32_t)((uint32_t)((int32_t)in[i] * g_end) << 1);
+        }
+        return;
+    }
+
+    if (frames == 0) {
+        return;
+    }
+
+    int32_t step = ((g_end - g_start) * (1 << 15)) / (int32_t)frames;
+    int32_t acc = g_start * (1 << 15);
+    for (size_t i = 0; i < frames; i++) {
+        int32_t g = acc >> 15;
+        out[2 * i] = (int32_t)((uint32_t)((int32_t)in[2 * i] * g) << 1);
+        out[2 * i + 1] = (int32_t)((uint32_t)((int32_t)in[2 * i + 1] * g) << 1);
+        acc += step;
+    }
+}
+
+void audio_gain_apply_q15_32(int32_t *block, size_t frames, int32_t g_start, int32_t g_end)
+{
+    if (g_start == g_end) {
+        if (g_end == AUDIO_GAIN_UNITY) {
+            return;
+        }
+        if (g_end == 0) {
+            memset(block, 0, frames * 2 * sizeof(int32_t));
+            return;
+        }
+        for (size_t i = 0; i < frames * 2; i++) {
+            block[i] = (int32_t)(((int64_t)block[i] * g_end + (1 << 14)) >> 15);
+        }
+        return;
+    }
+
+    if (frames == 0) {
+        return;
+    }
+
+    int32_t step = ((g_end - g_start) * (1 << 15)) / (int32_t)frames;
+    int32_t acc = g_start * (1 << 15);
+    for (size_t i = 0; i < frames; i++) {
+        int64_t g = acc >> 15;
+        block[2 * i] = (int32_t)(((int64_t)block[2 * i] * g + (1 << 14)) >> 15);
+        block[2 * i + 1] = (int32_t)(((int64_t)block[2 * i + 1] * g + (1 << 14)) >> 15);
+        acc += step;
+    }
+}
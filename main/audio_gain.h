@@ -0,0 +1,169 @@
+/*
+ * Bridge Gain Stage
+ * Mute, duck and volume trim as click-free ramps on the I2S output
+ *
+ * Gain targets are set from the BLE control handler; the I2S writer task
+ * applies them once per output block. Between blocks the gain moves in dB
+ * at AUDIO_GAIN_RAMP_DB_PER_SEC, and within a block it is interpolated
+ * linearly, so changes are smooth at any block size.
+ *
+ * Mute is always applied here, so it still silences the speaker when the
+ * DSP link is down. Duck and volume trim are normally left to the STM32 and
+ * are only applied on the bridge when AUDIO_GAIN_STAGE is defined
+ * (audio_pipeline.h); the control handler then stops forwarding them, so
+ * they are never applied in both places. While the local DSP engine stands
+ * in for the STM32 (local_dsp.h) they are applied here as well.
+ *
+ * With I2S_32BIT_OUTPUT the stage also widens: 16-bit input becomes 32-bit
+ * output with the gain product kept at full precision, optionally TPDF
+ * dithered down to the I2S_DITHER_BITS word the DSP engine actually uses.
+ * Blocks the local DSP engine already produced in 32 bits are attenuated
+ * in place (audio_gain_process_32()).
+ *
+ * Threading: audio_gain_process() and audio_gain_process_wide() belong to
+ * the I2S writer task. Setters are lock-free and safe from any task.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef AUDIO_GAIN_H
+#define AUDIO_GAIN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Duck attenuation */
+#define AUDIO_GAIN_DUCK_DB          (-12.0f)
+
+/*
+ * Volume trim follows the curve in docs/protocol.md, linear in dB between
+ * its points: 100 = 0 dB, 80 = -6, 60 = -12, 40 = -20, 20 = -35, and the
+ * last slope continued below 20 (1 = -49.25 dB); 0 = muted
+ */
+
+/* Below this the output is exact zero (end of a mute fade) */
+#define AUDIO_GAIN_FLOOR_DB         (-80.0f)
+
+/* Ramp speed: a full mute fade (0 → floor) takes 80 ms */
+#define AUDIO_GAIN_RAMP_DB_PER_SEC  1000.0f
+
+/* Q15 unity gain */
+#define AUDIO_GAIN_UNITY            (1 << 15)
+
+/*
+ * Set mute (fade to silence / back)
+ *
+ * @param mute true to mute
+ */
+void audio_gain_set_mute(bool mute);
+
+/*
+ * Set audio duck (AUDIO_GAIN_DUCK_DB while active)
+ *
+ * @param duck true to duck
+ */
+void audio_gain_set_duck(bool duck);
+
+/*
+ * Set volume trim
+ *
+ * @param volume 0-100 (values above 100 are treated as 100)
+ */
+void audio_gain_set_volume(uint8_t volume);
+
+/*
+ * Apply duck and volume on the bridge even without AUDIO_GAIN_STAGE
+ * (set by the local DSP engine while it replaces the STM32)
+ *
+ * @param local true to apply them here
+ */
+void audio_gain_set_local_stage(bool local);
+
+/*
+ * Apply the gain stage to one output block (writer task)
+ *
+ * @param block Interleaved 16-bit stereo block
+ * @param frames Block length in frames
+ * @param sample_rate Output sample rate in Hz (sets the ramp step)
+ */
+void audio_gain_process(int16_t *block, size_t frames, uint32_t sample_rate);
+
+/*
+ * Apply the gain stage while widening to 32-bit (writer task)
+ *
+ * @param in Interleaved 16-bit stereo block
+ * @param out Interleaved 32-bit stereo block (left-justified)
+ * @param frames Block length in frames
+ * @param sample_rate Output sample rate in Hz (sets the ramp step)
+ */
+void audio_gain_process_wide(const int16_t *in, int32_t *out, size_t frames,
+                             uint32_t sample_rate);
+
+/*
+ * Apply the gain stage to a block that is already 32-bit (writer task)
+ * For sources with more than 16 bits of resolution (local DSP engine);
+ * dithered like audio_gain_process_wide().
+ *
+ * @param block Interleaved 32-bit stereo block (left-justified), in place
+ * @param frames Block length in frames
+ * @param sample_rate Output sample rate in Hz (sets the ramp step)
+ */
+void audio_gain_process_32(int32_t *block, size_t frames, uint32_t sample_rate);
+
+/*
+ * Widening kernel: out[i] = in[i] << 16
+ *
+ * @param in 16-bit samples
+ * @param out 32-bit samples
+ * @param samples Sample count (frames × 2)
+ */
+void audio_gain_widen(const int16_t *in, int32_t *out, size_t samples);
+
+/*
+ * Gain kernel: ramp linearly from g_start to g_end across the block
+ * Frame i gets g = g_start + ((i * step) >> 15), with
+ * step = ((g_end - g_start) << 15) / frames, and each sample becomes
+ * (x * g + 2^14) >> 15. Gains are Q15, 0..AUDIO_GAIN_UNITY, so the
+ * result never exceeds the input and needs no saturation.
+ *
+ * @param block Interleaved 16-bit stereo samples, modified in place
+ * @param frames Block length in frames
+ * @param g_start Gain at the first frame
+ * @param g_end Gain the ramp heads for (reached after the last frame)
+ */
+void audio_gain_apply_q15(int16_t *block, size_t frames, int32_t g_start, int32_t g_end);
+
+/*
+ * Widening gain kernel: as audio_gain_apply_q15(), but each sample becomes
+ * (x * g) << 1 in 32 bits, which is exact — nothing is rounded away.
+ *
+ * @param in Interleaved 16-bit stereo samples
+ * @param out Interleaved 32-bit stereo samples
+ * @param frames Block length in frames
+ * @param g_start Gain at the first frame
+ * @param g_end Gain the ramp heads for (reached after the last frame)
+ */
+void audio_gain_apply_wide_q15(const int16_t *in, int32_t *out, size_t frames,
+                               int32_t g_start, int32_t g_end);
+
+/*
+ * 32-bit gain kernel: as audio_gain_apply_q15(), on 32-bit samples, each
+ * becoming (x * g + 2^14) >> 15 with a 64-bit product
+ *
+ * @param block Interleaved 32-bit stereo samples, modified in place
+ * @param frames Block length in frames
+ * @param g_start Gain at the first frame
+ * @param g_end Gain the ramp heads for (reached after the last frame)
+ */
+void audio_gain_apply_q15_32(int32_t *block, size_t frames, int32_t g_start, int32_t g_end);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_GAIN_H */
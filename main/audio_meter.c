@@ -0,0 +1,108 @@
+/*
+ * Audio Level Meter Implementation
+ *
+ * Per block: |x| max and Σ x² per channel over the decimated frames, in
+ * integers only (16×16 multiplies, 64-bit sum). dB conversion and
+ * ballistics run once per block in float.
+ *
+ * Date: 2026-10-16
+ */
+
+#include "audio_meter.h"
+#include <math.h>
+#include <stdatomic.h>
+
+/* 0 dBFS reference */
+#define FULL_SCALE          32768.0f
+
+/* Ballistics state — owned by the writer task: peak L/R, RMS L/R in dB */
+static float s_level_db[4] = {
+    AUDIO_METER_FLOOR_DB, AUDIO_METER_FLOOR_DB, AUDIO_METER_FLOOR_DB, AUDIO_METER_FLOOR_DB
+};
+
+/* Published scaled levels: peak_l | peak_r << 8 | rms_l << 16 | rms_r << 24 */
+static _Atomic uint32_t s_levels;
+
+static uint8_t scale(float db)
+{
+    if (db <= AUDIO_METER_FLOOR_DB) {
+        return 0;
+    }
+    if (db >= 0.0f) {
+        return 100;
+    }
+    return (uint8_t)(100.0f * (db - AUDIO_METER_FLOOR_DB) / -AUDIO_METER_FLOOR_DB + 0.5f);
+}
+
+static float to_db(float amplitude)
+{
+    if (amplitude < 1.0f) {
+        return AUDIO_METER_FLOOR_DB;
+    }
+    return 20.0f * log10f(amplitude / FULL_SCALE);
+}
+
+void audio_meter_process(const int16_t *block, size_t frames, uint32_t sample_rate)
+{
+    int32_t peak_l = 0;
+    int32_t peak_r = 0;
+    uint64_t sum_l = 0;
+    uint64_t sum_r = 0;
+    size_t count = 0;
+
+    for (size_t i = 0; i < frames; i += AUDIO_METER_DECIMATION) {
+        int32_t l = block[2 * i];
+        int32_t r = block[2 * i + 1];
+        sum_l += (uint32_t)(l * l);
+        sum_r += (uint32_t)(r * r);
+        l = (l < 0) ? -l : l;
+        r = (r < 0) ? -r : r;
+        if (l > peak_l) {
+            peak_l = l;
+        }
+        if (r > peak_r) {
+            peak_r = r;
+        }
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    float now_db[4] = {
+        to_db((float)peak_l),
+        to_db((float)peak_r),
+        to_db(sqrtf((float)sum_l / (float)count)),
+        to_db(sqrtf((float)sum_r / (float)count)),
+    };
+
+    /* Instant attack, linear-in-dB release */
+    float release = AUDIO_METER_RELEASE_DB_PER_SEC * (float)frames / (float)sample_rate;
+    uint32_t packed = 0;
+    for (int i = 0; i < 4; i++) {
+        float fallen = s_level_db[i] - release;
+        s_level_db[i] = (now_db[i] > fallen) ? now_db[i] : fallen;
+        if (s_level_db[i] < AUDIO_METER_FLOOR_DB) {
+            s_level_db[i] = AUDIO_METER_FLOOR_DB;
+        }
+        packed |= (uint32_t)scale(s_level_db[i]) << (8 * i);
+    }
+
+    atomic_store_explicit(&s_levels, packed, memory_order_relaxed);
+}
+
+void audio_meter_get(audio_meter_levels_t *out)
+{
+    uint32_t packed = atomic_load_explicit(&s_levels, memory_order_relaxed);
+    out->peak_l = (uint8_t)packed;
+    out->peak_r = (uint8_t)(packed >> 8);
+    out->rms_l = (uint8_t)(packed >> 16);
+    out->rms_r = (uint8_t)(packed >> 24);
+}
+
+uint8_t audio_meter_get_level(void)
+{
+    audio_meter_levels_t levels;
+    audio_meter_get(&levels);
+    return (levels.rms_l > levels.rms_r) ? levels.rms_l : levels.rms_r;
+}
@@ -0,0 +1,74 @@
+/*
+ * Audio Level Meter
+ * Decimated per-channel peak / RMS of the PCM sent to I2S
+ *
+ * The writer task feeds every output block through a cheap integer kernel
+ * that looks at one frame in AUDIO_METER_DECIMATION. Once per block the
+ * sums are turned into dBFS, given meter ballistics (instant attack,
+ * AUDIO_METER_RELEASE_DB_PER_SEC release) and mapped to 0-100 over
+ * AUDIO_METER_FLOOR_DB..0 dBFS.
+ *
+ * Threading: audio_meter_process() belongs to the I2S writer task. The
+ * scaled levels are published as one 32-bit atomic, so readers on any task
+ * see a consistent set without locking.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef AUDIO_METER_H
+#define AUDIO_METER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One frame in N is measured (~11 kHz effective rate at 44.1 kHz) */
+#define AUDIO_METER_DECIMATION          4
+
+/* Level mapped to 0 on the 0-100 scale */
+#define AUDIO_METER_FLOOR_DB            (-60.0f)
+
+/* Meter fall-back speed after a peak */
+#define AUDIO_METER_RELEASE_DB_PER_SEC  20.0f
+
+/*
+ * Scaled levels, 0-100 (0 = at or below AUDIO_METER_FLOOR_DB, 100 = 0 dBFS)
+ */
+typedef struct {
+    uint8_t peak_l;
+    uint8_t peak_r;
+    uint8_t rms_l;
+    uint8_t rms_r;
+} audio_meter_levels_t;
+
+/*
+ * Measure one block (writer task)
+ *
+ * @param block Interleaved 16-bit stereo block
+ * @param frames Block length in frames
+ * @param sample_rate Sample rate in Hz (sets the release step)
+ */
+void audio_meter_process(const int16_t *block, size_t frames, uint32_t sample_rate);
+
+/*
+ * Get the latest per-channel levels
+ *
+ * @param out Levels destination
+ */
+void audio_meter_get(audio_meter_levels_t *out);
+
+/*
+ * Get a single 0-100 level for status displays (louder channel's RMS)
+ *
+ * @return Level, 0-100
+ */
+uint8_t audio_meter_get_level(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_METER_H */
@@ -0,0 +1,273 @@
+/*
+ * Audio Pipeline Health Metrics Implementation
+ *
+ * Fill min/max use compare-and-swap so the snapshot reader can reset them
+ * concurrently with the writer; plain counters use relaxed fetch-add.
+ *
+ * Date: 2026-10-16
+ */
+
+#include "audio_metrics.h"
+#include "audio_conceal.h"
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "AUDIO_METRICS";
+
+#define US_PER_SEC          1000000LL
+
+/* Packet rate older than this reads as zero (stream stopped) */
+#define RATE_STALE_MS       2000
+
+/* Minimum spacing of overflow reports */
+#define OVERFLOW_REPORT_US  US_PER_SEC
+
+/* Histogram scale: the active ring limit (writer task, or before it starts) */
+static size_t s_fill_scale;
+
+/* Fill window (writer updates, snapshot resets). The sum is 64-bit: a
+ * window left unread for minutes would otherwise wrap it */
+static _Atomic uint32_t s_fill_min = UINT32_MAX;
+static _Atomic uint32_t s_fill_max;
+static _Atomic uint64_t s_fill_sum;
+static _Atomic uint32_t s_fill_count;
+static _Atomic uint32_t s_fill_hist[AUDIO_METRICS_HIST_BINS];
+
+/* Cumulative counters */
+static _Atomic uint32_t s_dropped_bytes;
+static _Atomic uint32_t s_dropped_packets;
+static _Atomic uint32_t s_skipped_bytes;
+static _Atomic uint32_t s_compress_us;
+static _Atomic uint32_t s_underruns;
+static _Atomic uint32_t s_i2s_bytes;
+static _Atomic uint32_t s_writer_cpu_us;
+
+/* Standby: entries, completed time, start of the current one (0 = awake) */
+static _Atomic uint32_t s_standby_count;
+static _Atomic uint32_t s_standby_ms;
+static _Atomic uint32_t s_standby_since_ms;
+static _Atomic uint32_t s_wake_us;
+
+/* Packet rate: counted in 1 s windows on the BTC task, then published */
+static int64_t s_pkt_window_start_us;
+static uint32_t s_pkt_window_count;
+static _Atomic uint32_t s_pkt_per_sec;
+static _Atomic uint32_t s_pkt_last_ms;     /* 32-bit so it stays lock-free */
+
+static void reset_fill_window(void)
+{
+    atomic_store(&s_fill_min, UINT32_MAX);
+    atomic_store(&s_fill_max, 0);
+    atomic_store(&s_fill_sum, 0);
+    atomic_store(&s_fill_count, 0);
+    for (int i = 0; i < AUDIO_METRICS_HIST_BINS; i++) {
+        atomic_store(&s_fill_hist[i], 0);
+    }
+}
+
+void audio_metrics_reset(size_t ring_limit)
+{
+    s_fill_scale = ring_limit;
+    reset_fill_window();
+
+    atomic_store(&s_dropped_bytes, 0);
+    atomic_store(&s_dropped_packets, 0);
+    atomic_store(&s_skipped_bytes, 0);
+    atomic_store(&s_compress_us, 0);
+    atomic_store(&s_underruns, 0);
+    atomic_store(&s_i2s_bytes, 0);
+    atomic_store(&s_writer_cpu_us, 0);
+    atomic_store(&s_standby_count, 0);
+    atomic_store(&s_standby_ms, 0);
+    atomic_store(&s_standby_since_ms, 0);
+    atomic_store(&s_wake_us, 0);
+
+    s_pkt_window_start_us = 0;
+    s_pkt_window_count = 0;
+    atomic_store(&s_pkt_per_sec, 0);
+    atomic_store(&s_pkt_last_ms, 0);
+}
+
+void audio_metrics_set_fill_scale(size_t ring_limit)
+{
+    if (ring_limit != s_fill_scale) {
+        s_fill_scale = ring_limit;
+        reset_fill_window();
+    }
+}
+
+void audio_metrics_on_packet(int64_t now_us)
+{
+    if (now_us - s_pkt_window_start_us >= US_PER_SEC) {
+        /* A window that spans a pause is not a rate: publish only adjacent ones */
+        uint32_t rate = (now_us - s_pkt_window_start_us < 2 * US_PER_SEC) ?
+                        s_pkt_window_count : 0;
+        atomic_store_explicit(&s_pkt_per_sec, rate, memory_order_relaxed);
+        s_pkt_window_start_us = now_us;
+        s_pkt_window_count = 0;
+    }
+    s_pkt_window_count++;
+    atomic_store_explicit(&s_pkt_last_ms, (uint32_t)(now_us / 1000), memory_order_relaxed);
+}
+
+void audio_metrics_on_drop(uint32_t len)
+{
+    atomic_fetch_add_explicit(&s_dropped_bytes, len, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s_dropped_packets, 1, memory_order_relaxed);
+}
+
+void audio_metrics_on_skip(uint32_t len)
+{
+    atomic_fetch_add_explicit(&s_dropped_bytes, len, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s_skipped_bytes, len, memory_order_relaxed);
+}
+
+void audio_metrics_on_compress(uint32_t us)
+{
+    atomic_fetch_add_explicit(&s_compress_us, us, memory_order_relaxed);
+}
+
+void audio_metrics_report_overflow(void)
+{
+    /* Writer task only: last reported totals */
+    static int64_t last_report_us;
+    static uint32_t last_packets;
+    static uint32_t last_bytes;
+    static uint32_t last_skipped;
+    static uint32_t last_compress_us;
+
+    int64_t now_us = esp_timer_get_time();
+    if (now_us - last_report_us < OVERFLOW_REPORT_US) {
+        return;
+    }
+
+    uint32_t packets = atomic_load_explicit(&s_dropped_packets, memory_order_relaxed);
+    uint32_t bytes = atomic_load_explicit(&s_dropped_bytes, memory_order_relaxed);
+    uint32_t skipped = atomic_load_explicit(&s_skipped_bytes, memory_order_relaxed);
+    uint32_t compress_us = atomic_load_explicit(&s_compress_us, memory_order_relaxed);
+
+    if (packets != last_packets || skipped != last_skipped) {
+        ESP_LOGW(TAG, "Ring overflow: dropped %lu packets (%lu bytes) new, %lu bytes old",
+                 (unsigned long)(packets - last_packets),
+                 (unsigned long)(bytes - last_bytes - (skipped - last_skipped)),
+                 (unsigned long)(skipped - last_skipped));
+        last_report_us = now_us;
+    }
+    if (compress_us != last_compress_us) {
+        ESP_LOGI(TAG, "Ring above high water: time-compressed %lu ms of output",
+                 (unsigned long)((compress_us - last_compress_us) / 1000));
+        last_report_us = now_us;
+    }
+
+    last_packets = packets;
+    last_bytes = bytes;
+    last_skipped = skipped;
+    last_compress_us = compress_us;
+}
+
+void audio_metrics_on_fill(size_t fill)
+{
+    uint32_t f = (uint32_t)fill;
+
+    uint32_t cur = atomic_load_explicit(&s_fill_min, memory_order_relaxed);
+    while (f < cur && !atomic_compare_exchange_weak_explicit(&s_fill_min, &cur, f,
+                                                              memory_order_relaxed,
+                                                              memory_order_relaxed)) {
+    }
+    cur = atomic_load_explicit(&s_fill_max, memory_order_relaxed);
+    while (f > cur && !atomic_compare_exchange_weak_explicit(&s_fill_max, &cur, f,
+                                                              memory_order_relaxed,
+                                                              memory_order_relaxed)) {
+    }
+
+    atomic_fetch_add_explicit(&s_fill_sum, (uint64_t)f, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s_fill_count, 1, memory_order_relaxed);
+
+    if (s_fill_scale > 0) {
+        size_t bin = fill * AUDIO_METRICS_HIST_BINS / s_fill_scale;
+        if (bin >= AUDIO_METRICS_HIST_BINS) {
+            bin = AUDIO_METRICS_HIST_BINS - 1;
+        }
+        atomic_fetch_add_explicit(&s_fill_hist[bin], 1, memory_order_relaxed);
+    }
+}
+
+void audio_metrics_on_underrun(void)
+{
+    atomic_fetch_add_explicit(&s_underruns, 1, memory_order_relaxed);
+}
+
+void audio_metrics_on_i2s_write(uint32_t len)
+{
+    atomic_fetch_add_explicit(&s_i2s_bytes, len, memory_order_relaxed);
+}
+
+void audio_metrics_set_writer_cpu_us(uint32_t us)
+{
+    atomic_store_explicit(&s_writer_cpu_us, us, memory_order_relaxed);
+}
+
+void audio_metrics_on_standby(bool active)
+{
+    /* Never 0 while in standby: 0 marks "awake" */
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000) | 1;
+
+    if (active) {
+        atomic_fetch_add_explicit(&s_standby_count, 1, memory_order_relaxed);
+        atomic_store_explicit(&s_standby_since_ms, now_ms, memory_order_relaxed);
+        return;
+    }
+
+    uint32_t since = atomic_exchange_explicit(&s_standby_since_ms, 0, memory_order_relaxed);
+    if (since != 0) {
+        atomic_fetch_add_explicit(&s_standby_ms, now_ms - since, memory_order_relaxed);
+    }
+}
+
+void audio_metrics_on_wake(uint32_t us)
+{
+    atomic_store_explicit(&s_wake_us, us, memory_order_relaxed);
+}
+
+void audio_metrics_snapshot(audio_metrics_snapshot_t *out)
+{
+    uint32_t min = atomic_exchange_explicit(&s_fill_min, UINT32_MAX, memory_order_relaxed);
+    uint32_t max = atomic_exchange_explicit(&s_fill_max, 0, memory_order_relaxed);
+    uint64_t sum = atomic_exchange_explicit(&s_fill_sum, 0, memory_order_relaxed);
+    uint32_t count = atomic_exchange_explicit(&s_fill_count, 0, memory_order_relaxed);
+
+    out->fill_min = (count > 0 && min != UINT32_MAX) ? min : 0;
+    out->fill_max = max;
+    out->fill_avg = (count > 0) ? (uint32_t)(sum / count) : 0;
+
+    uint32_t hist[AUDIO_METRICS_HIST_BINS];
+    uint32_t total = 0;
+    for (int i = 0; i < AUDIO_METRICS_HIST_BINS; i++) {
+        hist[i] = atomic_exchange_explicit(&s_fill_hist[i], 0, memory_order_relaxed);
+        total += hist[i];
+    }
+    for (int i = 0; i < AUDIO_METRICS_HIST_BINS; i++) {
+        out->fill_hist_pct[i] = (total > 0) ? (uint8_t)(hist[i] * 100 / total) : 0;
+    }
+
+    out->dropped_bytes = atomic_load_explicit(&s_dropped_bytes, memory_order_relaxed);
+    out->underruns = atomic_load_explicit(&s_underruns, memory_order_relaxed);
+    out->concealments = audio_conceal_get_events();
+    out->i2s_bytes = atomic_load_explicit(&s_i2s_bytes, memory_order_relaxed);
+    out->writer_cpu_us = atomic_load_explicit(&s_writer_cpu_us, memory_order_relaxed);
+
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000) | 1;  /* As on_standby() */
+    uint32_t since = atomic_load_explicit(&s_standby_since_ms, memory_order_relaxed);
+    out->standby_count = atomic_load_explicit(&s_standby_count, memory_order_relaxed);
+    out->standby_ms = atomic_load_explicit(&s_standby_ms, memory_order_relaxed) +
+                      ((since != 0) ? now_ms - since : 0);
+    out->wake_latency_us = atomic_load_explicit(&s_wake_us, memory_order_relaxed);
+
+    uint32_t last_ms = atomic_load_explicit(&s_pkt_last_ms, memory_order_relaxed);
+    uint32_t rate = atomic_load_explicit(&s_pkt_per_sec, memory_order_relaxed);
+    if (now_ms - last_ms > RATE_STALE_MS) {
+        rate = 0;
+    }
+    out->packets_per_sec = (rate > UINT16_MAX) ? UINT16_MAX : (uint16_t)rate;
+}
@@ -0,0 +1,161 @@
+/*
+ * Audio Pipeline Health Metrics
+ * Lock-free counters for the A2DP → ring → I2S path
+ *
+ * Producers:
+ * - BTC task (A2DP data callback): packets, dropped packets/bytes
+ * - I2S writer task (Core 1): ring fill samples, re-buffer events, I2S bytes,
+ *   writer CPU time, overflow handling (oldest-data skips, time compression),
+ *   output standby and wake-up
+ *
+ * Every counter is a 32-bit atomic, so updates from either core never take
+ * a lock and never block the audio path. Byte counters are free-running and
+ * wrap at 2^32; readers should work with deltas. The one exception is the
+ * fill sum behind the average, a 64-bit atomic (a few-cycle critical
+ * section on the ESP32) so a long window cannot wrap it.
+ *
+ * Ring fill min/max/average and the fill histogram cover the interval since
+ * the previous snapshot; everything else is cumulative since boot. The BLE
+ * service takes a snapshot every 500 ms whether or not a client is
+ * connected.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef AUDIO_METRICS_H
+#define AUDIO_METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Ring fill histogram: equal-width bins over the active ring limit */
+#define AUDIO_METRICS_HIST_BINS     8
+
+/*
+ * Metrics snapshot
+ */
+typedef struct {
+    uint32_t fill_min;              /* Ring fill (bytes) since last snapshot */
+    uint32_t fill_max;
+    uint32_t fill_avg;
+    uint8_t fill_hist_pct[AUDIO_METRICS_HIST_BINS];  /* % of samples per bin */
+    uint32_t dropped_bytes;         /* Ring full on push, or skipped as oldest */
+    uint32_t underruns;             /* Ring ran dry and the writer re-buffered */
+    uint32_t concealments;          /* Blocks completed by concealment */
+    uint16_t packets_per_sec;       /* A2DP packets over the last second */
+    uint32_t i2s_bytes;             /* Bytes handed to I2S */
+    uint32_t writer_cpu_us;         /* Writer CPU time per second of audio (0 = n/a) */
+    uint32_t standby_count;         /* Times the output entered standby */
+    uint32_t standby_ms;            /* Total time in standby, including the current one */
+    uint32_t wake_latency_us;       /* Last wake: first new audio to its first I2S block */
+} audio_metrics_snapshot_t;
+
+/*
+ * Reset all metrics
+ *
+ * @param ring_limit Usable ring size in bytes (histogram scale)
+ */
+void audio_metrics_reset(size_t ring_limit);
+
+/*
+ * Rescale the fill histogram to a new ring limit and start a new fill
+ * window, so no window mixes bins of two scales (profile switch)
+ *
+ * @param ring_limit Usable ring size in bytes
+ */
+void audio_metrics_set_fill_scale(size_t ring_limit);
+
+/*
+ * Record an A2DP packet arrival (BTC task)
+ *
+ * @param now_us Arrival timestamp (esp_timer_get_time())
+ */
+void audio_metrics_on_packet(int64_t now_us);
+
+/*
+ * Record bytes dropped because the ring was full (BTC task)
+ *
+ * @param len Dropped length in bytes
+ */
+void audio_metrics_on_drop(uint32_t len);
+
+/*
+ * Record old buffered bytes discarded to bound latency (writer task)
+ *
+ * @param len Discarded length in bytes
+ */
+void audio_metrics_on_skip(uint32_t len);
+
+/*
+ * Record output time spent time-compressing to drain the ring (writer task)
+ *
+ * @param us Duration of the compressed block in microseconds
+ */
+void audio_metrics_on_compress(uint32_t us);
+
+/*
+ * Log overflow activity since the last report, at most once per second
+ * Call once per output block from the writer task; keeps logging off the
+ * BTC task, where a per-packet log would steal time from the BT stack.
+ */
+void audio_metrics_report_overflow(void);
+
+/*
+ * Record the ring fill level once per output block (writer task)
+ *
+ * @param fill Ring fill in bytes
+ */
+void audio_metrics_on_fill(size_t fill);
+
+/*
+ * Record a re-buffer after the ring ran dry (writer task)
+ */
+void audio_metrics_on_underrun(void);
+
+/*
+ * Record bytes written to I2S (writer task)
+ *
+ * @param len Bytes written
+ */
+void audio_metrics_on_i2s_write(uint32_t len);
+
+/*
+ * Publish writer CPU time per second of output audio (writer task)
+ * Only available when FreeRTOS run-time stats are enabled.
+ *
+ * @param us CPU microseconds per second of audio
+ */
+void audio_metrics_set_writer_cpu_us(uint32_t us);
+
+/*
+ * Record the output entering or leaving standby (writer task)
+ *
+ * @param active true on entry, false on wake
+ */
+void audio_metrics_on_standby(bool active);
+
+/*
+ * Record the wake-up latency of the last standby exit (writer task)
+ *
+ * @param us Time from the first new audio to its block being handed to I2S
+ */
+void audio_metrics_on_wake(uint32_t us);
+
+/*
+ * Take a snapshot and start a new fill window
+ * Intended for a single periodic reader (BLE status timer).
+ *
+ * @param out Snapshot destination
+ */
+void audio_metrics_snapshot(audio_metrics_snapshot_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_METRICS_H */
@@ -0,0 +1,1780 @@
+/*
+ * Audio Pipeline Implementation
+ * A2DP sink PCM → lock-free SPSC ring → I2S writer task (Core 1)
+ *
+ * The BTC task copies each decoded SBC packet into the ring without taking
+ * any lock; the writer task drains contiguous ring spans straight into
+ * i2s_channel_write() and only sleeps (task notification) when the ring
+ * runs dry.
+ *
+ * The pre-buffer depth is not fixed: jitter_buffer.c measures packet
+ * arrival jitter on the BTC task and publishes a target fill level, which
+ * the writer waits for at start-up and again whenever the ring runs dry.
+ * While it waits, the writer publishes the fill it needs, and the producer
+ * only notifies it once that level is crossed.
+ *
+ * The writer is a small state machine: PREBUFFER (silent, waiting for the
+ * target) → PLAYING → back to PREBUFFER after a rate switch, profile switch
+ * or long underrun. A2DP suspend or disconnect moves it to STOPPING: the
+ * buffered tail plays out (disconnect: is dropped), fades, and the next
+ * stream start gets the same pre-buffer and fade-in as the first.
+ *
+ * Between the ring and I2S sits a drift-compensating resampler (asrc.c).
+ * The phone's clock sets the input rate, our I2S master clock the output
+ * rate; the writer steers the ratio a few hundred ppm either way so the
+ * ring fill stays on the jitter target instead of creeping to full/empty.
+ *
+ * If the ring runs dry mid-block, audio_conceal.c fills the rest of the
+ * block by repeating recent output under a fade-out, and ramps the next
+ * real audio back in, so starvation never ends in a hard cut to zero.
+ * audio_gain.c then ramps mute (and optionally duck/volume) per block.
+ *
+ * Sample-rate changes are applied by the writer, not the A2DP callback:
+ * the new rate's first byte is marked in the ring, old-rate audio plays
+ * out up to that mark and fades, the DMA is flushed with silence, the
+ * STM32 is told over UART (EVT:RATE), and only then is I2S reclocked and
+ * the pre-buffer rebuilt at the new rate.
+ *
+ * With I2S_DMA_CALLBACK_FEED the writer does not call i2s_channel_write():
+ * the driver's on_sent ISR hands back each DMA buffer as it finishes, and
+ * the writer resamples ring spans straight into it, one exact
+ * dma_frame_num block at a time, with no intermediate copy.
+ *
+ * With I2S_FIXED_OUTPUT_RATE the ASRC output (still at the stream rate) is
+ * converted to 48 kHz by src_polyphase.c, and I2S is never reclocked.
+ *
+ * Overflow (ring climbing well above the jitter target) is handled by the
+ * writer according to the selected policy: leave it to the producer, which
+ * drops the newest packet once the ring is full; skip the oldest audio back
+ * down to the target; or play a few thousand ppm fast until it is drained.
+ * Drops are counted, and reported at most once per second from the writer.
+ *
+ * Audio profiles trade latency for robustness: each sets the jitter-target
+ * bounds and the I2S DMA layout. A switch is applied by the writer, which
+ * fades out, recreates the I2S channel and carries on from the ring.
+ *
+ * The ring lives in internal RAM (RINGBUF_SIZE) unless the module has
+ * PSRAM, detected at boot: then a DEEP_RINGBUF_SIZE ring is placed there
+ * and the deep profile can hold seconds of audio through RF dropouts.
+ * The shallow profiles cap the fill at RINGBUF_SIZE as before, and the
+ * writer copies each span into internal RAM in one sequential burst
+ * before resampling it, so the ASRC never works on PSRAM directly.
+ *
+ * audio_route.c (swap, mono, trim, delay) runs on every block just ahead
+ * of the gain stage. Trim changes ramp; swap, mono and delay changes are
+ * committed by the writer behind a fade-out, or at once while silent.
+ * With I2S_32BIT_OUTPUT the trim moves to the widened block, after the
+ * local DSP engine and just before the gain stage.
+ *
+ * With no STM32 fitted, or one that has gone quiet, the local DSP engine
+ * (local_dsp.c) runs the preset EQ, loudness, bass boost and limiter
+ * between routing and gain. Its EQ changes are committed like routing
+ * changes, behind a fade-out. With I2S_32BIT_OUTPUT it hands its 24-bit
+ * result to the gain stage in the 32-bit output block.
+ *
+ * While the app shows a spectrum, the writer copies a decimated excerpt
+ * of the output a few times per second for spectrum.c, whose analysis
+ * task on the same core runs in the time the writer is blocked on I2S.
+ * A frame the analysis cannot take yet is dropped, never waited for.
+ *
+ * An armed capture tap (audio_capture.c) copies each block handed to I2S,
+ * tagged with the ring fill, writer state and underrun/fade marks, for a
+ * later dump on the console.
+ *
+ * A runtime test signal (signal_gen.c) can take the output over for
+ * diagnostics: the writer fades the stream out, plays the generator with
+ * no gain applied, and discards A2DP data until the signal is switched
+ * off, then pre-buffers as for a new stream.
+ *
+ * After a configurable stretch of silence (paused stream, or a source that
+ * keeps streaming zeros) the writer stops the I2S clocks and tells the DSP
+ * (EVT:STANDBY) so the STM32 and DAC can sleep. While streamed silence
+ * keeps arriving, the writer discards it but holds a jitter target's worth
+ * in the ring, so the first audible packet starts playing at once with the
+ * usual cushion in front of it.
+ *
+ * The writer also tracks end-to-end output latency (smoothed ring fill +
+ * queued DMA + DSP) and hands it to main.c for A2DP delay reporting, so the
+ * source can hold video back by the same amount.
+ *
+ * Frames clocked out on I2S are counted in the on_sent ISR. The count runs
+ * on across clock restarts, and each restart sends the DSP the value it
+ * resumes at (EVT:SYNC), so the two sides agree on frame numbers. From the
+ * count, the DMA depth and the ring fill, the writer publishes the frame
+ * at which audio entering the ring now will play. DSP control changes are
+ * stamped with that frame (EVT:SCHED), so the STM32 applies them on the
+ * audio the user was listening to rather than whenever the UART line lands.
+ *
+ * Date: 2026-10-16
+ */
+
+#include "audio_pipeline.h"
+#include "audio_ring.h"
+#include "jitter_buffer.h"
+#include "asrc.h"
+#include "audio_conceal.h"
+#include "audio_gain.h"
+#include "audio_meter.h"
+#include "audio_clip.h"
+#include "audio_route.h"
+#include "audio_capture.h"
+#include "local_dsp.h"
+#include "spectrum.h"
+#include "audio_metrics.h"
+#include "signal_gen.h"
+#include "a2dp_trace.h"
+#include "ble_gatt_dsp.h"
+#include <string.h>
+#ifdef I2S_FIXED_OUTPUT_RATE
+#include "src_polyphase.h"
+#endif
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/timers.h"
+#include "esp_attr.h"
+#include "sdkconfig.h"
+#include "driver/i2s_std.h"
+
+static const char *TAG = "AUDIO_PIPE";
+
+/* I2S sample format: audio is 16-bit stereo up to the gain stage; with
+ * I2S_32BIT_OUTPUT the gain stage widens it to 32-bit slots */
+#ifdef I2S_32BIT_OUTPUT
+#define I2S_BITS_PER_SAMPLE I2S_DATA_BIT_WIDTH_32BIT
+#define I2S_SLOT_FRAME_BYTES    8   /* 32-bit stereo on the wire */
+#else
+#define I2S_BITS_PER_SAMPLE I2S_DATA_BIT_WIDTH_16BIT
+#define I2S_SLOT_FRAME_BYTES    4
+#endif
+#define I2S_FRAME_BYTES     4       /* 16-bit stereo: ring, ASRC, concealment */
+
+/* Largest I2S DMA layout of any profile (sizes the queue and block buffers) */
+#define I2S_DMA_DESC_MAX    8
+#define I2S_DMA_FRAME_MAX   480
+
+/* Ring buffer for A2DP → I2S decoupling (must be a power of two) */
+#define RINGBUF_SIZE        (32 * 1024)
+
+/* Deep ring in PSRAM (~3 s at 44.1 kHz), used when the module has PSRAM */
+#define DEEP_RINGBUF_SIZE   (512 * 1024)
+
+/* Staging for spans read from a PSRAM ring (one block plus ASRC slack) */
+#define RING_STAGE_BYTES    2048
+
+/*
+ * Audio profile parameters
+ */
+typedef struct {
+    const char *name;
+    uint8_t dma_desc_num;           /* I2S DMA descriptors */
+    uint16_t dma_frame_num;         /* Frames per descriptor == writer block */
+    uint16_t jb_min_ms;             /* Jitter-buffer target bounds */
+    uint16_t jb_default_ms;
+    uint16_t jb_max_ms;
+    uint32_t ring_bytes;            /* Ring fill cap (the ring may be larger) */
+} audio_profile_cfg_t;
+
+static const audio_profile_cfg_t s_profiles[AUDIO_PROFILE_COUNT] = {
+    [AUDIO_PROFILE_ROBUST] = {
+        .name = "robust",
+        .dma_desc_num = 8,          /* default: 6 */
+        .dma_frame_num = 480,       /* default: 240 */
+        .jb_min_ms = JB_TARGET_MIN_MS,
+        .jb_default_ms = JB_TARGET_DEFAULT_MS,
+        .jb_max_ms = JB_TARGET_MAX_MS,
+        .ring_bytes = RINGBUF_SIZE,
+    },
+    [AUDIO_PROFILE_LOW_LATENCY] = {
+        .name = "low-latency",
+        .dma_desc_num = 4,
+        .dma_frame_num = 240,
+        .jb_min_ms = 10,
+        .jb_default_ms = 25,
+        .jb_max_ms = 60,
+        .ring_bytes = RINGBUF_SIZE,
+    },
+    [AUDIO_PROFILE_DEEP] = {
+        .name = "deep",
+        .dma_desc_num = 8,
+        .dma_frame_num = 480,
+        .jb_min_ms = 1000,
+        .jb_default_ms = 1000,
+        .jb_max_ms = 2000,
+        .ring_bytes = DEEP_RINGBUF_SIZE,
+    },
+};
+
+/* ASRC ratio debug log interval (output blocks, ~5 s at 44.1 kHz) */
+#define ASRC_LOG_BLOCKS     460
+
+/* Writer task configuration */
+#define WRITER_TASK_STACK_SIZE  4096
+#define WRITER_TASK_PRIORITY    10
+#define WRITER_TASK_CORE        1
+
+/* Upper bound on a single wait for the producer (guards a lost wakeup) */
+#define WRITER_IDLE_WAIT_MS     100
+
+/* Retry interval when the I2S channel cannot be recreated */
+#define I2S_REINIT_RETRY_MS     500
+
+/* Writer CPU time is sampled once per this much output audio */
+#define WRITER_CPU_WINDOW_MS    1000
+
+/* Overflow handling starts this far above the jitter target */
+#define OVERFLOW_MARGIN_MS      60
+
+/* Time-compress ratio offset (~7 cents; drains 60 ms in about 15 s) */
+#define OVERFLOW_COMPRESS_PPM   4000
+
+/* Ring fill smoothing for the latency estimate (1/2^n per block, ~170 ms) */
+#define LATENCY_FILL_SHIFT      4
+
+/* Latency re-reported when it moves this far, at most once per interval */
+#define LATENCY_REPORT_STEP_US      2000
+#define LATENCY_REPORT_INTERVAL_US  1000000
+
+/* I2S channel handle */
+static i2s_chan_handle_t i2s_tx_handle = NULL;
+
+/* A2DP → I2S ring (producer: BTC task, consumer: writer task) */
+static audio_ring_t s_ring;
+
+/* Fill cap of the active profile; the producer drops packets above it */
+static _Atomic size_t s_ring_limit = RINGBUF_SIZE;
+
+#if CONFIG_SPIRAM
+/* Ring is in PSRAM: the writer reads it through s_ring_stage (internal) */
+static bool s_ring_external;
+static uint8_t s_ring_stage[RING_STAGE_BYTES] __attribute__((aligned(4)));
+#endif
+
+/* Writer task handle and "consumer is sleeping on an empty ring" flag.
+ * The producer only pays for a task notification when this is set. */
+static TaskHandle_t s_writer_task = NULL;
+static atomic_bool s_writer_waiting = false;
+
+/* Ring fill the sleeping writer needs before it is worth waking */
+static _Atomic size_t s_writer_wake_fill;
+
+/*
+ * Writer state (writer task only)
+ */
+typedef enum {
+    WRITER_PREBUFFER,               /* Output silent, filling to the jitter target */
+    WRITER_PLAYING,                 /* Steady state */
+    WRITER_STOPPING,                /* Stream ended: play out the ring, then fade */
+    WRITER_SIGNAL,                  /* Test signal generator owns the output */
+} writer_state_t;
+
+static writer_state_t s_writer_state = WRITER_PREBUFFER;
+
+/* Capture marks for the block about to be submitted (AUDIO_CAPTURE_FLAG_*) */
+static uint8_t s_submit_flags;
+
+/* A2DP stream events not yet taken by the writer (STREAM_EVT_* bits) */
+#define STREAM_EVT_STARTED          (1u << 0)
+#define STREAM_EVT_SUSPENDED        (1u << 1)
+#define STREAM_EVT_DISCONNECTED     (1u << 2)
+static _Atomic uint32_t s_stream_events;
+
+/* Rate assumed for the A2DP stream until the codec config arrives */
+#define A2DP_DEFAULT_SAMPLE_RATE    44100
+
+/* Latest A2DP stream sample rate (BTC task) */
+static uint32_t s_current_sample_rate = A2DP_DEFAULT_SAMPLE_RATE;
+
+/* Rate of the audio the writer is playing now (writer task); this is the
+ * I2S clock unless fixed-rate mode */
+static uint32_t s_play_rate = A2DP_DEFAULT_SAMPLE_RATE;
+
+/* Pending rate switch: new rate, and the ring write position where it starts */
+static atomic_bool s_rate_switch_pending = false;
+static _Atomic size_t s_rate_switch_pos;
+static _Atomic uint32_t s_rate_switch_rate;
+
+/* Drift-compensating resampler (writer task only) */
+static asrc_t s_asrc;
+
+/* Active profile and its DMA layout (writer task once started); frames
+ * resampled per output block is exactly one DMA descriptor */
+static audio_profile_t s_profile = AUDIO_PROFILE_ROBUST;
+static size_t s_dma_desc_num = 8;
+static size_t s_block_frames = 480;
+
+/* Profile requested over BLE, picked up by the writer (-1: none) */
+static _Atomic int s_profile_pending = -1;
+
+#ifdef I2S_DMA_CALLBACK_FEED
+/* DMA buffers returned by on_sent, oldest first; the writer fills them in place */
+static QueueHandle_t s_dma_free_queue = NULL;
+#else
+/* Output block copied into DMA by i2s_channel_write() */
+static int32_t s_out_block[I2S_DMA_FRAME_MAX * I2S_SLOT_FRAME_BYTES / sizeof(int32_t)];
+#endif
+
+#ifdef I2S_32BIT_OUTPUT
+/* 16-bit working block, widened into the output block by the gain stage */
+static int16_t s_pcm_block[I2S_DMA_FRAME_MAX * 2];
+#endif
+
+/* Set on stream/rate change; the writer resets the ASRC before its next block */
+static atomic_bool s_asrc_reset_pending = true;
+
+/* Overflow policy (any task writes, writer reads) */
+static _Atomic int s_overflow_policy = AUDIO_OVERFLOW_POLICY_DEFAULT;
+
+/* Time compression in progress (writer task only) */
+static bool s_compressing;
+
+/* Latency reporting: callback, DSP share, and the writer's published estimate */
+static audio_latency_cb_t s_latency_cb = NULL;
+static _Atomic uint32_t s_dsp_latency_us = DSP_DOWNSTREAM_LATENCY_US;
+static _Atomic uint32_t s_latency_us;
+static atomic_bool s_latency_dirty = true;
+
+/* Output frame clock: frames clocked out on I2S (on_sent ISR, free-running
+ * across clock restarts), and the writer's estimate of how far past that
+ * count audio entering the ring now will play (0: nothing in flight) */
+static _Atomic uint32_t s_sent_frames;
+static _Atomic uint32_t s_sched_lead_frames;
+
+/* Output standby: silence timeout (any task writes), and writer-only state */
+static _Atomic uint32_t s_standby_timeout_ms = AUDIO_STANDBY_TIMEOUT_DEFAULT_S * 1000;
+static bool s_standby;
+static int64_t s_last_sound_us;     /* Last block with audible output */
+static int64_t s_wake_us;           /* Wake trigger, until the first block is out (0: none) */
+static size_t s_standby_scanned;    /* Ring bytes from the read position known silent */
+
+#ifdef I2S_FIXED_OUTPUT_RATE
+/* Stream rate → 48 kHz converter and the ASRC output it consumes.
+ * Upsampling only, so one block of stream-rate frames is always enough. */
+static src_polyphase_t s_src;
+static int16_t s_mid_block[I2S_DMA_FRAME_MAX * 2];
+static size_t s_mid_pos;
+static size_t s_mid_len;
+#endif
+
+/* Rate the I2S peripheral is clocked at */
+static inline uint32_t i2s_output_rate(void)
+{
+#ifdef I2S_FIXED_OUTPUT_RATE
+    return I2S_SAMPLE_RATE;
+#else
+    return s_play_rate;
+#endif
+}
+
+/*
+ * I2S on_sent ISR callback
+ * Advances the output frame clock. With the callback feed, the descriptor
+ * just finished will not be sent again until the other s_dma_desc_num - 1
+ * have gone out, so the writer may refill it.
+ */
+static bool IRAM_ATTR i2s_on_sent(i2s_chan_handle_t handle, i2s_event_data_t *event,
+                                  void *user_ctx)
+{
+    atomic_fetch_add_explicit(&s_sent_frames, (uint32_t)(event->size / I2S_SLOT_FRAME_BYTES),
+                              memory_order_relaxed);
+#ifdef I2S_DMA_CALLBACK_FEED
+    BaseType_t woken = pdFALSE;
+    xQueueSendFromISR(s_dma_free_queue, &event->dma_buf, &woken);
+    return woken == pdTRUE;
+#else
+    return false;
+#endif
+}
+
+/* Last SYNC value, and whether it still has to be queued (writer task) */
+static uint32_t s_sync_frame;
+static bool s_sync_pending;
+
+static void i2s_queue_sync(void)
+{
+    uint8_t evt[4] = {
+        (uint8_t)s_sync_frame, (uint8_t)(s_sync_frame >> 8),
+        (uint8_t)(s_sync_frame >> 16), (uint8_t)(s_sync_frame >> 24)
+    };
+    s_sync_pending = !ble_gatt_dsp_send_dsp_event("SYNC", evt, sizeof(evt));
+}
+
+/*
+ * Tell the DSP which frame index the I2S clocks resumed at (clocks just
+ * started). The DSP counts on from this value, so schedule stamps stay
+ * comparable across restarts. Dropped at boot, before the UART is up; both
+ * sides start at 0 then. A SYNC lost to a full UART queue would skew every
+ * stamp until the next restart, so the writer retries it once per block.
+ */
+static void i2s_send_sync(void)
+{
+    s_sync_frame = atomic_load_explicit(&s_sent_frames, memory_order_relaxed);
+    i2s_queue_sync();
+}
+
+/*
+ * Delete a half-initialized I2S channel after a failed i2s_init() step
+ */
+static esp_err_t i2s_init_abort(esp_err_t err)
+{
+    if (i2s_tx_handle != NULL) {
+        i2s_del_channel(i2s_tx_handle);
+        i2s_tx_handle = NULL;
+    }
+    return err;
+}
+
+/*
+ * Initialize I2S for audio output
+ * ESP32 is I2S master — BCK/LRCK shared to STM32 and PCM5102A
+ * On failure no channel is left behind (i2s_tx_handle is NULL).
+ */
+static esp_err_t i2s_init(void)
+{
+    ESP_LOGI(TAG, "Initializing I2S...");
+
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
+    chan_cfg.dma_desc_num = s_dma_desc_num;
+    chan_cfg.dma_frame_num = s_block_frames;
+#ifdef I2S_DMA_CALLBACK_FEED
+    /* Clear before on_sent, so a buffer the writer does not refill is silence
+     * and the ISR never clears one the writer is already filling */
+    chan_cfg.auto_clear_before_cb = true;
+    chan_cfg.auto_clear_after_cb = false;
+#else
+    chan_cfg.auto_clear = true;      /* Backstop: silence if the writer itself stalls */
+#endif
+
+    esp_err_t ret = i2s_new_channel(&chan_cfg, &i2s_tx_handle, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create I2S channel: %s", esp_err_to_name(ret));
+        i2s_tx_handle = NULL;
+        return ret;
+    }
+
+    i2s_std_config_t std_cfg = {
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(i2s_output_rate()),
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_BITS_PER_SAMPLE, I2S_SLOT_MODE_STEREO),
+        .gpio_cfg = {
+            .mclk = I2S_GPIO_UNUSED,
+            .bclk = I2S_BCK_PIN,
+            .ws = I2S_WS_PIN,
+            .dout = I2S_DATA_PIN,
+            .din = I2S_GPIO_UNUSED,
+            .invert_flags = {
+                .mclk_inv = false,
+                .bclk_inv = false,
+                .ws_inv = false,
+            },
+        },
+    };
+
+    ret = i2s_channel_init_std_mode(i2s_tx_handle, &std_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to init I2S std mode: %s", esp_err_to_name(ret));
+        return i2s_init_abort(ret);
+    }
+
+    i2s_event_callbacks_t cbs = {
+        .on_sent = i2s_on_sent,
+    };
+    ret = i2s_channel_register_event_callback(i2s_tx_handle, &cbs, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register I2S callbacks: %s", esp_err_to_name(ret));
+        return i2s_init_abort(ret);
+    }
+
+    ret = i2s_channel_enable(i2s_tx_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to enable I2S channel: %s", esp_err_to_name(ret));
+        return i2s_init_abort(ret);
+    }
+    i2s_send_sync();
+
+    ESP_LOGI(TAG, "I2S initialized: BCK=GPIO%d, WS=GPIO%d, DOUT=GPIO%d @ %luHz, DMA %u x %u",
+             I2S_BCK_PIN, I2S_WS_PIN, I2S_DATA_PIN, (unsigned long)i2s_output_rate(),
+             (unsigned)s_dma_desc_num, (unsigned)s_block_frames);
+    return ESP_OK;
+}
+
+#ifndef I2S_FIXED_OUTPUT_RATE
+/*
+ * Reclock I2S to a new sample rate (writer task, output already silent)
+ */
+static esp_err_t i2s_reclock(uint32_t sample_rate)
+{
+    ESP_LOGI(TAG, "Reconfiguring I2S to %lu Hz", (unsigned long)sample_rate);
+
+    i2s_std_clk_config_t clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(sample_rate);
+    if (s_standby) {
+        /* Channel already stopped: retune it, the wake-up enables it */
+        esp_err_t ret = i2s_channel_reconfig_std_clock(i2s_tx_handle, &clk_cfg);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to reconfigure I2S clock: %s", esp_err_to_name(ret));
+        }
+        return ret;
+    }
+
+    esp_err_t ret = i2s_channel_disable(i2s_tx_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to disable I2S: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = i2s_channel_reconfig_std_clock(i2s_tx_handle, &clk_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to reconfigure I2S clock: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = i2s_channel_enable(i2s_tx_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to enable I2S: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    i2s_send_sync();
+
+    return ESP_OK;
+}
+#endif
+
+/*
+ * Ring bytes the writer may still consume at the current rate
+ * Unlimited unless a rate switch is pending; 0 once its boundary is reached.
+ */
+static size_t writer_bytes_before_switch(void)
+{
+    if (!atomic_load_explicit(&s_rate_switch_pending, memory_order_acquire)) {
+        return SIZE_MAX;
+    }
+    size_t left = atomic_load_explicit(&s_rate_switch_pos, memory_order_relaxed) -
+                  audio_ring_read_pos(&s_ring);
+    /* Free-running positions: a "negative" distance means already past it */
+    return ((ptrdiff_t)left > 0) ? left : 0;
+}
+
+static void writer_apply_rate_switch(bool output_live);
+static void writer_flush_silence(void);
+
+/*
+ * First audible frame in interleaved stereo PCM
+ *
+ * @return Frame index, or frames if the whole span is silence
+ */
+static size_t pcm_first_sound(const int16_t *pcm, size_t frames)
+{
+    for (size_t i = 0; i < frames * 2; i++) {
+        /* Unsigned compare folds |x| <= level into one test */
+        if ((uint32_t)(pcm[i] + AUDIO_STANDBY_SILENCE_LEVEL) > 2 * AUDIO_STANDBY_SILENCE_LEVEL) {
+            return i / 2;
+        }
+    }
+    return frames;
+}
+
+/*
+ * Whether output has been silent for the standby timeout
+ */
+static bool writer_standby_due(void)
+{
+    uint32_t timeout_ms = atomic_load_explicit(&s_standby_timeout_ms, memory_order_relaxed);
+    return timeout_ms != 0 &&
+           esp_timer_get_time() - s_last_sound_us >= (int64_t)timeout_ms * 1000;
+}
+
+/*
+ * Stop the I2S clocks and put the DSP in standby (output already silent)
+ */
+static void writer_enter_standby(void)
+{
+    esp_err_t ret = i2s_channel_disable(i2s_tx_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to stop I2S for standby: %s", esp_err_to_name(ret));
+        s_last_sound_us = esp_timer_get_time();     /* Retry after another timeout */
+        return;
+    }
+
+    uint8_t evt = 1;
+    ble_gatt_dsp_send_dsp_event("STANDBY", &evt, sizeof(evt));
+    s_standby = true;
+    s_standby_scanned = 0;
+    audio_metrics_on_standby(true);
+    ESP_LOGI(TAG, "Output silent for %lu s, I2S in standby",
+             (unsigned long)(atomic_load_explicit(&s_standby_timeout_ms,
+                                                  memory_order_relaxed) / 1000));
+}
+
+/*
+ * Wake the DSP and restart the I2S clocks
+ * The wake line is queued first so it leaves while the clocks (and, on a
+ * resumed stream, the pre-buffer) are still starting. The UART sender runs
+ * once the writer blocks, so the line can trail the clock restart by a few
+ * ms. What plays first is the silent cushion, never the audible packet.
+ */
+static void writer_exit_standby(void)
+{
+    s_wake_us = esp_timer_get_time();
+
+    uint8_t evt = 0;
+    ble_gatt_dsp_send_dsp_event("STANDBY", &evt, sizeof(evt));
+
+    esp_err_t ret = i2s_channel_enable(i2s_tx_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to restart I2S after standby: %s", esp_err_to_name(ret));
+    } else {
+        i2s_send_sync();
+    }
+#ifdef I2S_DMA_CALLBACK_FEED
+    /* Entries queued before the stop are stale; on_sent refills the queue */
+    xQueueReset(s_dma_free_queue);
+#endif
+    s_standby = false;
+    s_last_sound_us = s_wake_us;
+    audio_metrics_on_standby(false);
+    atomic_store_explicit(&s_asrc_reset_pending, true, memory_order_release);
+    atomic_store_explicit(&s_latency_dirty, true, memory_order_relaxed);
+    ESP_LOGI(TAG, "Audio resumed, I2S out of standby");
+}
+
+/*
+ * Apply A2DP stream events posted since the last call (writer task)
+ * A suspend and a start in the same interval mean the stream is running
+ * again. A disconnect always drops what is buffered: it belongs to a
+ * connection that is gone.
+ */
+static void writer_take_stream_events(void)
+{
+    uint32_t events = atomic_exchange_explicit(&s_stream_events, 0, memory_order_acquire);
+    if (events == 0) {
+        return;
+    }
+
+    if (events & STREAM_EVT_DISCONNECTED) {
+        size_t len = audio_ring_read_discard(&s_ring, audio_ring_fill(&s_ring));
+        s_standby_scanned = 0;
+        ESP_LOGI(TAG, "Stream disconnected, dropped %lu buffered bytes", (unsigned long)len);
+    }
+
+    bool stop = (events & STREAM_EVT_DISCONNECTED) ||
+                ((events & STREAM_EVT_SUSPENDED) && !(events & STREAM_EVT_STARTED));
+
+    if (s_writer_state == WRITER_PLAYING && stop) {
+        s_writer_state = WRITER_STOPPING;
+        ESP_LOGI(TAG, "Stream stopping, playing out %lu buffered bytes",
+                 (unsigned long)audio_ring_fill(&s_ring));
+    } else if (s_writer_state == WRITER_STOPPING && !stop && (events & STREAM_EVT_STARTED)) {
+        s_writer_state = WRITER_PLAYING;
+        ESP_LOGI(TAG, "Stream restarted before the fade-out, carrying on");
+    }
+}
+
+/*
+ * Block the writer until the ring holds at least min_fill bytes
+ * The producer only notifies once min_fill is crossed, so a pre-buffer
+ * wait costs one wakeup rather than one per packet. The waiting flag is
+ * raised before re-checking the ring, so a packet that lands in between
+ * still leaves a pending notification behind. Stream events also wake the
+ * writer, and the wait is bounded so timeouts are still checked.
+ */
+static void writer_wait_for_data(size_t min_fill)
+{
+    atomic_store_explicit(&s_writer_wake_fill, min_fill, memory_order_relaxed);
+    atomic_store_explicit(&s_writer_waiting, true, memory_order_seq_cst);
+    if (audio_ring_fill(&s_ring) < min_fill) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WRITER_IDLE_WAIT_MS));
+    }
+    atomic_store_explicit(&s_writer_waiting, false, memory_order_relaxed);
+}
+
+/*
+ * Look for audible data in the ring while in standby
+ * New data is scanned once; silence in front of it is discarded down to a
+ * jitter target's worth, so a source streaming zeros neither fills the ring
+ * nor delays the first audible packet beyond the usual cushion.
+ *
+ * @return true if the ring holds audible data
+ */
+static bool writer_standby_scan(void)
+{
+    size_t fill = audio_ring_fill(&s_ring);
+    bool sound = false;
+
+    while (!sound && s_standby_scanned + I2S_FRAME_BYTES <= fill) {
+        size_t len = fill - s_standby_scanned;
+        const uint8_t *span = audio_ring_read_peek_at(&s_ring, s_standby_scanned, &len);
+        size_t frames = len / I2S_FRAME_BYTES;
+        if (span == NULL || frames == 0) {
+            break;      /* Odd bytes at the wrap: the next packet completes them */
+        }
+        size_t first = pcm_first_sound((const int16_t *)span, frames);
+        s_standby_scanned += first * I2S_FRAME_BYTES;
+        sound = first < frames;
+    }
+
+    size_t target = jitter_buffer_get_target_bytes() & ~(size_t)(I2S_FRAME_BYTES - 1);
+    if (s_standby_scanned > target) {
+        /* Old-rate silence only: the boundary must still be reached by reading */
+        size_t len = s_standby_scanned - target;
+        size_t limit = writer_bytes_before_switch();
+        if (len > limit) {
+            len = limit;
+        }
+        s_standby_scanned -= audio_ring_read_discard(&s_ring, len);
+    }
+
+    return sound;
+}
+
+/*
+ * Wait until the ring holds the current jitter-buffer target
+ * The target may move while we wait (e.g. a bursty start), so re-read it.
+ * Output is silent throughout, so this is also where the writer idles into
+ * standby and wakes from it.
+ */
+static void writer_prebuffer(void)
+{
+    /* No stream audio in flight: scheduled changes apply at once */
+    atomic_store_explicit(&s_sched_lead_frames, 0, memory_order_relaxed);
+
+    ESP_LOGI(TAG, "Waiting for pre-buffer (%lu bytes / ~%lu ms, jitter %lu us)...",
+             (unsigned long)jitter_buffer_get_target_bytes(),
+             (unsigned long)jitter_buffer_get_target_ms(),
+             (unsigned long)jitter_buffer_get_jitter_us());
+
+    while (1) {
+        /* Output is silent: only a disconnect (stale ring) matters here */
+        writer_take_stream_events();
+
+        /* A test signal does not wait for the stream */
+        if (signal_gen_is_active()) {
+            if (s_standby) {
+                writer_exit_standby();
+            }
+            return;
+        }
+
+        /* Restart the clocks on the first audible packet, so the DSP is
+         * awake by the time the cushion is full; otherwise idle into standby */
+        if (s_standby) {
+            if (writer_standby_scan()) {
+                writer_exit_standby();
+            }
+        } else if (writer_standby_due()) {
+            writer_enter_standby();
+        }
+
+        /* Output is silent here, so a rate boundary can be taken right away */
+        if (writer_bytes_before_switch() == 0) {
+            writer_apply_rate_switch(false);
+        }
+
+        /* Likewise a routing or local DSP change needs no fade */
+        if (audio_route_pending()) {
+            audio_route_commit();
+        }
+        if (local_dsp_pending()) {
+            local_dsp_commit();
+            ble_gatt_dsp_post_status_notify();
+        }
+
+        size_t fill = audio_ring_fill(&s_ring);
+        if (s_standby) {
+            /* Any new packet may be the audible one */
+            writer_wait_for_data(fill + I2S_FRAME_BYTES);
+            continue;
+        }
+        if (fill >= jitter_buffer_get_target_bytes()) {
+            ESP_LOGI(TAG, "Pre-buffer filled (%lu bytes), starting I2S output",
+                     (unsigned long)fill);
+#ifdef I2S_DMA_CALLBACK_FEED
+            /* Buffers queued while we waited may be about to go out again;
+             * only fill ones freed from here on */
+            xQueueReset(s_dma_free_queue);
+#else
+            /* Every descriptor but the playing one is free by now: filling
+             * them from the ring would take more than the cushion at once.
+             * Queue silence instead, so the writer starts paced by the DMA
+             * with the cushion intact (the depth latency_for_fill() counts) */
+            writer_flush_silence();
+#endif
+            /* Cushion rebuilt (possibly at a new rate): report afresh */
+            atomic_store_explicit(&s_latency_dirty, true, memory_order_relaxed);
+            return;
+        }
+        writer_wait_for_data(jitter_buffer_get_target_bytes());
+    }
+}
+
+/*
+ * Pull ring data through the ASRC until dst holds the requested frames
+ * Runs over at most two contiguous ring spans per call when the data wraps.
+ *
+ * @return Frames produced (short only if the ring ran dry)
+ */
+static size_t writer_pull_asrc(int16_t *dst, size_t frames)
+{
+    size_t out_frames = 0;
+
+    while (out_frames < frames) {
+        /* Never read past a pending rate boundary */
+        size_t len = writer_bytes_before_switch();
+        if (len > s_ring.capacity) {
+            len = s_ring.capacity;
+        }
+        const uint8_t *span = audio_ring_read_peek(&s_ring, &len);
+        if (span == NULL || len < I2S_FRAME_BYTES) {
+            break;
+        }
+
+#if CONFIG_SPIRAM
+        /* One sequential burst out of PSRAM; the ASRC's scattered reads
+         * then hit internal RAM instead of the external-memory cache */
+        if (s_ring_external) {
+            if (len > sizeof(s_ring_stage)) {
+                len = sizeof(s_ring_stage);
+            }
+            memcpy(s_ring_stage, span, len);
+            span = s_ring_stage;
+        }
+#endif
+
+        size_t in_used = 0;
+        out_frames += asrc_process(&s_asrc, (const int16_t *)span, len / I2S_FRAME_BYTES,
+                                   &in_used, &dst[out_frames * 2], frames - out_frames);
+
+        /* Clipping is judged on the source PCM, before resampling or gain */
+        if (audio_clip_scan((const int16_t *)span, in_used)) {
+            ESP_LOGW(TAG, "Source clipping detected (%lu runs)",
+                     (unsigned long)audio_clip_get_events());
+            ble_gatt_dsp_post_status_notify();
+        }
+        audio_ring_read_release(&s_ring, in_used * I2S_FRAME_BYTES);
+    }
+
+    return out_frames;
+}
+
+/*
+ * Produce one output block at the I2S rate
+ *
+ * @param dst Output block, s_block_frames frames
+ * @return Output frames produced (short only if the ring ran dry)
+ */
+static size_t writer_fill_block(int16_t *dst)
+{
+#ifdef I2S_FIXED_OUTPUT_RATE
+    size_t out_frames = 0;
+
+    while (out_frames < s_block_frames) {
+        if (s_mid_len == 0) {
+            s_mid_pos = 0;
+            s_mid_len = writer_pull_asrc(s_mid_block, s_block_frames);
+            if (s_mid_len == 0) {
+                break;
+            }
+        }
+
+        size_t used = 0;
+        out_frames += src_polyphase_process(&s_src, &s_mid_block[s_mid_pos * 2], s_mid_len,
+                                            &used, &dst[out_frames * 2],
+                                            s_block_frames - out_frames);
+        s_mid_pos += used;
+        s_mid_len -= used;
+    }
+
+    return out_frames;
+#else
+    return writer_pull_asrc(dst, s_block_frames);
+#endif
+}
+
+/*
+ * Get the next output block to fill
+ * Callback feed: the oldest DMA buffer freed by on_sent (blocks until one
+ * is free). Otherwise: the staging block for i2s_channel_write().
+ */
+static void *writer_acquire_block(void)
+{
+#ifdef I2S_DMA_CALLBACK_FEED
+    void *buf = NULL;
+    xQueueReceive(s_dma_free_queue, &buf, portMAX_DELAY);
+    return buf;
+#else
+    return s_out_block;
+#endif
+}
+
+/*
+ * 16-bit block the writer builds an output block in
+ * 16-bit output: the output block itself. 32-bit: a staging block.
+ */
+static inline int16_t *writer_pcm_block(void *out)
+{
+#ifdef I2S_32BIT_OUTPUT
+    (void)out;
+    return s_pcm_block;
+#else
+    return (int16_t *)out;
+#endif
+}
+
+/*
+ * Apply routing, the local DSP engine and the gain stage, widening into
+ * the output block in 32-bit mode (the spectrum sees it before the gain)
+ */
+static void writer_finish_block(int16_t *pcm, void *out)
+{
+    audio_route_process(pcm, s_block_frames);
+#ifdef I2S_32BIT_OUTPUT
+    /* The engine hands over its 24-bit result, not a 16-bit rounding */
+    bool wide = local_dsp_process_wide(pcm, (int32_t *)out, s_block_frames,
+                                       i2s_output_rate());
+    spectrum_feed(pcm, s_block_frames, i2s_output_rate());
+
+    /* Trim is a gain too: widen first so it keeps the low bits */
+    if (!wide && audio_route_trim_active()) {
+        audio_gain_widen(pcm, (int32_t *)out, s_block_frames * 2);
+        wide = true;
+    }
+    if (wide) {
+        audio_route_trim_wide((int32_t *)out, s_block_frames);
+        audio_gain_process_32((int32_t *)out, s_block_frames, i2s_output_rate());
+    } else {
+        audio_gain_process_wide(pcm, (int32_t *)out, s_block_frames, i2s_output_rate());
+    }
+#else
+    (void)out;
+    local_dsp_process(pcm, s_block_frames, i2s_output_rate());
+    spectrum_feed(pcm, s_block_frames, i2s_output_rate());
+    audio_gain_process(pcm, s_block_frames, i2s_output_rate());
+#endif
+}
+
+/*
+ * Pass a block to the output without routing or gain (test signals are
+ * bit-exact)
+ */
+static void writer_finish_block_raw(int16_t *pcm, void *out)
+{
+    spectrum_feed(pcm, s_block_frames, i2s_output_rate());
+#ifdef I2S_32BIT_OUTPUT
+    audio_gain_widen(pcm, (int32_t *)out, s_block_frames * 2);
+#else
+    (void)out;
+#endif
+}
+
+/*
+ * Hand a filled block to I2S
+ * Callback feed: nothing to do, the data already sits in the DMA buffer.
+ */
+static void writer_submit_block(void *block)
+{
+    size_t bytes_written = s_block_frames * I2S_SLOT_FRAME_BYTES;
+#ifndef I2S_DMA_CALLBACK_FEED
+    i2s_channel_write(i2s_tx_handle, block, s_block_frames * I2S_SLOT_FRAME_BYTES,
+                      &bytes_written, portMAX_DELAY);
+#else
+    (void)block;
+#endif
+    audio_metrics_on_i2s_write(bytes_written);
+
+    if (audio_capture_is_recording()) {
+        audio_capture_block(block, s_block_frames, i2s_output_rate(),
+                            (uint32_t)audio_ring_fill(&s_ring), (uint8_t)s_writer_state,
+                            s_submit_flags);
+    }
+    s_submit_flags = 0;
+}
+
+/*
+ * Fill every DMA buffer with silence, so nothing queued is cut off mid-descriptor
+ */
+static void writer_flush_silence(void)
+{
+    for (size_t i = 0; i < s_dma_desc_num; i++) {
+        void *block = writer_acquire_block();
+        memset(block, 0, s_block_frames * I2S_SLOT_FRAME_BYTES);
+        s_submit_flags = AUDIO_CAPTURE_FLAG_FADE;
+        writer_submit_block(block);
+    }
+}
+
+/*
+ * Fade the output out from recent audio, without cutting mid-waveform
+ */
+static void writer_fade_out(void)
+{
+    bool silent = false;
+    while (!silent) {
+        void *out = writer_acquire_block();
+        int16_t *pcm = writer_pcm_block(out);
+        silent = audio_conceal_fade_out(pcm, s_block_frames);
+        writer_finish_block(pcm, out);
+        s_submit_flags = AUDIO_CAPTURE_FLAG_FADE;
+        writer_submit_block(out);
+    }
+}
+
+/*
+ * Switch to the pending stream rate at its ring boundary
+ * Old-rate audio has played out and faded by now. Fill every DMA buffer
+ * with silence first so nothing old-rate is cut off mid-descriptor, then
+ * tell the DSP and reclock, so both change rate at the same instant.
+ *
+ * @param output_live true if I2S may still hold queued audio
+ */
+static void writer_apply_rate_switch(bool output_live)
+{
+    atomic_exchange_explicit(&s_rate_switch_pending, false, memory_order_acquire);
+    uint32_t rate = atomic_load_explicit(&s_rate_switch_rate, memory_order_relaxed);
+
+    if (output_live) {
+        writer_flush_silence();
+    }
+
+#ifdef I2S_FIXED_OUTPUT_RATE
+    ESP_LOGI(TAG, "Stream rate now %lu Hz, resampling to %d Hz",
+             (unsigned long)rate, I2S_SAMPLE_RATE);
+#else
+    uint8_t evt[4] = {
+        (uint8_t)rate, (uint8_t)(rate >> 8), (uint8_t)(rate >> 16), (uint8_t)(rate >> 24)
+    };
+    /* Queued, not written: the line trails the reclock by a few ms, while
+     * the output is still silent behind the new pre-buffer */
+    ble_gatt_dsp_send_dsp_event("RATE", evt, sizeof(evt));
+    i2s_reclock(rate);
+#endif
+
+    s_play_rate = rate;
+    atomic_store_explicit(&s_asrc_reset_pending, true, memory_order_release);
+}
+
+/*
+ * Apply the overflow policy to the current ring fill (writer task)
+ * Drop-oldest skips back to mid-margin in one step (down to the target
+ * itself, the packet saw-tooth underruns the next blocks) and the ASRC
+ * steers the rest; time-compress plays fast from the high-water mark until
+ * the fill is back on target.
+ *
+ * @param fill Ring fill in bytes
+ * @param target Jitter-buffer target in bytes
+ * @return true while time-compressing (ASRC steering is overridden)
+ */
+static bool writer_handle_overflow(size_t fill, size_t target)
+{
+    size_t high = target + (size_t)s_play_rate * OVERFLOW_MARGIN_MS / 1000 * I2S_FRAME_BYTES;
+    size_t limit = atomic_load_explicit(&s_ring_limit, memory_order_relaxed);
+    if (high > limit / 8 * 7) {
+        high = limit / 8 * 7;
+    }
+
+    switch (atomic_load_explicit(&s_overflow_policy, memory_order_relaxed)) {
+    case AUDIO_OVERFLOW_DROP_OLDEST:
+        s_compressing = false;
+        size_t mid = (high > target) ? target + (high - target) / 2 : target;
+        if (fill > high && fill > mid) {
+            size_t len = (fill - mid) & ~(size_t)(I2S_FRAME_BYTES - 1);
+            /* Old-rate audio only: the boundary must still be reached by reading */
+            size_t switch_limit = writer_bytes_before_switch();
+            if (len > switch_limit) {
+                len = switch_limit;
+            }
+            len = audio_ring_read_discard(&s_ring, len);
+            if (len > 0) {
+                audio_metrics_on_skip((uint32_t)len);
+            }
+        }
+        return false;
+
+    case AUDIO_OVERFLOW_TIME_COMPRESS:
+        if (fill > high) {
+            s_compressing = true;
+        } else if (fill <= target) {
+            s_compressing = false;
+        }
+        if (s_compressing) {
+            asrc_set_ppm(&s_asrc, OVERFLOW_COMPRESS_PPM);
+            audio_metrics_on_compress((uint32_t)((uint64_t)s_block_frames * 1000000 /
+                                                 i2s_output_rate()));
+        }
+        return s_compressing;
+
+    default:
+        s_compressing = false;
+        return false;
+    }
+}
+
+/*
+ * End-to-end latency for a given ring fill: ring + queued DMA + DSP
+ */
+static uint32_t latency_for_fill(size_t fill)
+{
+    uint64_t ring_frames = fill / I2S_FRAME_BYTES;
+    uint64_t dma_frames = (uint64_t)s_dma_desc_num * s_block_frames;
+    return (uint32_t)(ring_frames * 1000000 / s_play_rate +
+                      dma_frames * 1000000 / i2s_output_rate()) +
+           atomic_load_explicit(&s_dsp_latency_us, memory_order_relaxed);
+}
+
+/*
+ * Deliver a latency report on the FreeRTOS timer task
+ * The callback ends in the Bluetooth stack (esp_a2d_sink_set_delay_value()),
+ * which may block on its own queues: never called from the writer.
+ */
+static void pended_latency_report(void *arg, uint32_t latency_us)
+{
+    (void)arg;
+    audio_latency_cb_t cb = s_latency_cb;
+    if (cb != NULL) {
+        cb(latency_us);
+    }
+}
+
+/*
+ * Update the output latency estimate and report it when it has moved
+ * Reports immediately after a re-buffer, rate switch, target or DSP latency
+ * change; otherwise only past LATENCY_REPORT_STEP_US, at most once per
+ * LATENCY_REPORT_INTERVAL_US, so the source is not flooded with updates.
+ *
+ * @param fill Ring fill in bytes
+ */
+static void writer_update_latency(size_t fill)
+{
+    static uint32_t fill_avg;           /* Bytes << LATENCY_FILL_SHIFT */
+    static size_t last_target;
+    static uint32_t last_reported;
+    static int64_t last_report_us;
+
+    bool force = false;
+    size_t target = jitter_buffer_get_target_bytes();
+    if (target != last_target) {
+        last_target = target;
+        force = true;
+    }
+    if (atomic_exchange_explicit(&s_latency_dirty, false, memory_order_relaxed)) {
+        force = true;
+    }
+
+    if (force) {
+        fill_avg = (uint32_t)fill << LATENCY_FILL_SHIFT;
+    } else {
+        fill_avg += (uint32_t)fill - (fill_avg >> LATENCY_FILL_SHIFT);
+    }
+
+    uint32_t latency_us = latency_for_fill(fill_avg >> LATENCY_FILL_SHIFT);
+    atomic_store_explicit(&s_latency_us, latency_us, memory_order_relaxed);
+
+    int64_t now_us = esp_timer_get_time();
+    uint32_t delta = (latency_us > last_reported) ? latency_us - last_reported :
+                                                    last_reported - latency_us;
+    if (!force && (delta < LATENCY_REPORT_STEP_US ||
+                   now_us - last_report_us < LATENCY_REPORT_INTERVAL_US)) {
+        return;
+    }
+
+    /* Timer queue full: not marked reported, so a later block retries */
+    if (s_latency_cb != NULL &&
+        xTimerPendFunctionCall(pended_latency_report, NULL, latency_us, 0) != pdPASS) {
+        return;
+    }
+    last_reported = latency_us;
+    last_report_us = now_us;
+    ESP_LOGD(TAG, "Output latency %lu us", (unsigned long)latency_us);
+}
+
+/*
+ * Publish where audio entering the ring now will play, relative to the
+ * output frame clock: behind the DMA ring (the block just written plays
+ * after the descriptors ahead of it) and behind the ring at the output
+ * rate. Good to about one DMA block, as the count moves per descriptor.
+ *
+ * @param fill Ring fill in bytes
+ */
+static void writer_update_schedule(size_t fill)
+{
+    uint64_t ring_frames = (uint64_t)(fill / I2S_FRAME_BYTES) * i2s_output_rate() / s_play_rate;
+    uint32_t lead = (uint32_t)(s_dma_desc_num * s_block_frames + ring_frames);
+    atomic_store_explicit(&s_sched_lead_frames, lead, memory_order_relaxed);
+}
+
+/*
+ * Whether the deep profile can run: its ring needs PSRAM
+ * Before audio_pipeline_init() this asks the heap; afterwards it is the
+ * ring that was actually allocated.
+ */
+static bool deep_ring_available(void)
+{
+    if (s_ring.buf != NULL) {
+        return s_ring.capacity >= DEEP_RINGBUF_SIZE;
+    }
+#if CONFIG_SPIRAM
+    return heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM) >= DEEP_RINGBUF_SIZE;
+#else
+    return false;
+#endif
+}
+
+/*
+ * Take a profile's DMA layout and jitter bounds (I2S not running)
+ */
+static void profile_load(audio_profile_t profile)
+{
+    const audio_profile_cfg_t *cfg = &s_profiles[profile];
+
+    s_profile = profile;
+    s_dma_desc_num = cfg->dma_desc_num;
+    s_block_frames = cfg->dma_frame_num;
+    jitter_buffer_set_bounds(cfg->jb_min_ms, cfg->jb_default_ms, cfg->jb_max_ms);
+
+    size_t limit = cfg->ring_bytes;
+    if (s_ring.buf != NULL && limit > s_ring.capacity) {
+        limit = s_ring.capacity;
+    }
+    atomic_store_explicit(&s_ring_limit, limit, memory_order_relaxed);
+    audio_metrics_set_fill_scale(limit);
+}
+
+/*
+ * Switch audio profile while running (writer task)
+ * Fades out on the recent output rather than cutting mid-waveform, flushes
+ * the DMA with silence, then rebuilds the I2S channel with the new layout.
+ * Ring audio is left in place for the writer to resume from. If the new
+ * layout cannot be set up, the previous one is restored; the writer never
+ * carries on without a channel.
+ */
+static void writer_apply_profile(audio_profile_t profile)
+{
+    audio_profile_t previous = s_profile;
+
+    ESP_LOGI(TAG, "Audio profile %s -> %s", s_profiles[previous].name,
+             s_profiles[profile].name);
+
+    writer_fade_out();
+    writer_flush_silence();
+
+    esp_err_t ret = i2s_channel_disable(i2s_tx_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to stop I2S channel: %s", esp_err_to_name(ret));
+        return;                     /* Still running on the old layout */
+    }
+    ret = i2s_del_channel(i2s_tx_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to release I2S channel: %s", esp_err_to_name(ret));
+        if (i2s_channel_enable(i2s_tx_handle) == ESP_OK) {
+            i2s_send_sync();
+        }
+        return;
+    }
+    i2s_tx_handle = NULL;
+
+    profile_load(profile);
+
+    /* Leaving the deep profile: keep only the new profile's start target,
+     * or the writer would play seconds of stale audio at the new latency */
+    size_t fill = audio_ring_fill(&s_ring);
+    size_t keep = (size_t)s_play_rate * s_profiles[profile].jb_default_ms / 1000 *
+                  I2S_FRAME_BYTES;
+    if (fill > atomic_load_explicit(&s_ring_limit, memory_order_relaxed) && fill > keep) {
+        size_t len = fill - keep;
+        size_t limit = writer_bytes_before_switch();
+        if (len > limit) {
+            len = limit;
+        }
+        len = audio_ring_read_discard(&s_ring, len);
+        ESP_LOGI(TAG, "Dropped %lu bytes above the %s ring limit", (unsigned long)len,
+                 s_profiles[profile].name);
+    }
+
+    if (i2s_init() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to recreate I2S for profile %s, back to %s",
+                 s_profiles[profile].name, s_profiles[previous].name);
+        profile_load(previous);
+        /* The old layout ran before, so this is a transient driver failure
+         * (e.g. no DMA memory): keep retrying rather than write to no channel */
+        while (i2s_init() != ESP_OK) {
+            vTaskDelay(pdMS_TO_TICKS(I2S_REINIT_RETRY_MS));
+        }
+    }
+
+#ifdef I2S_FIXED_OUTPUT_RATE
+    s_mid_len = 0;
+#endif
+    atomic_store_explicit(&s_asrc_reset_pending, true, memory_order_release);
+}
+
+/*
+ * Play one block of the test signal in place of the stream
+ * Entering from a playing stream fades it out first. A2DP data keeps
+ * arriving and is discarded, so none of it is stale when the signal stops
+ * and the writer pre-buffers afresh.
+ */
+static void writer_play_signal(void)
+{
+    if (s_writer_state != WRITER_SIGNAL) {
+        if (s_writer_state != WRITER_PREBUFFER) {
+            writer_fade_out();
+        }
+        s_writer_state = WRITER_SIGNAL;
+        s_wake_us = 0;              /* Not a stream wake-up */
+        atomic_store_explicit(&s_sched_lead_frames, 0, memory_order_relaxed);
+        ESP_LOGI(TAG, "Test signal on, A2DP audio discarded");
+    }
+
+    void *out = writer_acquire_block();
+    int16_t *pcm = writer_pcm_block(out);
+    bool active = signal_gen_process(pcm, s_block_frames, i2s_output_rate());
+    audio_meter_process(pcm, s_block_frames, i2s_output_rate());
+    writer_finish_block_raw(pcm, out);
+    s_submit_flags = AUDIO_CAPTURE_FLAG_SIGNAL;
+    writer_submit_block(out);
+    s_last_sound_us = esp_timer_get_time();     /* No standby during a test */
+
+    audio_ring_read_discard(&s_ring, audio_ring_fill(&s_ring));
+
+    if (!active) {
+        ESP_LOGI(TAG, "Test signal off, back to A2DP");
+        atomic_store_explicit(&s_asrc_reset_pending, true, memory_order_release);
+        s_writer_state = WRITER_PREBUFFER;
+    }
+}
+
+/*
+ * Publish writer CPU time per second of output audio
+ * Uses the FreeRTOS run-time counter, so time blocked in the driver or on
+ * the queue is excluded and the driver's own copy (if any) is included.
+ */
+static void writer_account_cpu(size_t frames)
+{
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    static uint32_t window_frames;
+    static configRUN_TIME_COUNTER_TYPE window_start;
+
+    window_frames += frames;
+    uint32_t rate = i2s_output_rate();
+    if (window_frames < rate * WRITER_CPU_WINDOW_MS / 1000) {
+        return;
+    }
+
+    configRUN_TIME_COUNTER_TYPE now = ulTaskGetRunTimeCounter(NULL);
+    if (window_start != 0) {
+        uint64_t us = (uint64_t)(now - window_start) * rate / window_frames;
+        audio_metrics_set_writer_cpu_us((uint32_t)us);
+        ESP_LOGD(TAG, "Writer CPU %lu us per second of audio", (unsigned long)us);
+    }
+    window_start = now;
+    window_frames = 0;
+#else
+    (void)frames;
+#endif
+}
+
+/*
+ * I2S writer task — pinned to Core 1
+ * Pre-buffers audio data, then writes continuously to keep DMA always fed.
+ * This eliminates DMA underruns that cause crackling.
+ */
+static void i2s_writer_task(void *arg)
+{
+    ESP_LOGI(TAG, "I2S writer task started on Core %d", xPortGetCoreID());
+
+    /* Standby timeout counts from boot until the first audio */
+    s_last_sound_us = esp_timer_get_time();
+
+    /* Resample one DMA descriptor's worth per iteration, then steer the
+     * ratio from how far the ring fill sits from the jitter target. */
+    uint32_t log_blocks = 0;
+    while (1) {
+        writer_take_stream_events();
+
+        /* Test signal in place of the stream (diagnostics) */
+        if (signal_gen_is_active()) {
+            writer_play_signal();
+            continue;
+        }
+
+        /* Wait until the ring holds the target, so the stream starts without
+         * an immediate underrun */
+        if (s_writer_state == WRITER_PREBUFFER) {
+            writer_prebuffer();
+            if (signal_gen_is_active()) {
+                continue;
+            }
+            s_writer_state = WRITER_PLAYING;
+        }
+
+        int profile = atomic_exchange_explicit(&s_profile_pending, -1, memory_order_acquire);
+        if (profile >= 0 && profile != (int)s_profile) {
+            writer_apply_profile((audio_profile_t)profile);
+            s_writer_state = WRITER_PREBUFFER;
+            continue;
+        }
+
+        /* Swap, mono and delay reshape the signal: fade out on the old
+         * routing, switch, and let concealment ramp the stream back in */
+        if (audio_route_pending()) {
+            writer_fade_out();
+            audio_route_commit();
+        }
+
+        /* Same for local DSP EQ changes and the engine starting or stopping
+         * (AUTO mode follows the STM32 coming and going) */
+        if (local_dsp_pending()) {
+            writer_fade_out();
+            local_dsp_commit();
+            ble_gatt_dsp_post_status_notify();
+        }
+
+        if (atomic_exchange_explicit(&s_asrc_reset_pending, false, memory_order_acquire)) {
+            asrc_reset(&s_asrc);
+            audio_clip_reset();
+            s_compressing = false;
+            audio_conceal_reset(i2s_output_rate());
+#ifdef I2S_FIXED_OUTPUT_RATE
+            s_mid_len = 0;
+            src_polyphase_configure(&s_src, s_play_rate, I2S_SAMPLE_RATE);
+#endif
+        }
+
+        /* A short block is completed by concealment, so I2S always gets
+         * a whole block and never jumps straight to zero. At the end of a
+         * stream the tail is faded instead, without counting an underrun. */
+        void *out = writer_acquire_block();
+        int16_t *pcm = writer_pcm_block(out);
+        size_t frames = writer_fill_block(pcm);
+        bool silent;
+        if (s_writer_state == WRITER_STOPPING && frames < s_block_frames) {
+            audio_conceal_process(pcm, frames, frames);
+            silent = audio_conceal_fade_out(&pcm[frames * 2], s_block_frames - frames);
+            s_submit_flags = AUDIO_CAPTURE_FLAG_FADE;
+        } else {
+            silent = audio_conceal_process(pcm, frames, s_block_frames);
+            if (frames < s_block_frames) {
+                /* Running dry at a rate boundary is planned, not an underrun */
+                s_submit_flags = (writer_bytes_before_switch() == 0) ?
+                                 AUDIO_CAPTURE_FLAG_FADE : AUDIO_CAPTURE_FLAG_CONCEALED;
+            }
+        }
+        audio_meter_process(pcm, s_block_frames, i2s_output_rate());
+        if (pcm_first_sound(pcm, s_block_frames) < s_block_frames) {
+            s_last_sound_us = esp_timer_get_time();
+        }
+        writer_finish_block(pcm, out);
+        writer_submit_block(out);
+
+        if (s_wake_us != 0) {
+            audio_metrics_on_wake((uint32_t)(esp_timer_get_time() - s_wake_us));
+            s_wake_us = 0;
+        }
+        if (s_sync_pending) {
+            i2s_queue_sync();
+        }
+        writer_account_cpu(s_block_frames);
+        audio_metrics_report_overflow();
+
+        if (frames < s_block_frames) {
+            /* Stream over and faded: start the next one from scratch */
+            if (s_writer_state == WRITER_STOPPING) {
+                if (silent) {
+                    ESP_LOGI(TAG, "Stream stopped, output faded out");
+                    atomic_store_explicit(&s_asrc_reset_pending, true, memory_order_release);
+                    s_writer_state = WRITER_PREBUFFER;
+                }
+                continue;
+            }
+
+            /* Old-rate audio ended at a rate boundary: keep fading, then
+             * switch and pre-buffer at the new rate */
+            if (writer_bytes_before_switch() == 0) {
+                if (silent) {
+                    writer_apply_rate_switch(true);
+                    s_writer_state = WRITER_PREBUFFER;
+                }
+                continue;
+            }
+
+            /* Short gaps are bridged by the repeat; once faded out, rebuild
+             * the cushion at the (possibly raised) target */
+            if (silent) {
+                ESP_LOGW(TAG, "Ring underrun, faded out, re-buffering (%lu concealments)",
+                         (unsigned long)audio_conceal_get_events());
+                audio_metrics_on_underrun();
+                s_writer_state = WRITER_PREBUFFER;
+            }
+            continue;
+        }
+
+        /* Source streaming silence: stop the clocks until it has sound again */
+        if (writer_standby_due()) {
+            writer_enter_standby();
+            s_writer_state = WRITER_PREBUFFER;
+            continue;
+        }
+
+        size_t fill = audio_ring_fill(&s_ring);
+        size_t target = jitter_buffer_get_target_bytes();
+        audio_metrics_on_fill(fill);
+        writer_update_latency(fill);
+        writer_update_schedule(fill);
+
+        if (writer_handle_overflow(fill, target)) {
+            continue;
+        }
+
+        int32_t fill_error = ((int32_t)fill - (int32_t)target) / I2S_FRAME_BYTES;
+        int32_t ppm = asrc_steer(&s_asrc, fill_error, frames, i2s_output_rate());
+
+        if (++log_blocks >= ASRC_LOG_BLOCKS) {
+            log_blocks = 0;
+            ESP_LOGD(TAG, "ASRC %+ld ppm (fill error %ld frames)", (long)ppm, (long)fill_error);
+        }
+    }
+}
+
+/*
+ * Public API Implementation
+ */
+
+esp_err_t audio_pipeline_init(void)
+{
+    void *storage = NULL;
+    size_t capacity = RINGBUF_SIZE;
+
+#if CONFIG_SPIRAM
+    /* Deep ring in PSRAM if this module has it (WROVER); CONFIG_SPIRAM
+     * builds also boot on modules without, where the size reads as 0 */
+    if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0) {
+        storage = heap_caps_malloc(DEEP_RINGBUF_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (storage != NULL) {
+            capacity = DEEP_RINGBUF_SIZE;
+            s_ring_external = true;
+        } else {
+            ESP_LOGW(TAG, "No room for the %d byte deep ring in PSRAM", DEEP_RINGBUF_SIZE);
+        }
+    }
+#endif
+
+    /* Otherwise internal RAM (shared with Bluedroid, keep it modest) */
+    if (storage == NULL) {
+        storage = heap_caps_malloc(RINGBUF_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (storage == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate %d byte audio ring", RINGBUF_SIZE);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    esp_err_t ret = audio_ring_init(&s_ring, storage, capacity);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to init audio ring: %s", esp_err_to_name(ret));
+        heap_caps_free(storage);
+        return ret;
+    }
+    ESP_LOGI(TAG, "Audio ring: %lu bytes in %s RAM", (unsigned long)capacity,
+             (capacity > RINGBUF_SIZE) ? "PSRAM" : "internal");
+
+    /* A deep profile restored from NVS needs the PSRAM ring */
+    if (s_profile == AUDIO_PROFILE_DEEP && !deep_ring_available()) {
+        ESP_LOGW(TAG, "No PSRAM for the deep profile, using %s",
+                 s_profiles[AUDIO_PROFILE_ROBUST].name);
+        profile_load(AUDIO_PROFILE_ROBUST);
+    } else {
+        profile_load(s_profile);    /* Ring limit against the real capacity */
+    }
+
+    jitter_buffer_reset(s_current_sample_rate);
+    audio_metrics_reset(atomic_load_explicit(&s_ring_limit, memory_order_relaxed));
+    a2dp_trace_arm(s_current_sample_rate);
+
+#ifdef I2S_DMA_CALLBACK_FEED
+    s_dma_free_queue = xQueueCreate(I2S_DMA_DESC_MAX, sizeof(void *));
+    if (s_dma_free_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create DMA buffer queue");
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+
+#ifdef I2S_FIXED_OUTPUT_RATE
+    ret = src_polyphase_init(&s_src);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+#endif
+
+    return i2s_init();
+}
+
+esp_err_t audio_pipeline_start(void)
+{
+    BaseType_t ok = xTaskCreatePinnedToCore(i2s_writer_task, "i2s_writer", WRITER_TASK_STACK_SIZE,
+                                            NULL, WRITER_TASK_PRIORITY, &s_writer_task,
+                                            WRITER_TASK_CORE);
+    if (ok != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create writer task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = spectrum_init();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Spectrum analyser not started (non-fatal): %s", esp_err_to_name(ret));
+    }
+    return ESP_OK;
+}
+
+void audio_pipeline_push(const uint8_t *data, uint32_t len)
+{
+    if (s_ring.buf == NULL || data == NULL || len == 0) {
+        return;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    a2dp_trace_record(now_us, len);
+
+    /* The ring and the ASRC work in whole frames */
+    len &= ~(uint32_t)(I2S_FRAME_BYTES - 1);
+    if (len == 0) {
+        return;
+    }
+
+    jitter_buffer_on_packet(now_us, len);
+    audio_metrics_on_packet(now_us);
+
+    /* Counted only: the writer reports drops once per second, a log line
+     * per packet here would stall the BTC task exactly when it is behind */
+    if (audio_ring_fill(&s_ring) + len >
+            atomic_load_explicit(&s_ring_limit, memory_order_relaxed) ||
+        !audio_ring_write(&s_ring, data, len)) {
+        audio_metrics_on_drop(len);
+        return;
+    }
+
+    /* Wake the writer only if it is sleeping and the fill it waits for is here */
+    if (atomic_load_explicit(&s_writer_waiting, memory_order_seq_cst) &&
+        audio_ring_fill(&s_ring) >= atomic_load_explicit(&s_writer_wake_fill,
+                                                         memory_order_relaxed) &&
+        atomic_exchange_explicit(&s_writer_waiting, false, memory_order_relaxed) &&
+        s_writer_task != NULL) {
+        xTaskNotifyGive(s_writer_task);
+    }
+}
+
+void audio_pipeline_stream_event(audio_stream_event_t event)
+{
+    static const uint32_t bits[] = {
+        [AUDIO_STREAM_STARTED] = STREAM_EVT_STARTED,
+        [AUDIO_STREAM_SUSPENDED] = STREAM_EVT_SUSPENDED,
+        [AUDIO_STREAM_DISCONNECTED] = STREAM_EVT_DISCONNECTED,
+    };
+    if ((unsigned)event >= sizeof(bits) / sizeof(bits[0])) {
+        return;
+    }
+
+    /* The next connection may be a different phone: learn its jitter afresh */
+    if (event == AUDIO_STREAM_DISCONNECTED) {
+        jitter_buffer_reset(s_current_sample_rate);
+    }
+
+    atomic_fetch_or_explicit(&s_stream_events, bits[event], memory_order_release);
+    if (s_writer_task != NULL) {
+        xTaskNotifyGive(s_writer_task);
+    }
+}
+
+esp_err_t audio_pipeline_set_sample_rate(uint32_t sample_rate)
+{
+    if (s_ring.buf == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (sample_rate == s_current_sample_rate) {
+        return ESP_OK;
+    }
+
+    /* Everything already in the ring is old-rate audio: mark where the new
+     * rate starts and let the writer switch there. If an earlier switch is
+     * still pending, keep its boundary so no old data plays at a new rate. */
+    if (!atomic_load_explicit(&s_rate_switch_pending, memory_order_acquire)) {
+        atomic_store_explicit(&s_rate_switch_pos, audio_ring_write_pos(&s_ring),
+                              memory_order_relaxed);
+    }
+    atomic_store_explicit(&s_rate_switch_rate, sample_rate, memory_order_relaxed);
+    atomic_store_explicit(&s_rate_switch_pending, true, memory_order_release);
+
+    ESP_LOGI(TAG, "Stream rate %lu -> %lu Hz, switching after %lu buffered bytes",
+             (unsigned long)s_current_sample_rate, (unsigned long)sample_rate,
+             (unsigned long)audio_ring_fill(&s_ring));
+
+    s_current_sample_rate = sample_rate;
+    jitter_buffer_reset(sample_rate);
+    a2dp_trace_arm(sample_rate);
+    return ESP_OK;
+}
+
+esp_err_t audio_pipeline_set_overflow_policy(audio_overflow_policy_t policy)
+{
+    if (policy > AUDIO_OVERFLOW_TIME_COMPRESS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    atomic_store_explicit(&s_overflow_policy, (int)policy, memory_order_relaxed);
+    ESP_LOGI(TAG, "Overflow policy %d", (int)policy);
+    return ESP_OK;
+}
+
+void audio_pipeline_set_standby_timeout(uint16_t seconds)
+{
+    atomic_store_explicit(&s_standby_timeout_ms, (uint32_t)seconds * 1000,
+                          memory_order_relaxed);
+    ESP_LOGI(TAG, "Standby timeout %u s%s", (unsigned)seconds, seconds ? "" : " (disabled)");
+}
+
+void audio_pipeline_set_latency_callback(audio_latency_cb_t cb)
+{
+    s_latency_cb = cb;
+}
+
+void audio_pipeline_set_dsp_latency_us(uint32_t latency_us)
+{
+    atomic_store_explicit(&s_dsp_latency_us, latency_us, memory_order_relaxed);
+    atomic_store_explicit(&s_latency_dirty, true, memory_order_relaxed);
+}
+
+uint32_t audio_pipeline_get_latency_us(void)
+{
+    uint32_t latency_us = atomic_load_explicit(&s_latency_us, memory_order_relaxed);
+    if (latency_us == 0) {
+        /* Not playing yet: the fill the writer will start at */
+        latency_us = latency_for_fill(jitter_buffer_get_target_bytes());
+    }
+    return latency_us;
+}
+
+uint32_t audio_pipeline_get_schedule_frame(void)
+{
+    return atomic_load_explicit(&s_sent_frames, memory_order_relaxed) +
+           atomic_load_explicit(&s_sched_lead_frames, memory_order_relaxed);
+}
+
+esp_err_t audio_pipeline_set_profile(audio_profile_t profile)
+{
+    if (profile >= AUDIO_PROFILE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (profile == AUDIO_PROFILE_DEEP && !deep_ring_available()) {
+        ESP_LOGW(TAG, "Audio profile %s needs PSRAM", s_profiles[profile].name);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    if (s_ring.buf == NULL) {
+        /* Not initialized yet: i2s_init() picks the layout up directly */
+        profile_load(profile);
+        ESP_LOGI(TAG, "Audio profile %s", s_profiles[profile].name);
+        return ESP_OK;
+    }
+
+    atomic_store_explicit(&s_profile_pending, (int)profile, memory_order_release);
+    return ESP_OK;
+}
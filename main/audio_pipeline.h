@@ -0,0 +1,228 @@
+/*
+ * Audio Pipeline
+ * A2DP sink PCM → lock-free ring → I2S writer task (Core 1) → STM32 DSP
+ *
+ * Owns the I2S channel, the A2DP → I2S ring and the writer task.
+ * The A2DP data callback (BTC task, Core 0) is the ring producer and the
+ * I2S writer task (Core 1) is the ring consumer.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef AUDIO_PIPELINE_H
+#define AUDIO_PIPELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* I2S GPIO Configuration (shared clocks to STM32 + PCM5102A) */
+#define I2S_BCK_PIN     GPIO_NUM_26
+#define I2S_WS_PIN      GPIO_NUM_25
+#define I2S_DATA_PIN    GPIO_NUM_22
+
+/* Uncomment to capture A2DP packet arrival traces to the console (a2dp_trace.c) */
+// #define A2DP_TRACE_CAPTURE
+
+/* Uncomment to feed I2S from the DMA on_sent callback: the writer fills each
+ * DMA buffer in place instead of copying through i2s_channel_write() */
+// #define I2S_DMA_CALLBACK_FEED
+
+/* Uncomment to apply duck and volume trim on the bridge (audio_gain.c) instead
+ * of the DSP engine; mute is always applied on the bridge as well */
+// #define AUDIO_GAIN_STAGE
+
+/* Uncomment to send 32-bit I2S slots (left-justified 16-bit audio widened
+ * before gain) so attenuation keeps full resolution; doubles I2S bandwidth
+ * and needs the DSP engine's I2S set to 32-bit too */
+// #define I2S_32BIT_OUTPUT
+
+/* With I2S_32BIT_OUTPUT: uncomment to TPDF-dither attenuated audio down to
+ * the I2S_DITHER_BITS word the DSP engine keeps */
+// #define I2S_OUTPUT_DITHER
+#define I2S_DITHER_BITS     24
+
+/* Uncomment to keep I2S fixed at 48 kHz and resample every A2DP stream to it
+ * (no reclock glitches on rate changes, one DSP coefficient set downstream) */
+// #define I2S_FIXED_OUTPUT_RATE
+
+/*
+ * What to do when the ring fills faster than it drains (source clock or
+ * burst running ahead of the ASRC's ±300 ppm range)
+ */
+typedef enum {
+    AUDIO_OVERFLOW_DROP_NEWEST = 0,     /* Drop incoming packets once the ring is full */
+    AUDIO_OVERFLOW_DROP_OLDEST,         /* Skip old audio to bound latency */
+    AUDIO_OVERFLOW_TIME_COMPRESS,       /* Play slightly fast until back on target */
+} audio_overflow_policy_t;
+
+#define AUDIO_OVERFLOW_POLICY_DEFAULT   AUDIO_OVERFLOW_DROP_NEWEST
+
+/*
+ * Audio profiles: pre-buffer bounds and I2S DMA layout, switchable at runtime
+ */
+typedef enum {
+    AUDIO_PROFILE_ROBUST = 0,           /* 8 × 480-frame DMA, 20-150 ms jitter target */
+    AUDIO_PROFILE_LOW_LATENCY,          /* 4 × 240-frame DMA, 10-60 ms jitter target */
+    AUDIO_PROFILE_DEEP,                 /* 8 × 480-frame DMA, 1-2 s jitter target (PSRAM only) */
+    AUDIO_PROFILE_COUNT,
+} audio_profile_t;
+
+/*
+ * A2DP stream state changes the writer has to follow
+ */
+typedef enum {
+    AUDIO_STREAM_STARTED = 0,           /* Audio started (or resumed) */
+    AUDIO_STREAM_SUSPENDED,             /* Source paused the stream */
+    AUDIO_STREAM_DISCONNECTED,          /* A2DP link closed */
+} audio_stream_event_t;
+
+/* Silence before the writer stops I2S and puts the DSP in standby
+ * (seconds, 0 = never); |sample| at or below the level counts as silence */
+#define AUDIO_STANDBY_TIMEOUT_DEFAULT_S 30
+#define AUDIO_STANDBY_SILENCE_LEVEL     16
+
+/* Latency the STM32 DSP adds after I2S (block processing + DAC filter),
+ * included in the delay reported to the A2DP source */
+#define DSP_DOWNSTREAM_LATENCY_US       3000
+
+/*
+ * Output latency callback
+ * Called on the FreeRTOS timer task when the end-to-end latency changes
+ * (posted by the writer, which never calls into the Bluetooth stack).
+ *
+ * @param latency_us Ring + I2S DMA + downstream DSP latency in microseconds
+ */
+typedef void (*audio_latency_cb_t)(uint32_t latency_us);
+
+#ifdef I2S_FIXED_OUTPUT_RATE
+#define I2S_SAMPLE_RATE     48000   /* Fixed; streams go through src_polyphase.c */
+#else
+#define I2S_SAMPLE_RATE     44100   /* Default, reconfigured per A2DP stream */
+#endif
+
+/*
+ * Initialize audio pipeline
+ * Allocates the A2DP → I2S ring and brings up the I2S channel
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t audio_pipeline_init(void);
+
+/*
+ * Start the I2S writer task on Core 1
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t audio_pipeline_start(void);
+
+/*
+ * Push decoded A2DP PCM into the pipeline (ring producer)
+ * Called from the A2DP data callback on the BTC task. Never blocks.
+ *
+ * @param data Interleaved 16-bit stereo PCM
+ * @param len Length in bytes
+ */
+void audio_pipeline_push(const uint8_t *data, uint32_t len);
+
+/*
+ * Report an A2DP stream state change (BTC task)
+ * On suspend the buffered tail plays out and fades; on disconnect it is
+ * dropped and the jitter estimate starts over. Either way the writer goes
+ * back to pre-buffering, so the next start fades in from a full cushion.
+ *
+ * @param event Stream event
+ */
+void audio_pipeline_stream_event(audio_stream_event_t event);
+
+/*
+ * Reconfigure I2S sample rate based on A2DP stream parameters
+ * With I2S_FIXED_OUTPUT_RATE, I2S keeps running and only the SRC is retuned.
+ *
+ * @param sample_rate New sample rate in Hz
+ * @return ESP_OK on success
+ */
+esp_err_t audio_pipeline_set_sample_rate(uint32_t sample_rate);
+
+/*
+ * Select the ring overflow policy
+ * Safe to call from any task; the writer picks it up on its next block.
+ * A full ring always drops the newest packet as a last resort.
+ *
+ * @param policy Overflow policy
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for an unknown policy
+ */
+esp_err_t audio_pipeline_set_overflow_policy(audio_overflow_policy_t policy);
+
+/*
+ * Select the audio profile
+ * Before audio_pipeline_init() this only picks the initial layout. Once
+ * running, the writer fades out, rebuilds the I2S channel with the new DMA
+ * layout and resumes from the ring; no audio is dropped, except buffered
+ * audio above the new profile's ring limit when leaving the deep profile.
+ *
+ * @param profile Audio profile
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for an unknown profile, or
+ *         ESP_ERR_NOT_SUPPORTED for the deep profile without PSRAM
+ */
+esp_err_t audio_pipeline_set_profile(audio_profile_t profile);
+
+/*
+ * Set the silence timeout for output standby
+ * After this long without audible output (stream paused, or streaming
+ * digital silence) the writer stops the I2S clocks and sends EVT:STANDBY.
+ * Safe to call from any task; takes effect on the writer's next check.
+ *
+ * @param seconds Timeout in seconds, 0 to never enter standby
+ */
+void audio_pipeline_set_standby_timeout(uint16_t seconds);
+
+/*
+ * Register the output latency callback (A2DP delay reporting)
+ * Call before audio_pipeline_start().
+ *
+ * @param cb Callback, or NULL to disable
+ */
+void audio_pipeline_set_latency_callback(audio_latency_cb_t cb);
+
+/*
+ * Set the latency added downstream of I2S by the DSP engine
+ * Triggers a new latency report.
+ *
+ * @param latency_us Downstream latency in microseconds
+ */
+void audio_pipeline_set_dsp_latency_us(uint32_t latency_us);
+
+/*
+ * Get the current end-to-end output latency
+ * Smoothed ring fill + I2S DMA queue + downstream DSP latency (before the
+ * first block: the jitter target in place of the fill).
+ *
+ * @return Latency in microseconds
+ */
+uint32_t audio_pipeline_get_latency_us(void);
+
+/*
+ * Get the output frame at which audio entering the pipeline now will be
+ * clocked out on I2S
+ * Used to stamp DSP control changes (EVT:SCHED), so the STM32 applies them
+ * on the audio that was playing at the source when the change was made.
+ * Frames are counted on the I2S clock since boot; EVT:SYNC re-anchors the
+ * DSP's count after every clock restart. With no stream audio in flight
+ * (pre-buffer, standby, test signal) this is the frame going out now,
+ * i.e. "apply at once". Safe to call from any task.
+ *
+ * @return Frame index (free-running, wraps at 2^32)
+ */
+uint32_t audio_pipeline_get_schedule_frame(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_PIPELINE_H */
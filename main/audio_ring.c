@@ -0,0 +1,172 @@
+/*
+ * Lock-free SPSC Audio Ring Implementation
+ *
+ * Indices are free-running byte counters; fill = head - tail (unsigned
+ * wrap-around is well defined). The producer publishes with a release
+ * store on head, the consumer with a release store on tail, and each
+ * side reads the other's index with acquire ordering.
+ *
+ * Date: 2026-10-16
+ */
+
+#include "audio_ring.h"
+#include <string.h>
+
+esp_err_t audio_ring_init(audio_ring_t *ring, void *storage, size_t capacity)
+{
+    if (ring == NULL || storage == NULL || capacity == 0 ||
+        (capacity & (capacity - 1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ring->buf = (uint8_t *)storage;
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    audio_ring_reset(ring);
+
+    return ESP_OK;
+}
+
+void audio_ring_reset(audio_ring_t *ring)
+{
+    atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, 0, memory_order_relaxed);
+    ring->tail_cache = 0;
+    ring->head_cache = 0;
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+size_t audio_ring_fill(const audio_ring_t *ring)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return head - tail;
+}
+
+size_t audio_ring_write_pos(const audio_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+size_t audio_ring_read_pos(const audio_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+size_t audio_ring_free(const audio_ring_t *ring)
+{
+    return ring->capacity - audio_ring_fill(ring);
+}
+
+uint8_t *audio_ring_write_reserve(audio_ring_t *ring, size_t *len)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t free_bytes = ring->capacity - (head - ring->tail_cache);
+
+    /* Only touch the consumer's line when the cached tail says we're short */
+    if (free_bytes < *len) {
+        ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        free_bytes = ring->capacity - (head - ring->tail_cache);
+    }
+
+    if (free_bytes == 0) {
+        *len = 0;
+        return NULL;
+    }
+
+    size_t offset = head & ring->mask;
+    size_t span = ring->capacity - offset;
+    if (span > free_bytes) {
+        span = free_bytes;
+    }
+    if (span > *len) {
+        span = *len;
+    }
+
+    *len = span;
+    return ring->buf + offset;
+}
+
+void audio_ring_write_commit(audio_ring_t *ring, size_t len)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + len, memory_order_release);
+}
+
+bool audio_ring_write(audio_ring_t *ring, const void *data, size_t len)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    if (ring->capacity - (head - ring->tail_cache) < len) {
+        ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (ring->capacity - (head - ring->tail_cache) < len) {
+            return false;
+        }
+    }
+
+    /* At most two copies: up to the wrap point, then from the start */
+    size_t offset = head & ring->mask;
+    size_t first = ring->capacity - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(ring->buf + offset, data, first);
+    if (len > first) {
+        memcpy(ring->buf, (const uint8_t *)data + first, len - first);
+    }
+
+    atomic_store_explicit(&ring->head, head + len, memory_order_release);
+    return true;
+}
+
+const uint8_t *audio_ring_read_peek(audio_ring_t *ring, size_t *len)
+{
+    return audio_ring_read_peek_at(ring, 0, len);
+}
+
+const uint8_t *audio_ring_read_peek_at(audio_ring_t *ring, size_t skip, size_t *len)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed) + skip;
+    size_t avail = ring->head_cache - tail;
+
+    /* Only touch the producer's line when the cached head says we're short
+     * (a "negative" avail, skip past the cached head, is short as well) */
+    if ((ptrdiff_t)avail < (ptrdiff_t)*len) {
+        ring->head_cache = atomic_load_explicit(&ring->head, memory_order_acquire);
+        avail = ring->head_cache - tail;
+    }
+
+    if ((ptrdiff_t)avail <= 0) {
+        *len = 0;
+        return NULL;
+    }
+
+    size_t offset = tail & ring->mask;
+    size_t span = ring->capacity - offset;
+    if (span > avail) {
+        span = avail;
+    }
+    if (span > *len) {
+        span = *len;
+    }
+
+    *len = span;
+    return ring->buf + offset;
+}
+
+void audio_ring_read_release(audio_ring_t *ring, size_t len)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + len, memory_order_release);
+}
+
+size_t audio_ring_read_discard(audio_ring_t *ring, size_t len)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (len > head - tail) {
+        len = head - tail;
+    }
+    atomic_store_explicit(&ring->tail, tail + len, memory_order_release);
+    return len;
+}
@@ -0,0 +1,178 @@
+/*
+ * Lock-free SPSC Audio Ring
+ * A2DP → I2S transport between the BTC task (Core 0) and the I2S writer (Core 1)
+ *
+ * Single-producer / single-consumer byte ring:
+ * - Free-running atomic head/tail indices, no critical sections
+ * - Power-of-two capacity (index wrap is a mask, not a modulo)
+ * - Producer and consumer indices live on separate cache lines
+ * - Contiguous-span reserve/commit (producer) and peek/release (consumer)
+ *
+ * Exactly one task may call the producer functions and exactly one task
+ * may call the consumer functions. Fill/free queries are safe from either.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef AUDIO_RING_H
+#define AUDIO_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Cache line size used to separate producer and consumer indices */
+#define AUDIO_RING_CACHE_LINE   32
+
+/*
+ * Ring state
+ * head is written only by the producer, tail only by the consumer.
+ * Each side keeps a private copy of the other side's index so the shared
+ * line is only re-read when the cached value says the ring is full/empty.
+ */
+typedef struct {
+    /* Read-only after audio_ring_init() */
+    uint8_t *buf;
+    size_t capacity;
+    size_t mask;
+
+    /* Producer cache line */
+    _Atomic size_t head __attribute__((aligned(AUDIO_RING_CACHE_LINE)));
+    size_t tail_cache;
+
+    /* Consumer cache line */
+    _Atomic size_t tail __attribute__((aligned(AUDIO_RING_CACHE_LINE)));
+    size_t head_cache;
+} audio_ring_t;
+
+/*
+ * Initialize ring over caller-provided storage
+ *
+ * @param ring Ring to initialize
+ * @param storage Backing memory, at least capacity bytes
+ * @param capacity Size in bytes, must be a power of two
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG on bad storage/capacity
+ */
+esp_err_t audio_ring_init(audio_ring_t *ring, void *storage, size_t capacity);
+
+/*
+ * Discard all buffered data
+ * Only safe while neither side is active (e.g. before the writer starts)
+ *
+ * @param ring Ring to reset
+ */
+void audio_ring_reset(audio_ring_t *ring);
+
+/*
+ * Get number of buffered bytes (safe from either side)
+ *
+ * @param ring Ring to query
+ * @return Bytes available to the consumer
+ */
+size_t audio_ring_fill(const audio_ring_t *ring);
+
+/*
+ * Get number of free bytes (safe from either side)
+ *
+ * @param ring Ring to query
+ * @return Bytes available to the producer
+ */
+size_t audio_ring_free(const audio_ring_t *ring);
+
+/*
+ * Get the producer's free-running byte position (safe from either side)
+ * Together with audio_ring_read_pos() this marks points in the stream:
+ * a position is reached once read_pos - pos is no longer negative.
+ *
+ * @param ring Ring to query
+ * @return Total bytes ever committed (wraps at SIZE_MAX)
+ */
+size_t audio_ring_write_pos(const audio_ring_t *ring);
+
+/*
+ * Get the consumer's free-running byte position (safe from either side)
+ *
+ * @param ring Ring to query
+ * @return Total bytes ever released (wraps at SIZE_MAX)
+ */
+size_t audio_ring_read_pos(const audio_ring_t *ring);
+
+/*
+ * Producer: reserve a contiguous writable span
+ * The span never crosses the wrap point, so it may be shorter than the
+ * total free space. Nothing becomes visible until audio_ring_write_commit().
+ *
+ * @param ring Ring to write
+ * @param len In: bytes wanted, Out: bytes available in the span
+ * @return Pointer to the span, or NULL if the ring is full
+ */
+uint8_t *audio_ring_write_reserve(audio_ring_t *ring, size_t *len);
+
+/*
+ * Producer: publish bytes written into the reserved span
+ *
+ * @param ring Ring to write
+ * @param len Bytes to publish (<= reserved length)
+ */
+void audio_ring_write_commit(audio_ring_t *ring, size_t len);
+
+/*
+ * Producer: copy a whole packet into the ring (all or nothing)
+ *
+ * @param ring Ring to write
+ * @param data Source data
+ * @param len Bytes to write
+ * @return true if written, false if there was not enough free space
+ */
+bool audio_ring_write(audio_ring_t *ring, const void *data, size_t len);
+
+/*
+ * Consumer: peek at a contiguous readable span
+ * The span never crosses the wrap point.
+ *
+ * @param ring Ring to read
+ * @param len In: bytes wanted, Out: bytes available in the span
+ * @return Pointer to the span, or NULL if the ring is empty
+ */
+const uint8_t *audio_ring_read_peek(audio_ring_t *ring, size_t *len);
+
+/*
+ * Consumer: peek at a contiguous span further into the ring
+ * Like audio_ring_read_peek(), starting skip bytes past the read position,
+ * for looking ahead without consuming.
+ *
+ * @param ring Ring to read
+ * @param skip Bytes to skip from the read position
+ * @param len In: bytes wanted, Out: bytes available in the span
+ * @return Pointer to the span, or NULL if nothing lies past skip
+ */
+const uint8_t *audio_ring_read_peek_at(audio_ring_t *ring, size_t skip, size_t *len);
+
+/*
+ * Consumer: release bytes previously returned by audio_ring_read_peek()
+ *
+ * @param ring Ring to read
+ * @param len Bytes consumed (<= peeked length)
+ */
+void audio_ring_read_release(audio_ring_t *ring, size_t len);
+
+/*
+ * Consumer: drop buffered bytes without reading them
+ *
+ * @param ring Ring to read
+ * @param len Bytes to drop
+ * @return Bytes actually dropped (at most the current fill)
+ */
+size_t audio_ring_read_discard(audio_ring_t *ring, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_RING_H */
@@ -0,0 +1,315 @@
+/*
+ * Channel Routing Stage Implementation
+ *
+ * route_block() is the only loop. It is always inlined into one small
+ * wrapper per feature set (ROUTE_KERNEL below), with the feature mask a
+ * literal, so the compiler drops every branch and load the set does not
+ * need. route_select() maps the current settings to a wrapper; NULL means
+ * passthrough.
+ *
+ * Delays use one 512-frame line per channel and a shared write position:
+ * each sample is stored, then read back from delay frames earlier.
+ *
+ * With I2S_32BIT_OUTPUT no kernel trims: route_select() leaves ROUTE_TRIM
+ * out, and audio_route_trim_wide() ramps the same Q15 gains over the
+ * widened block with 64-bit products.
+ *
+ * Date: 2026-10-16
+ */
+
+#include "audio_route.h"
+#include "audio_pipeline.h"
+#include <math.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+
+static const char *TAG = "AUDIO_ROUTE";
+
+#define GAIN_UNITY          (1 << 15)
+
+/* Delay line length (power of two, > AUDIO_ROUTE_MAX_DELAY) */
+#define DELAY_SIZE          512
+#define DELAY_MASK          (DELAY_SIZE - 1)
+
+/* Kernel features (compile-time constants inside each kernel) */
+#define ROUTE_SWAP          0x01
+#define ROUTE_MONO          0x02
+#define ROUTE_TRIM          0x04
+#define ROUTE_DELAY         0x08
+
+/* Swap/mono/delay word: flags | delay_l | delay_r */
+#define MATRIX_PACK(f, dl, dr)  (((uint32_t)(f) << 20) | ((uint32_t)(dl) << 10) | (uint32_t)(dr))
+#define MATRIX_FLAGS(m)         ((uint8_t)((m) >> 20))
+#define MATRIX_DELAY_L(m)       ((uint16_t)(((m) >> 10) & 0x3FF))
+#define MATRIX_DELAY_R(m)       ((uint16_t)((m) & 0x3FF))
+
+/* Trim word: trim_l | trim_r */
+#define TRIM_PACK(l, r)         (((uint32_t)(l) << 8) | (uint32_t)(r))
+
+typedef struct route_state route_state_t;
+typedef void (*route_kernel_t)(int16_t *block, size_t frames, route_state_t *rt);
+
+/* Routing state — owned by the writer task */
+struct route_state {
+    route_kernel_t kernel;          /* NULL: passthrough */
+    uint32_t matrix;                /* Committed swap/mono/delay word */
+    uint32_t trim;                  /* Trim word the targets were derived for */
+    int32_t gain_l;                 /* Q15 trim at the start of the next block */
+    int32_t gain_r;
+    int32_t target_l;
+    int32_t target_r;
+    uint16_t delay_l;
+    uint16_t delay_r;
+    uint32_t pos;                   /* Delay-line write position */
+    int16_t line_l[DELAY_SIZE];
+    int16_t line_r[DELAY_SIZE];
+};
+
+static route_state_t s_rt = {
+    .gain_l = GAIN_UNITY,
+    .gain_r = GAIN_UNITY,
+    .target_l = GAIN_UNITY,
+    .target_r = GAIN_UNITY,
+};
+
+/* Requested settings (any task writes, writer reads) */
+static _Atomic uint32_t s_matrix = MATRIX_PACK(0, 0, 0);
+static _Atomic uint32_t s_trim = TRIM_PACK(0, 0);
+
+/*
+ * Route one block with a fixed feature set
+ * features must be a literal at every call site.
+ */
+static inline __attribute__((always_inline))
+void route_block(int16_t *block, size_t frames, route_state_t *rt, const unsigned features)
+{
+    int32_t acc_l = 0, acc_r = 0, step_l = 0, step_r = 0;
+    if (features & ROUTE_TRIM) {
+        /* Linear ramp to the target across the block, as audio_gain does */
+        acc_l = rt->gain_l * (1 << 15);
+        acc_r = rt->gain_r * (1 << 15);
+        step_l = ((rt->target_l - rt->gain_l) * (1 << 15)) / (int32_t)frames;
+        step_r = ((rt->target_r - rt->gain_r) * (1 << 15)) / (int32_t)frames;
+    }
+    uint32_t pos = rt->pos;
+
+    for (size_t i = 0; i < frames; i++) {
+        int32_t l = block[2 * i];
+        int32_t r = block[2 * i + 1];
+
+        if (features & ROUTE_SWAP) {
+            int32_t t = l;
+            l = r;
+            r = t;
+        }
+        if (features & ROUTE_MONO) {
+            l = (l + r) >> 1;
+            r = l;
+        }
+        if (features & ROUTE_TRIM) {
+            l = (l * (acc_l >> 15) + (1 << 14)) >> 15;
+            r = (r * (acc_r >> 15) + (1 << 14)) >> 15;
+            acc_l += step_l;
+            acc_r += step_r;
+        }
+        if (features & ROUTE_DELAY) {
+            rt->line_l[pos] = (int16_t)l;
+            rt->line_r[pos] = (int16_t)r;
+            l = rt->line_l[(pos - rt->delay_l) & DELAY_MASK];
+            r = rt->line_r[(pos - rt->delay_r) & DELAY_MASK];
+            pos = (pos + 1) & DELAY_MASK;
+        }
+
+        block[2 * i] = (int16_t)l;
+        block[2 * i + 1] = (int16_t)r;
+    }
+
+    if (features & ROUTE_TRIM) {
+        rt->gain_l = rt->target_l;
+        rt->gain_r = rt->target_r;
+    }
+    rt->pos = pos;
+}
+
+#define ROUTE_KERNEL(name, features) \
+    static void name(int16_t *block, size_t frames, route_state_t *rt) \
+    { \
+        route_block(block, frames, rt, (features)); \
+    }
+
+ROUTE_KERNEL(route_swap, ROUTE_SWAP)
+ROUTE_KERNEL(route_mono, ROUTE_MONO)
+ROUTE_KERNEL(route_trim, ROUTE_TRIM)
+ROUTE_KERNEL(route_swap_trim, ROUTE_SWAP | ROUTE_TRIM)
+ROUTE_KERNEL(route_mono_trim, ROUTE_MONO | ROUTE_TRIM)
+ROUTE_KERNEL(route_delay, ROUTE_DELAY)
+ROUTE_KERNEL(route_swap_delay, ROUTE_SWAP | ROUTE_DELAY)
+ROUTE_KERNEL(route_mono_delay, ROUTE_MONO | ROUTE_DELAY)
+ROUTE_KERNEL(route_trim_delay, ROUTE_TRIM | ROUTE_DELAY)
+ROUTE_KERNEL(route_swap_trim_delay, ROUTE_SWAP | ROUTE_TRIM | ROUTE_DELAY)
+ROUTE_KERNEL(route_mono_trim_delay, ROUTE_MONO | ROUTE_TRIM | ROUTE_DELAY)
+
+/* Kernel per feature set (mono makes swap irrelevant) */
+static const route_kernel_t s_kernels[16] = {
+    [0]                                                 = NULL,
+    [ROUTE_SWAP]                                        = route_swap,
+    [ROUTE_MONO]                                        = route_mono,
+    [ROUTE_SWAP | ROUTE_MONO]                           = route_mono,
+    [ROUTE_TRIM]                                        = route_trim,
+    [ROUTE_SWAP | ROUTE_TRIM]                           = route_swap_trim,
+    [ROUTE_MONO | ROUTE_TRIM]                           = route_mono_trim,
+    [ROUTE_SWAP | ROUTE_MONO | ROUTE_TRIM]              = route_mono_trim,
+    [ROUTE_DELAY]                                       = route_delay,
+    [ROUTE_SWAP | ROUTE_DELAY]                          = route_swap_delay,
+    [ROUTE_MONO | ROUTE_DELAY]                          = route_mono_delay,
+    [ROUTE_SWAP | ROUTE_MONO | ROUTE_DELAY]             = route_mono_delay,
+    [ROUTE_TRIM | ROUTE_DELAY]                          = route_trim_delay,
+    [ROUTE_SWAP | ROUTE_TRIM | ROUTE_DELAY]             = route_swap_trim_delay,
+    [ROUTE_MONO | ROUTE_TRIM | ROUTE_DELAY]             = route_mono_trim_delay,
+    [ROUTE_SWAP | ROUTE_MONO | ROUTE_TRIM | ROUTE_DELAY] = route_mono_trim_delay,
+};
+
+static int32_t trim_to_q15(uint8_t steps)
+{
+    if (steps == 0) {
+        return GAIN_UNITY;
+    }
+    return (int32_t)lroundf(GAIN_UNITY * powf(10.0f, -(float)steps * AUDIO_ROUTE_TRIM_DB_STEP / 20.0f));
+}
+
+/*
+ * Pick the kernel for the committed matrix and the trim state
+ */
+static void route_select(route_state_t *rt)
+{
+    unsigned features = 0;
+    uint8_t flags = MATRIX_FLAGS(rt->matrix);
+
+    if (flags & AUDIO_ROUTE_FLAG_SWAP) {
+        features |= ROUTE_SWAP;
+    }
+    if (flags & AUDIO_ROUTE_FLAG_MONO) {
+        features |= ROUTE_MONO;
+    }
+#ifndef I2S_32BIT_OUTPUT
+    if (rt->gain_l != GAIN_UNITY || rt->gain_r != GAIN_UNITY ||
+        rt->target_l != GAIN_UNITY || rt->target_r != GAIN_UNITY) {
+        features |= ROUTE_TRIM;
+    }
+#endif
+    if (rt->delay_l != 0 || rt->delay_r != 0) {
+        features |= ROUTE_DELAY;
+    }
+
+    rt->kernel = s_kernels[features];
+}
+
+/*
+ * Public API Implementation
+ */
+
+esp_err_t audio_route_set(const audio_route_config_t *cfg)
+{
+    if (cfg == NULL ||
+        (cfg->flags & ~(AUDIO_ROUTE_FLAG_SWAP | AUDIO_ROUTE_FLAG_MONO)) != 0 ||
+        cfg->delay_l > AUDIO_ROUTE_MAX_DELAY || cfg->delay_r > AUDIO_ROUTE_MAX_DELAY) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    atomic_store_explicit(&s_trim, TRIM_PACK(cfg->trim_l, cfg->trim_r), memory_order_relaxed);
+    atomic_store_explicit(&s_matrix, MATRIX_PACK(cfg->flags, cfg->delay_l, cfg->delay_r),
+                          memory_order_relaxed);
+    return ESP_OK;
+}
+
+void audio_route_get(audio_route_config_t *cfg)
+{
+    if (cfg == NULL) {
+        return;
+    }
+    uint32_t matrix = atomic_load_explicit(&s_matrix, memory_order_relaxed);
+    uint32_t trim = atomic_load_explicit(&s_trim, memory_order_relaxed);
+    cfg->flags = MATRIX_FLAGS(matrix);
+    cfg->trim_l = (uint8_t)(trim >> 8);
+    cfg->trim_r = (uint8_t)trim;
+    cfg->delay_l = MATRIX_DELAY_L(matrix);
+    cfg->delay_r = MATRIX_DELAY_R(matrix);
+}
+
+bool audio_route_pending(void)
+{
+    return atomic_load_explicit(&s_matrix, memory_order_relaxed) != s_rt.matrix;
+}
+
+void audio_route_commit(void)
+{
+    route_state_t *rt = &s_rt;
+
+    rt->matrix = atomic_load_explicit(&s_matrix, memory_order_relaxed);
+    rt->delay_l = MATRIX_DELAY_L(rt->matrix);
+    rt->delay_r = MATRIX_DELAY_R(rt->matrix);
+    memset(rt->line_l, 0, sizeof(rt->line_l));
+    memset(rt->line_r, 0, sizeof(rt->line_r));
+    rt->pos = 0;
+    route_select(rt);
+
+    ESP_LOGI(TAG, "Routing: %s, delay L %u R %u frames",
+             (MATRIX_FLAGS(rt->matrix) & AUDIO_ROUTE_FLAG_MONO) ? "mono" :
+             (MATRIX_FLAGS(rt->matrix) & AUDIO_ROUTE_FLAG_SWAP) ? "swapped" : "stereo",
+             (unsigned)rt->delay_l, (unsigned)rt->delay_r);
+}
+
+void audio_route_process(int16_t *block, size_t frames)
+{
+    route_state_t *rt = &s_rt;
+
+    uint32_t trim = atomic_load_explicit(&s_trim, memory_order_relaxed);
+    if (trim != rt->trim) {
+        rt->trim = trim;
+        rt->target_l = trim_to_q15((uint8_t)(trim >> 8));
+        rt->target_r = trim_to_q15((uint8_t)trim);
+        route_select(rt);
+    }
+
+    if (rt->kernel == NULL || frames == 0) {
+        return;
+    }
+
+    bool ramping = (rt->gain_l != rt->target_l) || (rt->gain_r != rt->target_r);
+    rt->kernel(block, frames, rt);
+    if (ramping) {
+        route_select(rt);       /* Back at unity: drop the trim kernel */
+    }
+}
+
+bool audio_route_trim_active(void)
+{
+    const route_state_t *rt = &s_rt;
+    return rt->gain_l != GAIN_UNITY || rt->gain_r != GAIN_UNITY ||
+           rt->target_l != GAIN_UNITY || rt->target_r != GAIN_UNITY;
+}
+
+void audio_route_trim_wide(int32_t *block, size_t frames)
+{
+    route_state_t *rt = &s_rt;
+    if (!audio_route_trim_active() || frames == 0) {
+        return;
+    }
+
+    /* Same ramp as the 16-bit kernel; trim only attenuates, so no clamp */
+    int32_t acc_l = rt->gain_l * (1 << 15);
+    int32_t acc_r = rt->gain_r * (1 << 15);
+    int32_t step_l = ((rt->target_l - rt->gain_l) * (1 << 15)) / (int32_t)frames;
+    int32_t step_r = ((rt->target_r - rt->gain_r) * (1 << 15)) / (int32_t)frames;
+
+    for (size_t i = 0; i < frames; i++) {
+        block[2 * i] = (int32_t)(((int64_t)block[2 * i] * (acc_l >> 15) + (1 << 14)) >> 15);
+        block[2 * i + 1] = (int32_t)(((int64_t)block[2 * i + 1] * (acc_r >> 15) + (1 << 14)) >> 15);
+        acc_l += step_l;
+        acc_r += step_r;
+    }
+
+    rt->gain_l = rt->target_l;
+    rt->gain_r = rt->target_r;
+}
@@ -0,0 +1,127 @@
+/*
+ * Channel Routing Stage
+ * L/R swap, mono sum, per-channel trim and per-channel delay on the output
+ *
+ * For installations the STM32 preset cannot know about: single-driver mono
+ * boxes get (L+R)/2 on both channels, and rooms with the speakers at
+ * unequal distances get a per-channel trim and time alignment. Signal
+ * order is swap or mono sum, then trim, then delay.
+ *
+ * Each combination of features has its own kernel, generated from one
+ * always-inline template with the feature set as a compile-time constant,
+ * so a kernel carries no per-sample branches for features it does not
+ * use. The kernel is picked when the configuration changes; passthrough
+ * has no kernel at all and costs one pointer test per block.
+ *
+ * With I2S_32BIT_OUTPUT, trim is a gain like any other and is applied to
+ * the widened block instead (audio_route_trim_wide()), just ahead of the
+ * gain stage, so an attenuated channel keeps its low bits; swap, mono and
+ * delay stay in 16 bits.
+ *
+ * Trim changes ramp across one block. Swap, mono and delay changes restructure
+ * the signal, so the writer fades out before committing them (see
+ * audio_route_commit()).
+ *
+ * Threading: audio_route_pending(), audio_route_commit(),
+ * audio_route_process() and the trim functions belong to the I2S writer
+ * task. audio_route_set()
+ * and audio_route_get() are lock-free and safe from any task.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef AUDIO_ROUTE_H
+#define AUDIO_ROUTE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Routing flags (BLE command byte 1) */
+#define AUDIO_ROUTE_FLAG_SWAP       0x01    /* Left and right exchanged */
+#define AUDIO_ROUTE_FLAG_MONO       0x02    /* (L+R)/2 on both channels; overrides swap */
+
+/* Trim: attenuation in 0.5 dB steps, 0 = 0 dB, 255 = -127.5 dB (silent) */
+#define AUDIO_ROUTE_TRIM_DB_STEP    0.5f
+
+/* Longest per-channel delay in frames (~10.7 ms / 3.6 m at 48 kHz) */
+#define AUDIO_ROUTE_MAX_DELAY       511
+
+/*
+ * Routing configuration
+ */
+typedef struct {
+    uint8_t flags;                  /* AUDIO_ROUTE_FLAG_* */
+    uint8_t trim_l;                 /* Left attenuation, AUDIO_ROUTE_TRIM_DB_STEP units */
+    uint8_t trim_r;                 /* Right attenuation */
+    uint16_t delay_l;               /* Left delay in frames, 0..AUDIO_ROUTE_MAX_DELAY */
+    uint16_t delay_r;               /* Right delay in frames */
+} audio_route_config_t;
+
+/*
+ * Set the routing configuration
+ * Trim takes effect on the next block; swap, mono and delay once the
+ * writer has faded out and committed them.
+ *
+ * @param cfg New configuration
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for unknown flags or a delay
+ *         above AUDIO_ROUTE_MAX_DELAY
+ */
+esp_err_t audio_route_set(const audio_route_config_t *cfg);
+
+/*
+ * Get the requested routing configuration
+ *
+ * @param cfg Filled with the configuration last set
+ */
+void audio_route_get(audio_route_config_t *cfg);
+
+/*
+ * Whether a swap, mono or delay change is waiting for a commit (writer task)
+ *
+ * @return true if the writer should fade out and call audio_route_commit()
+ */
+bool audio_route_pending(void);
+
+/*
+ * Take the pending swap, mono and delay settings (writer task)
+ * Clears the delay lines, so call it while the output is silent.
+ */
+void audio_route_commit(void);
+
+/*
+ * Route one output block in place (writer task)
+ *
+ * @param block Interleaved 16-bit stereo block
+ * @param frames Block length in frames
+ */
+void audio_route_process(int16_t *block, size_t frames);
+
+/*
+ * Whether a trim is set or still ramping (writer task, I2S_32BIT_OUTPUT)
+ * Valid after audio_route_process() for the same block.
+ *
+ * @return true if audio_route_trim_wide() has work to do
+ */
+bool audio_route_trim_active(void);
+
+/*
+ * Apply the per-channel trim to a widened block (writer task)
+ * Only for I2S_32BIT_OUTPUT builds, where audio_route_process() leaves
+ * trim out; call it after audio_route_process() for the same block.
+ *
+ * @param block Interleaved 32-bit stereo block (left-justified), in place
+ * @param frames Block length in frames
+ */
+void audio_route_trim_wide(int32_t *block, size_t frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_ROUTE_H */
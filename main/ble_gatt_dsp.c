@@ -9,7 +9,20 @@
 #include "ble_gatt_dsp.h"
 #include "nvs_settings.h"
 #include "ota_manager.h"
+#include "audio_metrics.h"
+#include "audio_pipeline.h"
+#include "audio_gain.h"
+#include "audio_meter.h"
+#include "audio_clip.h"
+#include "signal_gen.h"
+#include "audio_route.h"
+#include "audio_capture.h"
+#include "local_dsp.h"
+#include "spectrum.h"
+#include "jitter_buffer.h"
 #include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
 #include "esp_log.h"
 #include "esp_bt.h"
 #include "esp_gap_ble_api.h"
@@ -17,7 +30,10 @@
 #include "esp_bt_defs.h"
 #include "esp_bt_main.h"
 #include "esp_timer.h"
+#include "freertos/task.h"
 #include "freertos/timers.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
 
@@ -31,6 +47,20 @@
 #define UART_ECHO_BAUD      115200
 #define UART_ECHO_BUF_SIZE  256
 
+/* UART command receiver ("CMD:CTRL:<hex>" lines from the STM32 or a test jig) */
+#define UART_RX_LINE_MAX        64
+#define UART_RX_TASK_STACK      3072
+#define UART_RX_TASK_PRIORITY   5
+#define UART_RX_PREFIX          "CMD:CTRL:"
+
+/* UART sender: every outgoing line is queued and written by one low-priority
+ * task, so callers (the I2S writer among them) never wait on the UART and
+ * lines leave in the order they were sent */
+#define UART_TX_QUEUE_LEN       12
+#define UART_TX_DATA_MAX        56      /* Payload bytes per line, hex-encoded on send */
+#define UART_TX_TASK_STACK      3072
+#define UART_TX_TASK_PRIORITY   2
+
 static const char *TAG = "BLE_GATT";
 
 /* GATT profile instance */
@@ -48,6 +78,11 @@ enum {
     IDX_GALACTIC_CHAR,          /* GalacticStatus characteristic declaration */
     IDX_GALACTIC_VAL,           /* GalacticStatus characteristic value */
     IDX_GALACTIC_CCC,           /* GalacticStatus Client Characteristic Configuration */
+    IDX_METRICS_CHAR,           /* AudioMetrics characteristic declaration */
+    IDX_METRICS_VAL,            /* AudioMetrics characteristic value */
+    IDX_SPECTRUM_CHAR,          /* Spectrum characteristic declaration */
+    IDX_SPECTRUM_VAL,           /* Spectrum characteristic value */
+    IDX_SPECTRUM_CCC,           /* Spectrum Client Characteristic Configuration */
     /* OTA characteristics */
     IDX_OTA_CREDS_CHAR,         /* OTA Credentials characteristic declaration */
     IDX_OTA_CREDS_VAL,          /* OTA Credentials characteristic value */
@@ -71,6 +106,8 @@ static const uint8_t dsp_service_uuid[16] = DSP_SERVICE_UUID_128;
 static const uint8_t dsp_control_uuid[16] = DSP_CONTROL_CHAR_UUID_128;
 static const uint8_t dsp_status_uuid[16] = DSP_STATUS_CHAR_UUID_128;
 static const uint8_t dsp_galactic_uuid[16] = DSP_GALACTIC_CHAR_UUID_128;
+static const uint8_t dsp_metrics_uuid[16] = DSP_AUDIO_METRICS_CHAR_UUID_128;
+static const uint8_t dsp_spectrum_uuid[16] = DSP_SPECTRUM_CHAR_UUID_128;
 
 /* OTA Characteristic UUIDs */
 static const uint8_t ota_creds_uuid[16] = OTA_CREDS_CHAR_UUID_128;
@@ -82,6 +119,8 @@ static const uint8_t ota_status_uuid[16] = OTA_STATUS_CHAR_UUID_128;
 static const uint8_t ctrl_char_prop = ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
 static const uint8_t status_char_prop = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY;
 static const uint8_t galactic_char_prop = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static const uint8_t metrics_char_prop = ESP_GATT_CHAR_PROP_BIT_READ;
+static const uint8_t spectrum_char_prop = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY;
 
 /* OTA Characteristic properties */
 static const uint8_t ota_write_char_prop = ESP_GATT_CHAR_PROP_BIT_WRITE;
@@ -90,10 +129,11 @@ static const uint8_t ota_status_char_prop = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GA
 /* Client Characteristic Configuration Descriptor default values */
 static uint8_t status_ccc[2] = {0x00, 0x00};
 static uint8_t galactic_ccc[2] = {0x00, 0x00};
+static uint8_t spectrum_ccc[2] = {0x00, 0x00};
 static uint8_t ota_status_ccc[2] = {0x00, 0x00};
 
-/* Control characteristic value (2 bytes: CMD + VAL) */
-static uint8_t ctrl_value[2] = {0x00, 0x00};
+/* Control characteristic value (CMD + VAL, optional arguments) */
+static uint8_t ctrl_value[DSP_CTRL_MAX_SIZE] = {0x00, 0x00};
 
 /* Status characteristic value (4 bytes per Section 10.4) */
 static uint8_t status_value[DSP_STATUS_SIZE] = {
@@ -108,12 +148,26 @@ static uint8_t galactic_value[DSP_GALACTIC_STATUS_SIZE] = {
     DSP_GALACTIC_PROTOCOL_VERSION,  /* VER: 0x42 */
     0x00,                           /* currentQuantumFlavor (preset) */
     0x01,                           /* shieldStatus (flags) */
-    100,                            /* energyCoreLevel (placeholder) */
+    0,                              /* energyCoreLevel (audio level) */
     50,                             /* distortionFieldStrength (volume placeholder) */
     100,                            /* Energy core (battery placeholder) */
     0                               /* lastContact (seconds) */
 };
 
+/* AudioMetrics characteristic value (filled by update_audio_metrics_value) */
+static uint8_t metrics_value[DSP_AUDIO_METRICS_SIZE] = {
+    DSP_AUDIO_METRICS_VERSION,
+    AUDIO_METRICS_HIST_BINS,
+};
+
+/* Spectrum characteristic value (last notification sent) */
+static uint8_t spectrum_value[DSP_SPECTRUM_SIZE] = {
+    DSP_SPECTRUM_VERSION,
+    0,
+    0,
+    SPECTRUM_BANDS,
+};
+
 /* OTA characteristic values */
 static uint8_t ota_creds_value[OTA_CREDS_MAX_SIZE] = {0};
 static uint8_t ota_url_value[OTA_URL_MAX_SIZE] = {0};
@@ -148,7 +202,7 @@ static const esp_gatts_attr_db_t gatt_db[IDX_NB] = {
         {
             ESP_UUID_LEN_128, (uint8_t *)dsp_control_uuid,
             ESP_GATT_PERM_WRITE,
-            sizeof(ctrl_value), sizeof(ctrl_value), ctrl_value
+            sizeof(ctrl_value), 2, ctrl_value
         }
     },
 
@@ -212,6 +266,56 @@ static const esp_gatts_attr_db_t gatt_db[IDX_NB] = {
         }
     },
 
+    /* AudioMetrics Characteristic Declaration */
+    [IDX_METRICS_CHAR] = {
+        {ESP_GATT_AUTO_RSP},
+        {
+            ESP_UUID_LEN_16, (uint8_t *)&(uint16_t){ESP_GATT_UUID_CHAR_DECLARE},
+            ESP_GATT_PERM_READ,
+            sizeof(uint8_t), sizeof(uint8_t), (uint8_t *)&metrics_char_prop
+        }
+    },
+
+    /* AudioMetrics Characteristic Value */
+    [IDX_METRICS_VAL] = {
+        {ESP_GATT_AUTO_RSP},
+        {
+            ESP_UUID_LEN_128, (uint8_t *)dsp_metrics_uuid,
+            ESP_GATT_PERM_READ,
+            sizeof(metrics_value), sizeof(metrics_value), metrics_value
+        }
+    },
+
+    /* Spectrum Characteristic Declaration */
+    [IDX_SPECTRUM_CHAR] = {
+        {ESP_GATT_AUTO_RSP},
+        {
+            ESP_UUID_LEN_16, (uint8_t *)&(uint16_t){ESP_GATT_UUID_CHAR_DECLARE},
+            ESP_GATT_PERM_READ,
+            sizeof(uint8_t), sizeof(uint8_t), (uint8_t *)&spectrum_char_prop
+        }
+    },
+
+    /* Spectrum Characteristic Value */
+    [IDX_SPECTRUM_VAL] = {
+        {ESP_GATT_AUTO_RSP},
+        {
+            ESP_UUID_LEN_128, (uint8_t *)dsp_spectrum_uuid,
+            ESP_GATT_PERM_READ,
+            sizeof(spectrum_value), sizeof(spectrum_value), spectrum_value
+        }
+    },
+
+    /* Spectrum Client Characteristic Configuration Descriptor */
+    [IDX_SPECTRUM_CCC] = {
+        {ESP_GATT_AUTO_RSP},
+        {
+            ESP_UUID_LEN_16, (uint8_t *)&(uint16_t){ESP_GATT_UUID_CHAR_CLIENT_CONFIG},
+            ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+            sizeof(spectrum_ccc), sizeof(spectrum_ccc), spectrum_ccc
+        }
+    },
+
     /* ========== OTA Characteristics ========== */
 
     /* OTA Credentials Characteristic Declaration */
@@ -359,6 +463,7 @@ typedef struct {
     bool connected;
     bool notifications_enabled;
     bool galactic_notifications_enabled;  /* CCCD for GalacticStatus (FR-18) */
+    bool spectrum_notifications_enabled;  /* CCCD for Spectrum */
     bool ota_notifications_enabled;       /* CCCD for OTA Status */
     int64_t last_contact_us;              /* Timestamp of last BLE interaction (FR-19) */
     TimerHandle_t galactic_notify_timer;  /* FreeRTOS timer for periodic notifications (FR-20) */
@@ -371,6 +476,7 @@ static ble_state_t s_ble = {
     .connected = false,
     .notifications_enabled = false,
     .galactic_notifications_enabled = false,
+    .spectrum_notifications_enabled = false,
     .ota_notifications_enabled = false,
     .last_contact_us = 0,
     .galactic_notify_timer = NULL,
@@ -380,6 +486,21 @@ static ble_state_t s_ble = {
 /* UART echo state */
 static bool s_uart_echo_initialized = false;
 
+/* One queued UART line; prefix and name are string literals */
+typedef struct {
+    const char *prefix;
+    const char *name;
+    uint8_t len;
+    uint8_t data[UART_TX_DATA_MAX];
+} uart_tx_line_t;
+
+static QueueHandle_t s_uart_tx_queue = NULL;
+static _Atomic uint32_t s_uart_tx_dropped;
+
+/* Serializes control commands from BLE (BTC task) and UART (RX task), and
+ * every status_value rewrite, timer task included (ctrl_lock()) */
+static SemaphoreHandle_t s_ctrl_mutex = NULL;
+
 /* Transient DSP state — not persisted in NVS, tracked locally for status notifications.
  * s_dsp_flags uses shieldStatus bit layout (GalacticStatus byte 2, per Protocol.md):
  *   Bit 0 (0x01): Mute
@@ -398,11 +519,19 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
 static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
                                 esp_ble_gatts_cb_param_t *param);
 static void handle_control_write(const uint8_t *data, uint16_t len);
+static void dispatch_control_write(const uint8_t *data, uint16_t len);
 static void update_status_value(void);
+static void sync_local_dsp(void);
 static void update_galactic_status_value(void);
+static void update_audio_metrics_value(void);
 static void galactic_notify_timer_callback(TimerHandle_t timer);
 static esp_err_t uart_echo_init(void);
+static void uart_rx_task(void *arg);
+static void uart_tx_task(void *arg);
 static void uart_echo_gatt_command(const char *char_name, const uint8_t *data, uint16_t len);
+static bool uart_send_hex_line(const char *prefix, const char *name, const uint8_t *data,
+                               uint16_t len);
+static void uart_send_schedule(const uint8_t *data, uint16_t len);
 
 /*
  * Initialize UART for serial echo of BLE GATT commands
@@ -437,6 +566,18 @@ static esp_err_t uart_echo_init(void)
         return ret;
     }
 
+    s_uart_tx_queue = xQueueCreate(UART_TX_QUEUE_LEN, sizeof(uart_tx_line_t));
+    if (s_uart_tx_queue == NULL ||
+        xTaskCreate(uart_tx_task, "uart_tx", UART_TX_TASK_STACK, NULL,
+                    UART_TX_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "UART sender not started");
+        if (s_uart_tx_queue != NULL) {
+            vQueueDelete(s_uart_tx_queue);
+            s_uart_tx_queue = NULL;
+        }
+        return ESP_ERR_NO_MEM;
+    }
+
     s_uart_echo_initialized = true;
     ESP_LOGI(TAG, "UART echo initialized on TX=GPIO%d, RX=GPIO%d @ %d baud",
              UART_ECHO_TX_PIN, UART_ECHO_RX_PIN, UART_ECHO_BAUD);
@@ -449,25 +590,196 @@ static esp_err_t uart_echo_init(void)
  */
 static void uart_echo_gatt_command(const char *char_name, const uint8_t *data, uint16_t len)
 {
-    if (!s_uart_echo_initialized || data == NULL || len == 0) {
+    if (data == NULL || len == 0) {
         return;
     }
 
-    /* Build message: "GATT:<char_name>:" + hex bytes + "\r\n" */
+    uart_send_hex_line("GATT", char_name, data, len);
+}
+
+/*
+ * Queue one "<prefix>:<name>:<hex_bytes>\r\n" line for the STM32
+ * Never blocks: any task may call this, the I2S writer included. Payloads
+ * longer than UART_TX_DATA_MAX are truncated; a full queue drops the line
+ * (counted, and reported by the sender).
+ *
+ * @param prefix Line prefix, a string literal
+ * @param name Line name, a string literal
+ * @return false if the line was dropped on a full queue
+ */
+static bool uart_send_hex_line(const char *prefix, const char *name, const uint8_t *data,
+                               uint16_t len)
+{
+    if (!s_uart_echo_initialized) {
+        return true;                /* No link: nothing to retry */
+    }
+
+    uart_tx_line_t line = {
+        .prefix = prefix,
+        .name = name,
+        .len = (uint8_t)((len > UART_TX_DATA_MAX) ? UART_TX_DATA_MAX : len),
+    };
+    if (line.len > 0) {
+        memcpy(line.data, data, line.len);
+    }
+    if (xQueueSend(s_uart_tx_queue, &line, 0) != pdTRUE) {
+        atomic_fetch_add_explicit(&s_uart_tx_dropped, 1, memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * UART sender task: formats and writes queued lines in order
+ * The UART has no TX ring buffer, so uart_write_bytes() returns once the
+ * line is in the hardware FIFO (about 10 ms for a long line at 115200).
+ */
+static void uart_tx_task(void *arg)
+{
+    (void)arg;
+    uart_tx_line_t line;
     char msg[128];
-    int offset = snprintf(msg, sizeof(msg), "GATT:%s:", char_name);
 
-    /* Append hex bytes */
-    for (uint16_t i = 0; i < len && offset < (int)(sizeof(msg) - 4); i++) {
-        offset += snprintf(msg + offset, sizeof(msg) - offset, "%02X", data[i]);
+    while (true) {
+        if (xQueueReceive(s_uart_tx_queue, &line, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        /* Build message: "<prefix>:<name>:" + hex bytes + "\r\n" */
+        int offset = snprintf(msg, sizeof(msg), "%s:%s:", line.prefix, line.name);
+        for (uint8_t i = 0; i < line.len && offset < (int)(sizeof(msg) - 4); i++) {
+            offset += snprintf(msg + offset, sizeof(msg) - offset, "%02X", line.data[i]);
+        }
+        offset += snprintf(msg + offset, sizeof(msg) - offset, "\r\n");
+
+        int written = uart_write_bytes(UART_ECHO_PORT, msg, offset);
+        ESP_LOGI(TAG, "UART echo: %s (wrote %d bytes)", msg, written);
+
+        uint32_t dropped = atomic_exchange_explicit(&s_uart_tx_dropped, 0, memory_order_relaxed);
+        if (dropped > 0) {
+            ESP_LOGW(TAG, "UART sender behind: %lu lines dropped", (unsigned long)dropped);
+        }
+    }
+}
+
+/*
+ * Whether the STM32 applies a control command to the audio (and so needs
+ * it stamped with an output frame)
+ */
+static bool dsp_cmd_is_scheduled(uint8_t cmd)
+{
+    switch (cmd) {
+    case DSP_CMD_SET_PRESET:
+    case DSP_CMD_SET_LOUDNESS:
+    case DSP_CMD_SET_MUTE:
+    case DSP_CMD_SET_AUDIO_DUCK:
+    case DSP_CMD_SET_NORMALIZER:
+    case DSP_CMD_SET_VOLUME:
+    case DSP_CMD_SET_BYPASS:
+    case DSP_CMD_SET_BASS_BOOST:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*
+ * Whether a control command is echoed to the STM32
+ * With AUDIO_GAIN_STAGE the bridge applies duck and volume itself, so the
+ * STM32 never sees them and cannot attenuate a second time.
+ */
+static bool dsp_cmd_is_forwarded(uint8_t cmd)
+{
+#ifdef AUDIO_GAIN_STAGE
+    return cmd != DSP_CMD_SET_AUDIO_DUCK && cmd != DSP_CMD_SET_VOLUME;
+#else
+    (void)cmd;
+    return true;
+#endif
+}
+
+/*
+ * Stamp a forwarded control command with the output frame it belongs to
+ * Format: "EVT:SCHED:<frame LE32><command bytes>\r\n", sent right after the
+ * GATT:CTRL echo of the same command. The frame is where the audio arriving
+ * from the phone now reaches the I2S pins (audio_pipeline.h).
+ */
+static void uart_send_schedule(const uint8_t *data, uint16_t len)
+{
+    if (data == NULL || len < 2 || len > DSP_CTRL_MAX_SIZE || !dsp_cmd_is_scheduled(data[0])) {
+        return;
+    }
+
+    uint32_t frame = audio_pipeline_get_schedule_frame();
+    uint8_t evt[4 + DSP_CTRL_MAX_SIZE] = {
+        (uint8_t)frame, (uint8_t)(frame >> 8), (uint8_t)(frame >> 16), (uint8_t)(frame >> 24)
+    };
+    memcpy(&evt[4], data, len);
+    uart_send_hex_line("EVT", "SCHED", evt, (uint16_t)(4 + len));
+}
+
+/*
+ * Decode one received line; only "CMD:CTRL:<hex>" is acted on
+ * Anything else the STM32 prints (logs, acks) is ignored.
+ */
+static void uart_rx_handle_line(const char *line, size_t len)
+{
+    const size_t prefix_len = sizeof(UART_RX_PREFIX) - 1;
+    if (len <= prefix_len || strncmp(line, UART_RX_PREFIX, prefix_len) != 0) {
+        return;
     }
 
-    /* Append newline */
-    offset += snprintf(msg + offset, sizeof(msg) - offset, "\r\n");
+    const char *hex = line + prefix_len;
+    size_t hex_len = len - prefix_len;
+    if ((hex_len & 1) != 0 || hex_len / 2 > DSP_CTRL_MAX_SIZE) {
+        ESP_LOGW(TAG, "UART command malformed: %.*s", (int)len, line);
+        return;
+    }
 
-    /* Send to UART */
-    int written = uart_write_bytes(UART_ECHO_PORT, msg, offset);
-    ESP_LOGI(TAG, "UART echo: %s (wrote %d bytes)", msg, written);
+    uint8_t data[DSP_CTRL_MAX_SIZE];
+    for (size_t i = 0; i < hex_len / 2; i++) {
+        char byte[3] = {hex[2 * i], hex[2 * i + 1], '\0'};
+        char *end;
+        data[i] = (uint8_t)strtoul(byte, &end, 16);
+        if (*end != '\0') {
+            ESP_LOGW(TAG, "UART command malformed: %.*s", (int)len, line);
+            return;
+        }
+    }
+
+    ESP_LOGI(TAG, "UART command: %.*s", (int)len, line);
+    dispatch_control_write(data, (uint16_t)(hex_len / 2));
+}
+
+/*
+ * UART receive task - assembles lines from the STM32
+ */
+static void uart_rx_task(void *arg)
+{
+    (void)arg;
+    uint8_t chunk[32];
+    char line[UART_RX_LINE_MAX];
+    size_t line_len = 0;
+    bool overflow = false;
+
+    while (1) {
+        int n = uart_read_bytes(UART_ECHO_PORT, chunk, sizeof(chunk), portMAX_DELAY);
+        for (int i = 0; i < n; i++) {
+            char c = (char)chunk[i];
+            if (c == '\r' || c == '\n') {
+                if (!overflow && line_len > 0) {
+                    local_dsp_note_dsp_alive();     /* Any line: the STM32 is there */
+                    uart_rx_handle_line(line, line_len);
+                }
+                line_len = 0;
+                overflow = false;
+            } else if (line_len < sizeof(line)) {
+                line[line_len++] = c;
+            } else {
+                overflow = true;    /* Drop the rest of an over-long line */
+            }
+        }
+    }
 }
 
 /*
@@ -510,6 +822,35 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
     }
 }
 
+/*
+ * Serialize against the control handlers: status_value and the STATUS
+ * attribute are rewritten from the BTC, UART RX and timer tasks
+ */
+static void ctrl_lock(void)
+{
+    if (s_ctrl_mutex != NULL) {
+        xSemaphoreTake(s_ctrl_mutex, portMAX_DELAY);
+    }
+}
+
+static void ctrl_unlock(void)
+{
+    if (s_ctrl_mutex != NULL) {
+        xSemaphoreGive(s_ctrl_mutex);
+    }
+}
+
+/*
+ * Run a control command from either transport
+ * BLE writes arrive on the BTC task and UART lines on the RX task.
+ */
+static void dispatch_control_write(const uint8_t *data, uint16_t len)
+{
+    ctrl_lock();
+    handle_control_write(data, len);
+    ctrl_unlock();
+}
+
 /*
  * Handle control write commands (Section 10.3)
  */
@@ -551,11 +892,13 @@ static void handle_control_write(const uint8_t *data, uint16_t len)
 
     case DSP_CMD_SET_MUTE:
         if (val) s_dsp_flags |= 0x01; else s_dsp_flags &= ~0x01;
+        audio_gain_set_mute(val != 0);  /* Also on the bridge: works with the DSP link down */
         ESP_LOGI(TAG, "Mute set to: %s (forwarded to UART)", val ? "ON" : "OFF");
         break;
 
     case DSP_CMD_SET_AUDIO_DUCK:
         if (val) s_dsp_flags |= 0x02; else s_dsp_flags &= ~0x02;
+        audio_gain_set_duck(val != 0);
         ESP_LOGI(TAG, "Audio Duck set to: %s (forwarded to UART)", val ? "ON" : "OFF");
         break;
 
@@ -566,6 +909,7 @@ static void handle_control_write(const uint8_t *data, uint16_t len)
 
     case DSP_CMD_SET_VOLUME:
         s_dsp_volume = val;
+        audio_gain_set_volume(val);
         ESP_LOGI(TAG, "Volume set to: %d%% (forwarded to UART)", val);
         break;
 
@@ -579,11 +923,120 @@ static void handle_control_write(const uint8_t *data, uint16_t len)
         ESP_LOGI(TAG, "Bass Boost set to: %s (forwarded to UART)", val ? "ON" : "OFF");
         break;
 
+    case DSP_CMD_SET_AUDIO_PROFILE: {
+        /* Deep profile is refused without PSRAM; only persist what applied */
+        esp_err_t ret = audio_pipeline_set_profile((audio_profile_t)val);
+        if (ret == ESP_OK) {
+            nvs_settings_set_audio_profile(val);
+            settings_changed = true;
+            ESP_LOGI(TAG, "Audio profile set to: %d", val);
+        } else {
+            ESP_LOGW(TAG, "Audio profile %d rejected: %s", val, esp_err_to_name(ret));
+        }
+        break;
+    }
+
+    case DSP_CMD_SET_TEST_SIGNAL: {
+        uint8_t atten = (len > 2) ? data[2] : 0;
+        uint16_t param = (len > 4) ? (uint16_t)(data[3] | (data[4] << 8)) : 0;
+        if (signal_gen_set((signal_gen_type_t)val, atten, param) == ESP_OK) {
+            ESP_LOGI(TAG, "Test signal set to: %d (-%d dBFS, param %u)", val, atten, param);
+        } else {
+            ESP_LOGW(TAG, "Invalid test signal: %d", val);
+        }
+        break;
+    }
+
+    case DSP_CMD_SET_ROUTING: {
+        /* Omitted trailing bytes mean 0 dB trim and no delay */
+        audio_route_config_t route = {
+            .flags = val,
+            .trim_l = (len > 2) ? data[2] : 0,
+            .trim_r = (len > 3) ? data[3] : 0,
+            .delay_l = (len > 5) ? (uint16_t)(data[4] | (data[5] << 8)) : 0,
+            .delay_r = (len > 7) ? (uint16_t)(data[6] | (data[7] << 8)) : 0,
+        };
+        if (audio_route_set(&route) == ESP_OK) {
+            nvs_settings_set_route(route.flags, route.trim_l, route.trim_r,
+                                   route.delay_l, route.delay_r);
+            settings_changed = true;
+            ESP_LOGI(TAG, "Routing set to: flags 0x%02X, trim %d/%d, delay %u/%u", route.flags,
+                     route.trim_l, route.trim_r, route.delay_l, route.delay_r);
+        } else {
+            ESP_LOGW(TAG, "Invalid routing: flags 0x%02X, delay %u/%u", route.flags,
+                     route.delay_l, route.delay_r);
+        }
+        break;
+    }
+
+    case DSP_CMD_CAPTURE: {
+        audio_capture_trigger_t trigger = (len > 2) ? (audio_capture_trigger_t)data[2] :
+                                          AUDIO_CAPTURE_NOW;
+        esp_err_t ret = audio_capture_arm(val, trigger);
+        if (ret == ESP_OK) {
+            ESP_LOGI(TAG, "PCM capture %s", val ? "armed" : "cancelled");
+        } else {
+            ESP_LOGW(TAG, "PCM capture rejected: %s", esp_err_to_name(ret));
+        }
+        break;
+    }
+
+    case DSP_CMD_SET_LOCAL_DSP:
+        if (local_dsp_set_mode((local_dsp_mode_t)val) == ESP_OK) {
+            nvs_settings_set_local_dsp(val);
+            settings_changed = true;
+            ESP_LOGI(TAG, "Local DSP set to: %s", (val == LOCAL_DSP_ON) ? "ON" :
+                     (val == LOCAL_DSP_AUTO) ? "AUTO" : "OFF");
+        } else {
+            ESP_LOGW(TAG, "Invalid local DSP mode: %d", val);
+        }
+        break;
+
+    case DSP_CMD_SET_OVERFLOW:
+        if (audio_pipeline_set_overflow_policy((audio_overflow_policy_t)val) == ESP_OK) {
+            nvs_settings_set_overflow_policy(val);
+            settings_changed = true;
+            ESP_LOGI(TAG, "Overflow policy set to: %s",
+                     (val == AUDIO_OVERFLOW_DROP_OLDEST) ? "DROP_OLDEST" :
+                     (val == AUDIO_OVERFLOW_TIME_COMPRESS) ? "COMPRESS" : "DROP_NEWEST");
+        } else {
+            ESP_LOGW(TAG, "Invalid overflow policy: %d", val);
+        }
+        break;
+
+    case DSP_CMD_SET_DSP_LATENCY: {
+        /* Same 0.1 ms unit as A2DP delay reports */
+        uint16_t tenths = (uint16_t)(val | ((len > 2) ? data[2] << 8 : 0));
+        audio_pipeline_set_dsp_latency_us((uint32_t)tenths * 100);
+        nvs_settings_set_dsp_latency(tenths);
+        settings_changed = true;
+        ESP_LOGI(TAG, "DSP latency set to: %u.%u ms", tenths / 10, tenths % 10);
+        break;
+    }
+
+    case DSP_CMD_SET_SPECTRUM_RATE:
+        if (spectrum_set_rate(val) == ESP_OK) {
+            ESP_LOGI(TAG, "Spectrum rate set to: %d Hz", val);
+        } else {
+            ESP_LOGW(TAG, "Invalid spectrum rate: %d", val);
+        }
+        break;
+
+    case DSP_CMD_SET_STANDBY:
+        nvs_settings_set_standby_timeout(val);
+        audio_pipeline_set_standby_timeout(val);
+        settings_changed = true;
+        ESP_LOGI(TAG, "Standby timeout set to: %d s", val);
+        break;
+
     default:
         ESP_LOGW(TAG, "Unknown command: 0x%02X", cmd);
         break;
     }
 
+    /* The local engine follows whatever the STM32 was just sent */
+    sync_local_dsp();
+
     /* Update status and notify */
     update_status_value();
     ble_gatt_dsp_notify_status();
@@ -594,6 +1047,24 @@ static void handle_control_write(const uint8_t *data, uint16_t len)
     }
 }
 
+/*
+ * Hand the current control state to the local DSP engine
+ */
+static void sync_local_dsp(void)
+{
+    nvs_dsp_settings_t settings;
+    nvs_settings_get(&settings);
+
+    local_dsp_state_t state = {
+        .preset = settings.preset_id,
+        .loudness = settings.loudness != 0,
+        .bass_boost = (s_dsp_flags & 0x20) != 0,
+        .normalizer = (s_dsp_flags & 0x08) != 0,
+        .bypass = (s_dsp_flags & 0x10) != 0,
+    };
+    local_dsp_set_state(&state);
+}
+
 /*
  * Update status characteristic value from DSP state
  */
@@ -604,16 +1075,20 @@ static void update_status_value(void)
 
     /* Build STATUS[3] FLAGS per Protocol.md Section 10.4 (different from shieldStatus!):
      *   Bit 0 (0x01): Limiter — always active
+     *   Bit 1 (0x02): Clipping — full-scale runs in the incoming PCM (held)
      *   Bit 3 (0x08): Muted
      *   Bit 4 (0x10): Audio Duck
      *   Bit 5 (0x20): Normalizer
      *   Bit 6 (0x40): Bypass
+     *   Bit 7 (0x80): Local DSP engine running
      */
     uint8_t flags3 = 0x01;  /* Limiter always active */
+    if (audio_clip_is_active()) flags3 |= 0x02;  /* Clipping → bit 1 */
     if (s_dsp_flags & 0x01) flags3 |= 0x08;  /* Mute    → bit 3 */
     if (s_dsp_flags & 0x02) flags3 |= 0x10;  /* Duck    → bit 4 */
     if (s_dsp_flags & 0x08) flags3 |= 0x20;  /* Norm    → bit 5 */
     if (s_dsp_flags & 0x10) flags3 |= 0x40;  /* Bypass  → bit 6 */
+    if (local_dsp_is_active()) flags3 |= 0x80;  /* Local DSP → bit 7 */
 
     status_value[0] = DSP_STATUS_PROTOCOL_VERSION;
     status_value[1] = settings.preset_id;
@@ -650,7 +1125,7 @@ static void update_galactic_status_value(void)
     galactic_value[0] = DSP_GALACTIC_PROTOCOL_VERSION;  /* Protocol version: 0x42 */
     galactic_value[1] = settings.preset_id;             /* currentQuantumFlavor */
     galactic_value[2] = shield_status;                  /* shieldStatus: all DSP feature flags */
-    galactic_value[3] = 100;                            /* energyCoreLevel (placeholder) */
+    galactic_value[3] = audio_meter_get_level();        /* energyCoreLevel (audio level 0-100) */
     galactic_value[4] = s_dsp_volume;                   /* distortionFieldStrength (volume 0-100) */
     galactic_value[5] = 100;                            /* battery (placeholder) */
     galactic_value[6] = (uint8_t)age_sec;               /* lastContact */
@@ -662,14 +1137,76 @@ static void update_galactic_status_value(void)
     }
 }
 
+/*
+ * Store a little-endian 32-bit value into a characteristic buffer
+ */
+static void put_le32(uint8_t *dst, uint32_t v)
+{
+    dst[0] = (uint8_t)v;
+    dst[1] = (uint8_t)(v >> 8);
+    dst[2] = (uint8_t)(v >> 16);
+    dst[3] = (uint8_t)(v >> 24);
+}
+
+/*
+ * Update AudioMetrics characteristic value from an audio_metrics snapshot
+ * Each call starts a new ring fill window, so min/max/avg/histogram cover
+ * one refresh interval.
+ */
+static void update_audio_metrics_value(void)
+{
+    audio_metrics_snapshot_t m;
+    audio_metrics_snapshot(&m);
+
+    metrics_value[0] = DSP_AUDIO_METRICS_VERSION;
+    metrics_value[1] = AUDIO_METRICS_HIST_BINS;
+    metrics_value[2] = (uint8_t)m.packets_per_sec;
+    metrics_value[3] = (uint8_t)(m.packets_per_sec >> 8);
+    put_le32(&metrics_value[4], m.fill_min);
+    put_le32(&metrics_value[8], m.fill_max);
+    put_le32(&metrics_value[12], m.fill_avg);
+    put_le32(&metrics_value[16], m.dropped_bytes);
+    put_le32(&metrics_value[20], m.underruns);
+    put_le32(&metrics_value[24], m.concealments);
+    put_le32(&metrics_value[28], m.i2s_bytes);
+    memcpy(&metrics_value[32], m.fill_hist_pct, AUDIO_METRICS_HIST_BINS);
+    put_le32(&metrics_value[40], m.writer_cpu_us);
+    put_le32(&metrics_value[44], m.standby_count);
+    put_le32(&metrics_value[48], m.standby_ms);
+    put_le32(&metrics_value[52], m.wake_latency_us);
+    put_le32(&metrics_value[56], jitter_buffer_get_target_ms());
+    put_le32(&metrics_value[60], jitter_buffer_get_jitter_us());
+    put_le32(&metrics_value[64], local_dsp_get_cycles_per_frame());
+
+    if (s_ble.gatts_if != ESP_GATT_IF_NONE && s_ble.handle_table[IDX_METRICS_VAL] != 0) {
+        esp_ble_gatts_set_attr_value(s_ble.handle_table[IDX_METRICS_VAL],
+                                     sizeof(metrics_value), metrics_value);
+    }
+}
+
 /*
  * Timer callback for periodic GalacticStatus notifications (FR-20)
- * Called 2x per second (every 500ms)
+ * Called 2x per second (every 500ms); also refreshes AudioMetrics. Runs
+ * whether or not a client is connected, so the ring fill window always
+ * covers one interval and a client reads a fresh value on connect.
  */
 static void galactic_notify_timer_callback(TimerHandle_t timer)
 {
     (void)timer;  /* Unused parameter */
 
+    update_audio_metrics_value();
+
+    if (s_ble.connected) {
+        /* Clip flag decays on its own: tell the client when it clears */
+        ctrl_lock();
+        bool clip_shown = (status_value[3] & 0x02) != 0;
+        if (audio_clip_is_active() != clip_shown) {
+            update_status_value();
+            ble_gatt_dsp_notify_status();
+        }
+        ctrl_unlock();
+    }
+
     if (s_ble.connected && s_ble.galactic_notifications_enabled) {
         ble_gatt_dsp_notify_galactic_status();
     }
@@ -746,12 +1283,9 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
         esp_ble_gap_update_conn_params(&conn_params);
 
         /* Send initial status notification */
+        ctrl_lock();
         update_status_value();
-
-        /* Start GalacticStatus notification timer (FR-20) */
-        if (s_ble.galactic_notify_timer != NULL) {
-            xTimerStart(s_ble.galactic_notify_timer, 0);
-        }
+        ctrl_unlock();
         break;
 
     case ESP_GATTS_DISCONNECT_EVT:
@@ -760,12 +1294,9 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
         s_ble.connected = false;
         s_ble.notifications_enabled = false;
         s_ble.galactic_notifications_enabled = false;
+        s_ble.spectrum_notifications_enabled = false;
         s_ble.ota_notifications_enabled = false;
-
-        /* Stop GalacticStatus notification timer (FR-20) */
-        if (s_ble.galactic_notify_timer != NULL) {
-            xTimerStop(s_ble.galactic_notify_timer, 0);
-        }
+        spectrum_set_enabled(false);
 
         /* Restart advertising (FR-15: BLE disconnect must not affect audio) */
         ble_gatt_dsp_start_advertising();
@@ -778,8 +1309,11 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
         if (!param->write.is_prep) {
             /* Handle write to control characteristic */
             if (param->write.handle == s_ble.handle_table[IDX_CTRL_VAL]) {
-                uart_echo_gatt_command("CTRL", param->write.value, param->write.len);
-                handle_control_write(param->write.value, param->write.len);
+                if (param->write.len > 0 && dsp_cmd_is_forwarded(param->write.value[0])) {
+                    uart_echo_gatt_command("CTRL", param->write.value, param->write.len);
+                    uart_send_schedule(param->write.value, param->write.len);
+                }
+                dispatch_control_write(param->write.value, param->write.len);
 
                 /* Send response if needed */
                 if (param->write.need_rsp) {
@@ -807,6 +1341,17 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
                              s_ble.galactic_notifications_enabled ? "enabled" : "disabled");
                 }
             }
+            /* Handle write to Spectrum CCC (starts and stops the analyser) */
+            else if (param->write.handle == s_ble.handle_table[IDX_SPECTRUM_CCC]) {
+                uart_echo_gatt_command("SPECTRUM_CCC", param->write.value, param->write.len);
+                if (param->write.len == 2) {
+                    uint16_t ccc_val = param->write.value[0] | (param->write.value[1] << 8);
+                    s_ble.spectrum_notifications_enabled = (ccc_val == 0x0001);
+                    spectrum_set_enabled(s_ble.spectrum_notifications_enabled);
+                    ESP_LOGI(TAG, "Spectrum notifications %s",
+                             s_ble.spectrum_notifications_enabled ? "enabled" : "disabled");
+                }
+            }
             /* Handle write to OTA Credentials characteristic */
             else if (param->write.handle == s_ble.handle_table[IDX_OTA_CREDS_VAL]) {
                 uart_echo_gatt_command("OTA_CREDS", param->write.value, param->write.len);
@@ -884,6 +1429,7 @@ esp_err_t ble_gatt_dsp_init(ble_dsp_settings_cb_t settings_changed_cb)
     nvs_dsp_settings_t boot_settings;
     nvs_settings_get(&boot_settings);
     if (boot_settings.loudness) s_dsp_flags |= 0x04;
+    sync_local_dsp();
 
     /* Initialize UART for serial echo of GATT commands */
     esp_err_t ret = uart_echo_init();
@@ -892,6 +1438,18 @@ esp_err_t ble_gatt_dsp_init(ble_dsp_settings_cb_t settings_changed_cb)
         /* Continue without serial echo - not critical for operation */
     }
 
+    /* Control commands may also arrive over the UART */
+    s_ctrl_mutex = xSemaphoreCreateMutex();
+    if (s_ctrl_mutex == NULL) {
+        ESP_LOGE(TAG, "Failed to create control mutex");
+        return ESP_ERR_NO_MEM;
+    }
+    if (s_uart_echo_initialized &&
+        xTaskCreate(uart_rx_task, "uart_rx", UART_RX_TASK_STACK, NULL,
+                    UART_RX_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGW(TAG, "UART command receiver not started (non-fatal)");
+    }
+
     /* Create GalacticStatus notification timer (FR-20: 2x per second) */
     s_ble.galactic_notify_timer = xTimerCreate(
         "galactic_notify",
@@ -904,6 +1462,7 @@ esp_err_t ble_gatt_dsp_init(ble_dsp_settings_cb_t settings_changed_cb)
         ESP_LOGE(TAG, "Failed to create GalacticStatus notification timer");
         return ESP_ERR_NO_MEM;
     }
+    xTimerStart(s_ble.galactic_notify_timer, 0);
 
     /* Register GAP callback */
     ret = esp_ble_gap_register_callback(gap_event_handler);
@@ -999,6 +1558,38 @@ esp_err_t ble_gatt_dsp_notify_galactic_status(void)
     return ret;
 }
 
+esp_err_t ble_gatt_dsp_notify_spectrum(const uint8_t *levels, uint8_t bands, uint8_t skipped)
+{
+    if (!s_ble.connected || !s_ble.spectrum_notifications_enabled) {
+        return ESP_OK;  /* Not an error, just nothing to do */
+    }
+
+    if (levels == NULL || bands > DSP_SPECTRUM_SIZE - DSP_SPECTRUM_HEADER_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    spectrum_value[0] = DSP_SPECTRUM_VERSION;
+    spectrum_value[1]++;                            /* Sequence */
+    spectrum_value[2] = skipped;
+    spectrum_value[3] = bands;
+    memcpy(&spectrum_value[DSP_SPECTRUM_HEADER_SIZE], levels, bands);
+    uint16_t len = DSP_SPECTRUM_HEADER_SIZE + bands;
+
+    if (s_ble.gatts_if != ESP_GATT_IF_NONE && s_ble.handle_table[IDX_SPECTRUM_VAL] != 0) {
+        esp_ble_gatts_set_attr_value(s_ble.handle_table[IDX_SPECTRUM_VAL], len, spectrum_value);
+    }
+
+    /* Frequent and disposable: a congested link just loses frames */
+    esp_err_t ret = esp_ble_gatts_send_indicate(s_ble.gatts_if, s_ble.conn_id,
+                                                 s_ble.handle_table[IDX_SPECTRUM_VAL],
+                                                 len, spectrum_value, false);
+    if (ret != ESP_OK) {
+        ESP_LOGD(TAG, "Spectrum notification failed: %s", esp_err_to_name(ret));
+    }
+
+    return ret;
+}
+
 bool ble_gatt_dsp_is_connected(void)
 {
     return s_ble.connected;
@@ -1041,3 +1632,29 @@ esp_err_t ble_gatt_dsp_notify_ota_status(const uint8_t *status)
 
     return ret;
 }
+
+bool ble_gatt_dsp_send_dsp_event(const char *name, const uint8_t *data, uint16_t len)
+{
+    if (name == NULL) {
+        return true;
+    }
+
+    return uart_send_hex_line("EVT", name, data, (data != NULL) ? len : 0);
+}
+
+/* Timer-task side of ble_gatt_dsp_post_status_notify() */
+static void pended_status_notify(void *arg1, uint32_t arg2)
+{
+    (void)arg1;
+    (void)arg2;
+    ctrl_lock();
+    update_status_value();
+    ble_gatt_dsp_notify_status();
+    ctrl_unlock();
+}
+
+void ble_gatt_dsp_post_status_notify(void)
+{
+    /* Dropped if the timer queue is full; the 500 ms timer catches up */
+    xTimerPendFunctionCall(pended_status_notify, NULL, 0, 0);
+}
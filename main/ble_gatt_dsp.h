@@ -81,10 +81,24 @@ extern "C" {
     0x78, 0x56, 0x34, 0x12, 0x08, 0x00, 0x00, 0x00 \
 }
 
+/* AudioMetrics Characteristic UUID: 00000009-1234-5678-9ABC-DEF012345678 */
+#define DSP_AUDIO_METRICS_CHAR_UUID_128 { \
+    0x78, 0x56, 0x34, 0x12, 0xF0, 0xDE, 0xBC, 0x9A, \
+    0x78, 0x56, 0x34, 0x12, 0x09, 0x00, 0x00, 0x00 \
+}
+
+/* Spectrum Characteristic UUID: 0000000A-1234-5678-9ABC-DEF012345678 */
+#define DSP_SPECTRUM_CHAR_UUID_128 { \
+    0x78, 0x56, 0x34, 0x12, 0xF0, 0xDE, 0xBC, 0x9A, \
+    0x78, 0x56, 0x34, 0x12, 0x0A, 0x00, 0x00, 0x00 \
+}
+
 /*
  * Control Protocol (Section 10.3)
- * Format: [CMD (1 byte)] [VAL (1 byte)]
+ * Format: [CMD (1 byte)] [VAL (1 byte)] [ARGS (optional, command-specific)]
+ * Also accepted from the DSP UART as "CMD:CTRL:<hex bytes>" lines.
  */
+#define DSP_CTRL_MAX_SIZE       8
 #define DSP_CMD_SET_PRESET      0x01    /* VAL: 0-3 (preset ID) */
 #define DSP_CMD_SET_LOUDNESS    0x02    /* VAL: 0/1 (off/on) */
 #define DSP_CMD_GET_STATUS      0x03    /* VAL: 0 (triggers notify) */
@@ -94,6 +108,15 @@ extern "C" {
 #define DSP_CMD_SET_VOLUME      0x07    /* VAL: 0-100 (volume trim) - FR-24: device volume control */
 #define DSP_CMD_SET_BYPASS      0x08    /* VAL: 0/1 (off/on) - Skip EQ, keep safety (debug) */
 #define DSP_CMD_SET_BASS_BOOST  0x09    /* VAL: 0/1 (off/on) - Bass boost (+8dB @ 100Hz) */
+#define DSP_CMD_SET_AUDIO_PROFILE 0x0A  /* VAL: 0/1/2 (robust/low-latency/deep) - buffering and DMA layout */
+#define DSP_CMD_SET_STANDBY     0x0B    /* VAL: 0-255 (seconds of silence before standby, 0 = never) */
+#define DSP_CMD_SET_TEST_SIGNAL 0x0C    /* VAL: signal type, ARGS: [atten dB] [param LE16] (signal_gen.h) */
+#define DSP_CMD_SET_ROUTING     0x0D    /* VAL: route flags, ARGS: [trim L] [trim R] [delay L LE16] [delay R LE16] */
+#define DSP_CMD_CAPTURE         0x0E    /* VAL: seconds (0 = cancel), ARGS: [trigger] (audio_capture.h) */
+#define DSP_CMD_SET_LOCAL_DSP   0x0F    /* VAL: 0/1/2 (off/on/auto) - local fallback DSP (local_dsp.h) */
+#define DSP_CMD_SET_SPECTRUM_RATE 0x10  /* VAL: 1-25 (Spectrum notifications per second, not persisted) */
+#define DSP_CMD_SET_OVERFLOW    0x11    /* VAL: 0/1/2 (drop-newest/drop-oldest/compress) - ring overflow policy */
+#define DSP_CMD_SET_DSP_LATENCY 0x12    /* VAL: low byte, ARGS: [high byte] - STM32 latency in 0.1 ms (delay reports) */
 
 /*
  * OTA Commands (Section 10.5)
@@ -127,7 +150,7 @@ extern "C" {
  * Byte 0: Protocol version (0x42)
  * Byte 1: currentQuantumFlavor (preset 0-3)
  * Byte 2: shieldStatus (flags: mute, audio duck, loudness, normalizer)
- * Byte 3: energyCoreLevel (0-100, placeholder)
+ * Byte 3: energyCoreLevel (audio RMS level 0-100, -60..0 dBFS)
  * Byte 4: distortionFieldStrength (volume 0-100)
  * Byte 5: Energy core (battery 0-100, placeholder)
  * Byte 6: lastContact (seconds since last BLE interaction, 0-255)
@@ -135,6 +158,43 @@ extern "C" {
 #define DSP_GALACTIC_PROTOCOL_VERSION  0x42
 #define DSP_GALACTIC_STATUS_SIZE       7
 
+/*
+ * AudioMetrics Payload (read-only, refreshed every 500 ms, connected or not)
+ * All multi-byte fields little-endian
+ * Byte 0:      Protocol version (0x05)
+ * Byte 1:      Histogram bin count (8)
+ * Byte 2-3:    A2DP packets per second
+ * Byte 4-7:    Ring fill min (bytes, over the last refresh interval)
+ * Byte 8-11:   Ring fill max (bytes, over the last refresh interval)
+ * Byte 12-15:  Ring fill average (bytes, over the last refresh interval)
+ * Byte 16-19:  Dropped bytes (ring full, cumulative)
+ * Byte 20-23:  Underruns (ring ran dry and re-buffered, cumulative)
+ * Byte 24-27:  Concealment events (cumulative)
+ * Byte 28-31:  Bytes written to I2S (free-running, wraps)
+ * Byte 32-39:  Ring fill histogram, % of samples per 1/8 of the active ring limit
+ * Byte 40-43:  I2S writer CPU time per second of audio (us, 0 = not available)
+ * Byte 44-47:  Output standby entries (cumulative)
+ * Byte 48-51:  Time in standby (ms, cumulative, includes the current one)
+ * Byte 52-55:  Last wake latency (us, first audible packet to I2S restart)
+ * Byte 56-59:  Jitter buffer target (ms of audio the writer keeps queued)
+ * Byte 60-63:  Measured arrival jitter (us, worst lateness in the window)
+ * Byte 64-67:  Local DSP engine CPU cycles per frame (0 = engine not running)
+ */
+#define DSP_AUDIO_METRICS_VERSION      0x05
+#define DSP_AUDIO_METRICS_SIZE         68
+
+/*
+ * Spectrum Payload (notify only, while subscribed; spectrum.h)
+ * Byte 0:      Protocol version (0x01)
+ * Byte 1:      Sequence number (wraps)
+ * Byte 2:      Frames dropped since the last notification (analysis behind, saturates)
+ * Byte 3:      Band count (16)
+ * Byte 4-19:   Band levels, low to high: 0.5 dB steps, 160 = full-scale sine, 0 = -80 dB or below
+ */
+#define DSP_SPECTRUM_VERSION           0x01
+#define DSP_SPECTRUM_HEADER_SIZE       4
+#define DSP_SPECTRUM_SIZE              20
+
 /*
  * BLE advertising configuration
  */
@@ -178,12 +238,20 @@ esp_err_t ble_gatt_dsp_stop_advertising(void);
 
 /*
  * Send status notification to connected client
- * Called after settings change or when client requests status
+ * Called after settings change or when client requests status. Rewrites
+ * the status value, so it belongs to the control handler, which holds the
+ * control lock; other tasks use ble_gatt_dsp_post_status_notify().
  *
  * @return ESP_OK on success
  */
 esp_err_t ble_gatt_dsp_notify_status(void);
 
+/*
+ * Queue a status notification from the timer task
+ * For audio-path events (e.g. clipping): safe from any task, never blocks.
+ */
+void ble_gatt_dsp_post_status_notify(void);
+
 /*
  * Send GalacticStatus notification to connected client (FR-18, FR-20)
  * Contains 7-byte payload with extended status information
@@ -192,6 +260,16 @@ esp_err_t ble_gatt_dsp_notify_status(void);
  */
 esp_err_t ble_gatt_dsp_notify_galactic_status(void);
 
+/*
+ * Send a Spectrum notification to a subscribed client (spectrum task)
+ *
+ * @param levels Band levels
+ * @param bands Number of bands (at most DSP_SPECTRUM_SIZE - DSP_SPECTRUM_HEADER_SIZE)
+ * @param skipped Frames dropped since the last notification
+ * @return ESP_OK on success (also when nobody is subscribed)
+ */
+esp_err_t ble_gatt_dsp_notify_spectrum(const uint8_t *levels, uint8_t bands, uint8_t skipped);
+
 /*
  * Send OTA status notification to connected client
  * Contains 8-byte payload with OTA progress information
@@ -201,6 +279,21 @@ esp_err_t ble_gatt_dsp_notify_galactic_status(void);
  */
 esp_err_t ble_gatt_dsp_notify_ota_status(const uint8_t *status);
 
+/*
+ * Send an event line to the STM32 DSP over the UART link
+ * Format: "EVT:<name>:<hex_bytes>\r\n" (same framing as the GATT echo)
+ * Safe to call from any task, the I2S writer included: the line is queued
+ * and a low-priority task writes it, in order with every other UART line.
+ * Never blocks; dropped (and counted) if the queue is full.
+ *
+ * @param name Event name, a string literal (e.g. "RATE")
+ * @param data Event payload, may be NULL
+ * @param len Payload length in bytes
+ * @return false if the event was dropped on a full queue (true without a
+ *         UART link, where there is nothing to retry)
+ */
+bool ble_gatt_dsp_send_dsp_event(const char *name, const uint8_t *data, uint16_t len);
+
 /*
  * Check if a BLE client is connected
  *
@@ -0,0 +1,200 @@
+/*
+ * Adaptive Jitter Buffer Implementation
+ *
+ * lateness = max(0, lateness + (gap - prev_duration) - drift_allowance)
+ * jitter   = max(lateness) over the last JB_WINDOW_SLOTS slots
+ * target   = jitter + JB_MARGIN_MS, clamped to the current bounds
+ *            (JB_TARGET_MIN_MS..JB_TARGET_MAX_MS unless an audio profile
+ *            has set others)
+ *
+ * Date: 2026-10-16
+ */
+
+#include "jitter_buffer.h"
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#define US_PER_SEC          1000000LL
+#define SLOT_US             ((int64_t)JB_SLOT_MS * 1000)
+#define PAUSE_GAP_US        ((int64_t)JB_PAUSE_GAP_MS * 1000)
+#define FRAME_BYTES         4       /* 16-bit stereo */
+
+/* Estimator state — owned by the BTC task */
+typedef struct {
+    uint32_t bytes_per_sec;
+    bool started;
+    int64_t last_arrival_us;
+    int64_t last_duration_us;       /* PCM duration of the previous packet */
+    int64_t lateness_us;
+
+    /* Current (open) slot peak, then closed slot peaks */
+    int64_t slot_start_us;
+    int64_t slot_peak_us;
+    int64_t win_peak_us[JB_WINDOW_SLOTS];
+    uint8_t win_idx;
+    uint8_t win_filled;
+
+    uint32_t target_us;
+} jb_state_t;
+
+static jb_state_t s_jb;
+
+/* Published values (read from the writer task / BLE) */
+static _Atomic uint32_t s_target_bytes;
+static _Atomic uint32_t s_target_ms;
+static _Atomic uint32_t s_jitter_us;
+
+/* Target bounds (any task writes, BTC task reads) */
+static _Atomic uint32_t s_min_ms = JB_TARGET_MIN_MS;
+static _Atomic uint32_t s_default_ms = JB_TARGET_DEFAULT_MS;
+static _Atomic uint32_t s_max_ms = JB_TARGET_MAX_MS;
+static atomic_bool s_bounds_changed = false;
+
+static void publish(int64_t jitter_us)
+{
+    uint64_t bytes = (uint64_t)s_jb.target_us * s_jb.bytes_per_sec / US_PER_SEC;
+    atomic_store_explicit(&s_target_bytes, (uint32_t)bytes & ~(uint32_t)(FRAME_BYTES - 1),
+                          memory_order_relaxed);
+    atomic_store_explicit(&s_target_ms, s_jb.target_us / 1000, memory_order_relaxed);
+    atomic_store_explicit(&s_jitter_us, (uint32_t)jitter_us, memory_order_relaxed);
+}
+
+static uint32_t target_for(int64_t jitter_us)
+{
+    int64_t min_us = (int64_t)atomic_load_explicit(&s_min_ms, memory_order_relaxed) * 1000;
+    int64_t max_us = (int64_t)atomic_load_explicit(&s_max_ms, memory_order_relaxed) * 1000;
+    int64_t us = jitter_us + JB_MARGIN_MS * 1000;
+    if (us < min_us) {
+        return (uint32_t)min_us;
+    }
+    if (us > max_us) {
+        return (uint32_t)max_us;
+    }
+    return (uint32_t)us;
+}
+
+/* Peak lateness over the closed slots of the window */
+static int64_t window_peak(void)
+{
+    int64_t peak = 0;
+    for (uint8_t i = 0; i < s_jb.win_filled; i++) {
+        if (s_jb.win_peak_us[i] > peak) {
+            peak = s_jb.win_peak_us[i];
+        }
+    }
+    return peak;
+}
+
+/*
+ * Close the current slot: push its peak into the window and re-evaluate
+ * Increases already happened per packet; this is where the slow decay lives.
+ */
+static void close_slot(int64_t now_us)
+{
+    s_jb.win_peak_us[s_jb.win_idx] = s_jb.slot_peak_us;
+    s_jb.win_idx = (s_jb.win_idx + 1) % JB_WINDOW_SLOTS;
+    if (s_jb.win_filled < JB_WINDOW_SLOTS) {
+        s_jb.win_filled++;
+    }
+    s_jb.slot_start_us = now_us;
+    s_jb.slot_peak_us = s_jb.lateness_us;
+
+    int64_t peak = window_peak();
+
+    /* Only decay once a full window backs the lower estimate */
+    uint32_t wanted = target_for(peak);
+    if (wanted < s_jb.target_us && s_jb.win_filled == JB_WINDOW_SLOTS) {
+        uint32_t floor_us = s_jb.target_us - JB_DECAY_MS_PER_SLOT * 1000;
+        s_jb.target_us = (wanted > floor_us) ? wanted : floor_us;
+    } else if (wanted > s_jb.target_us) {
+        s_jb.target_us = wanted;
+    }
+
+    publish(peak);
+}
+
+void jitter_buffer_reset(uint32_t sample_rate)
+{
+    memset(&s_jb, 0, sizeof(s_jb));
+    s_jb.bytes_per_sec = sample_rate * FRAME_BYTES;
+    s_jb.target_us = atomic_load_explicit(&s_default_ms, memory_order_relaxed) * 1000;
+    publish(0);
+}
+
+void jitter_buffer_set_bounds(uint32_t min_ms, uint32_t default_ms, uint32_t max_ms)
+{
+    atomic_store_explicit(&s_min_ms, min_ms, memory_order_relaxed);
+    atomic_store_explicit(&s_default_ms, default_ms, memory_order_relaxed);
+    atomic_store_explicit(&s_max_ms, max_ms, memory_order_relaxed);
+    atomic_store_explicit(&s_bounds_changed, true, memory_order_release);
+}
+
+void jitter_buffer_on_packet(int64_t now_us, uint32_t len)
+{
+    if (s_jb.bytes_per_sec == 0) {
+        return;
+    }
+
+    int64_t duration_us = (int64_t)len * US_PER_SEC / s_jb.bytes_per_sec;
+
+    if (atomic_exchange_explicit(&s_bounds_changed, false, memory_order_acquire)) {
+        /* New bounds: re-derive from what has been measured so far */
+        int64_t peak = window_peak();
+        if (s_jb.slot_peak_us > peak) {
+            peak = s_jb.slot_peak_us;
+        }
+        s_jb.target_us = (s_jb.win_filled > 0 || peak > 0) ? target_for(peak) :
+                         atomic_load_explicit(&s_default_ms, memory_order_relaxed) * 1000;
+        publish(peak);
+    }
+
+    if (!s_jb.started || now_us - s_jb.last_arrival_us > PAUSE_GAP_US) {
+        /* First packet, or first one after a pause: nothing to compare with */
+        if (!s_jb.started) {
+            s_jb.slot_start_us = now_us;
+        }
+        s_jb.started = true;
+        s_jb.lateness_us = 0;
+    } else {
+        int64_t gap_us = now_us - s_jb.last_arrival_us;
+        int64_t allowance_us = s_jb.last_duration_us * JB_DRIFT_ALLOWANCE_PPM / 1000000;
+        s_jb.lateness_us += gap_us - s_jb.last_duration_us - allowance_us;
+        if (s_jb.lateness_us < 0) {
+            s_jb.lateness_us = 0;
+        }
+    }
+
+    s_jb.last_arrival_us = now_us;
+    s_jb.last_duration_us = duration_us;
+
+    if (s_jb.lateness_us > s_jb.slot_peak_us) {
+        s_jb.slot_peak_us = s_jb.lateness_us;
+
+        /* Fast attack: raise the target as soon as lateness exceeds it */
+        uint32_t wanted = target_for(s_jb.lateness_us);
+        if (wanted > s_jb.target_us) {
+            s_jb.target_us = wanted;
+            publish(s_jb.lateness_us);
+        }
+    }
+
+    if (now_us - s_jb.slot_start_us >= SLOT_US) {
+        close_slot(now_us);
+    }
+}
+
+uint32_t jitter_buffer_get_target_bytes(void)
+{
+    return atomic_load_explicit(&s_target_bytes, memory_order_relaxed);
+}
+
+uint32_t jitter_buffer_get_target_ms(void)
+{
+    return atomic_load_explicit(&s_target_ms, memory_order_relaxed);
+}
+
+uint32_t jitter_buffer_get_jitter_us(void)
+{
+    return atomic_load_explicit(&s_jitter_us, memory_order_relaxed);
+}
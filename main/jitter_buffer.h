@@ -0,0 +1,107 @@
+/*
+ * Adaptive Jitter Buffer
+ * Packet inter-arrival jitter → dynamic pre-buffer target
+ *
+ * Each A2DP packet's inter-arrival gap is compared with the PCM duration
+ * of the previous packet. The running lateness
+ *
+ *     L = max(0, L + (gap - duration) - drift_allowance)
+ *
+ * is how far the source has fallen behind its own best recent schedule;
+ * early packets (start-up bursts) pull it back to zero instead of counting
+ * as jitter. The peak of L over a sliding window is the amount of audio
+ * the ring must hold for the writer not to run dry.
+ *
+ * The target rises immediately when a burstier source shows up and decays
+ * slowly once the source settles, so stable phones get lower latency and
+ * bursty ones get fewer underruns.
+ *
+ * Threading: jitter_buffer_reset() and jitter_buffer_on_packet() must be
+ * called from the same task (the BTC task). jitter_buffer_set_bounds() and
+ * the getters are lock-free and safe from any task.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Default target bounds (ms of audio in the ring) */
+#define JB_TARGET_MIN_MS        20
+#define JB_TARGET_MAX_MS        150
+#define JB_TARGET_DEFAULT_MS    50      /* Until enough arrivals are seen */
+
+/* Safety margin added on top of the measured peak lateness */
+#define JB_MARGIN_MS            10
+
+/* Slow clock drift absorbed per packet rather than counted as lateness */
+#define JB_DRIFT_ALLOWANCE_PPM  500
+
+/* Jitter window: JB_WINDOW_SLOTS slots of JB_SLOT_MS each (~4 s) */
+#define JB_SLOT_MS              500
+#define JB_WINDOW_SLOTS         8
+
+/* Maximum target decrease per slot (slow decay, fast attack) */
+#define JB_DECAY_MS_PER_SLOT    2
+
+/* Arrival gap treated as a stream pause rather than jitter */
+#define JB_PAUSE_GAP_MS         500
+
+/*
+ * Reset jitter statistics for a new stream or sample rate
+ *
+ * @param sample_rate Stream sample rate in Hz (16-bit stereo assumed)
+ */
+void jitter_buffer_reset(uint32_t sample_rate);
+
+/*
+ * Change the target bounds (audio profile switch)
+ * Takes effect on the next packet: the target is re-derived from the
+ * jitter already measured, so it may drop or rise at once.
+ *
+ * @param min_ms Lowest target
+ * @param default_ms Target until enough arrivals are seen
+ * @param max_ms Highest target
+ */
+void jitter_buffer_set_bounds(uint32_t min_ms, uint32_t default_ms, uint32_t max_ms);
+
+/*
+ * Record one packet arrival (BTC task)
+ *
+ * @param now_us Arrival timestamp (esp_timer_get_time())
+ * @param len Packet length in bytes
+ */
+void jitter_buffer_on_packet(int64_t now_us, uint32_t len);
+
+/*
+ * Get current pre-buffer target
+ *
+ * @return Target ring fill in bytes, frame aligned
+ */
+uint32_t jitter_buffer_get_target_bytes(void);
+
+/*
+ * Get current pre-buffer target
+ *
+ * @return Target ring fill in milliseconds
+ */
+uint32_t jitter_buffer_get_target_ms(void);
+
+/*
+ * Get measured jitter (peak lateness over the window)
+ *
+ * @return Jitter in microseconds
+ */
+uint32_t jitter_buffer_get_jitter_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JITTER_BUFFER_H */
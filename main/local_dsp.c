@@ -0,0 +1,577 @@
+/*
+ * Local Fallback DSP Engine Implementation
+ *
+ * Samples are widened to 24-bit scale in 32-bit words, so EQ boosts have
+ * headroom above 16-bit full scale and the limiter brings them back
+ * before the final rounding. Biquads are direct form I with Q29
+ * coefficients and a 64-bit accumulator, and each section runs over the
+ * whole block one channel at a time, so its coefficients stay in
+ * registers. Filters are designed in double precision (low shelves near
+ * 30 Hz need it), and only when the EQ or the sample rate changes.
+ *
+ * Dynamics are computed once per SEGMENT_FRAMES from the peak of that
+ * segment, in float at control rate. Because the peak is taken before the
+ * segment plays, the limiter needs no separate look-ahead: a lower gain is
+ * applied from the segment's first sample, so no sample of it exceeds the
+ * -1 dBFS ceiling, and only recovery is ramped (Q16, linear per segment).
+ *
+ * Cost is measured on target with the CPU cycle counter and published
+ * once per second of audio, for each configuration as it runs.
+ *
+ * Date: 2026-10-16
+ */
+
+#include "local_dsp.h"
+#include "audio_gain.h"
+#include <math.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+
+static const char *TAG = "LOCAL_DSP";
+
+/* Working scale: 16-bit samples << SAMPLE_SHIFT */
+#define SAMPLE_SHIFT        8
+#define FULL_SCALE          (32768.0f * (1 << SAMPLE_SHIFT))
+
+/* Biquad coefficients in Q29 (range ±4: shelf b1 can approach -2) */
+#define COEF_SHIFT          29
+
+#define MAX_SECTIONS        6
+#define PRESET_SECTIONS     3
+#define PRESET_COUNT        4
+
+/* Largest writer block (480-frame DMA) */
+#define BLOCK_FRAMES_MAX    480
+
+/* Dynamics: one gain computation per segment */
+#define SEGMENT_FRAMES      32
+#define GAIN_SHIFT          16
+#define GAIN_UNITY          (1 << GAIN_SHIFT)
+
+/* Limiter */
+#define LIMIT_CEILING_DB    (-1.0f)
+#define LIMIT_RELEASE_MS    100.0f
+
+/* Normalizer (protocol.md reference settings) */
+#define COMP_THRESHOLD_DB   (-20.0f)
+#define COMP_RATIO          4.0f
+#define COMP_ATTACK_MS      7.0f
+#define COMP_RELEASE_MS     150.0f
+#define COMP_MAKEUP_DB      6.0f
+#define COMP_FLOOR_DB       (-120.0f)
+
+/* Packed control state: preset | loudness | bass boost | normalizer | bypass */
+#define ST_PRESET_MASK      0x03
+#define ST_LOUDNESS         0x04
+#define ST_BASS             0x08
+#define ST_NORMALIZER       0x10
+#define ST_BYPASS           0x20
+#define ST_EQ_MASK          (ST_PRESET_MASK | ST_LOUDNESS | ST_BASS | ST_BYPASS)
+
+/* Committed EQ word: EQ state bits | engine running */
+#define EQ_ACTIVE           0x100
+
+typedef enum {
+    BQ_NONE = 0,
+    BQ_HIGHPASS,
+    BQ_LOW_SHELF,
+    BQ_HIGH_SHELF,
+    BQ_PEAK,
+} bq_type_t;
+
+typedef struct {
+    bq_type_t type;
+    float hz;
+    float gain_db;
+    float q;
+} bq_spec_t;
+
+/* Preset voicings, OFFICE / FULL / NIGHT / SPEECH */
+static const bq_spec_t s_presets[PRESET_COUNT][PRESET_SECTIONS] = {
+    {   /* OFFICE: balanced, less boxiness from a small enclosure */
+        {BQ_HIGHPASS, 40.0f, 0.0f, 0.707f},
+        {BQ_PEAK, 250.0f, -2.0f, 1.0f},
+    },
+    {   /* FULL: more bass presence and a little air */
+        {BQ_HIGHPASS, 30.0f, 0.0f, 0.707f},
+        {BQ_LOW_SHELF, 120.0f, 4.0f, 0.707f},
+        {BQ_HIGH_SHELF, 8000.0f, 2.0f, 0.707f},
+    },
+    {   /* NIGHT: bass that does not carry through walls, forward mids */
+        {BQ_HIGHPASS, 60.0f, 0.0f, 0.707f},
+        {BQ_LOW_SHELF, 150.0f, -4.0f, 0.707f},
+        {BQ_PEAK, 2500.0f, 2.0f, 1.0f},
+    },
+    {   /* SPEECH: voice band forward, rumble and sibilance down */
+        {BQ_HIGHPASS, 100.0f, 0.0f, 0.707f},
+        {BQ_PEAK, 2500.0f, 4.0f, 1.0f},
+        {BQ_HIGH_SHELF, 8000.0f, -3.0f, 0.707f},
+    },
+};
+
+/* Loudness contour */
+static const bq_spec_t s_loudness[2] = {
+    {BQ_LOW_SHELF, 100.0f, 6.0f, 0.707f},
+    {BQ_HIGH_SHELF, 10000.0f, 3.0f, 0.707f},
+};
+
+/* Bass boost (+8 dB @ 100 Hz, as on the STM32) */
+static const bq_spec_t s_bass_boost = {BQ_PEAK, 100.0f, 8.0f, 0.7f};
+
+typedef struct {
+    int32_t b0, b1, b2, a1, a2;
+} biquad_t;
+
+typedef struct {
+    int32_t x1, x2, y1, y2;
+} biquad_hist_t;
+
+/* Engine state — owned by the writer task */
+typedef struct {
+    uint32_t eq;                    /* Committed EQ word */
+    uint32_t sample_rate;           /* Rate the filters were designed for (0: redesign) */
+    int sections;
+    biquad_t coef[MAX_SECTIONS];
+    biquad_hist_t hist[MAX_SECTIONS][2];
+    float comp_env_db;              /* Normalizer level envelope */
+    float comp_attack;              /* Smoothing factors per segment */
+    float comp_release;
+    float limit_gain;               /* Limiter gain, linear */
+    float limit_release;
+    int32_t gain;                   /* Q16 dynamics gain reached at the last segment */
+    uint64_t cycles;                /* Cost measurement window */
+    uint32_t frames;
+    bool over_budget;
+    int32_t work[BLOCK_FRAMES_MAX * 2];
+} engine_t;
+
+static engine_t s_eng;
+
+/* Requested state and STM32 presence (any task writes, writer reads) */
+static _Atomic uint32_t s_state;
+static _Atomic int s_mode = LOCAL_DSP_OFF;
+static _Atomic uint32_t s_alive_ms;
+static atomic_bool s_alive_seen = false;
+
+/* Writer-published */
+static atomic_bool s_active = false;
+static _Atomic uint32_t s_cycles_per_frame;
+
+/*
+ * RBJ cookbook biquad in Q29
+ */
+static biquad_t biquad_design(const bq_spec_t *spec, uint32_t sample_rate)
+{
+    double hz = spec->hz;
+    if (hz > 0.45 * sample_rate) {
+        hz = 0.45 * sample_rate;
+    }
+    double w0 = 2.0 * M_PI * hz / sample_rate;
+    double c = cos(w0);
+    double alpha = sin(w0) / (2.0 * spec->q);
+    double a = pow(10.0, spec->gain_db / 40.0);
+    double sa = 2.0 * sqrt(a) * alpha;
+    double b0, b1, b2, a0, a1, a2;
+
+    switch (spec->type) {
+    case BQ_HIGHPASS:
+        b0 = (1.0 + c) / 2.0;
+        b1 = -(1.0 + c);
+        b2 = (1.0 + c) / 2.0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * c;
+        a2 = 1.0 - alpha;
+        break;
+
+    case BQ_LOW_SHELF:
+        b0 = a * ((a + 1.0) - (a - 1.0) * c + sa);
+        b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * c);
+        b2 = a * ((a + 1.0) - (a - 1.0) * c - sa);
+        a0 = (a + 1.0) + (a - 1.0) * c + sa;
+        a1 = -2.0 * ((a - 1.0) + (a + 1.0) * c);
+        a2 = (a + 1.0) + (a - 1.0) * c - sa;
+        break;
+
+    case BQ_HIGH_SHELF:
+        b0 = a * ((a + 1.0) + (a - 1.0) * c + sa);
+        b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * c);
+        b2 = a * ((a + 1.0) + (a - 1.0) * c - sa);
+        a0 = (a + 1.0) - (a - 1.0) * c + sa;
+        a1 = 2.0 * ((a - 1.0) - (a + 1.0) * c);
+        a2 = (a + 1.0) - (a - 1.0) * c - sa;
+        break;
+
+    case BQ_PEAK:
+    default:
+        b0 = 1.0 + alpha * a;
+        b1 = -2.0 * c;
+        b2 = 1.0 - alpha * a;
+        a0 = 1.0 + alpha / a;
+        a1 = -2.0 * c;
+        a2 = 1.0 - alpha / a;
+        break;
+    }
+
+    double scale = (double)(1 << COEF_SHIFT) / a0;
+    return (biquad_t) {
+        .b0 = (int32_t)lround(b0 * scale),
+        .b1 = (int32_t)lround(b1 * scale),
+        .b2 = (int32_t)lround(b2 * scale),
+        .a1 = (int32_t)lround(a1 * scale),
+        .a2 = (int32_t)lround(a2 * scale),
+    };
+}
+
+static void engine_add_section(engine_t *e, const bq_spec_t *spec, uint32_t sample_rate)
+{
+    if (spec->type != BQ_NONE && e->sections < MAX_SECTIONS) {
+        e->coef[e->sections++] = biquad_design(spec, sample_rate);
+    }
+}
+
+/*
+ * Build the section list for the committed EQ word and clear all state
+ */
+static void engine_design(engine_t *e, uint32_t sample_rate)
+{
+    e->sample_rate = sample_rate;
+    e->sections = 0;
+
+    if (!(e->eq & ST_BYPASS)) {
+        const bq_spec_t *preset = s_presets[e->eq & ST_PRESET_MASK];
+        for (int i = 0; i < PRESET_SECTIONS; i++) {
+            engine_add_section(e, &preset[i], sample_rate);
+        }
+        if (e->eq & ST_LOUDNESS) {
+            engine_add_section(e, &s_loudness[0], sample_rate);
+            engine_add_section(e, &s_loudness[1], sample_rate);
+        }
+        if (e->eq & ST_BASS) {
+            engine_add_section(e, &s_bass_boost, sample_rate);
+        }
+    }
+    memset(e->hist, 0, sizeof(e->hist));
+
+    float segment_ms = SEGMENT_FRAMES * 1000.0f / (float)sample_rate;
+    e->comp_attack = 1.0f - expf(-segment_ms / COMP_ATTACK_MS);
+    e->comp_release = 1.0f - expf(-segment_ms / COMP_RELEASE_MS);
+    e->limit_release = 1.0f - expf(-segment_ms / LIMIT_RELEASE_MS);
+    e->comp_env_db = COMP_FLOOR_DB;
+    e->limit_gain = 1.0f;
+    e->gain = GAIN_UNITY;
+}
+
+/*
+ * One biquad over one channel of an interleaved block
+ */
+static void biquad_run(int32_t *x, size_t frames, const biquad_t *c, biquad_hist_t *h)
+{
+    int32_t x1 = h->x1, x2 = h->x2, y1 = h->y1, y2 = h->y2;
+
+    for (size_t i = 0; i < frames; i++) {
+        int32_t in = x[2 * i];
+        int64_t acc = (int64_t)c->b0 * in + (int64_t)c->b1 * x1 + (int64_t)c->b2 * x2 -
+                      (int64_t)c->a1 * y1 - (int64_t)c->a2 * y2;
+        int32_t out = (int32_t)((acc + (1 << (COEF_SHIFT - 1))) >> COEF_SHIFT);
+        x2 = x1;
+        x1 = in;
+        y2 = y1;
+        y1 = out;
+        x[2 * i] = out;
+    }
+
+    h->x1 = x1;
+    h->x2 = x2;
+    h->y1 = y1;
+    h->y2 = y2;
+}
+
+/*
+ * Normalizer and limiter, one gain step per segment
+ */
+static void engine_dynamics(engine_t *e, int32_t *x, size_t frames, bool normalizer)
+{
+    const float ceiling = FULL_SCALE * powf(10.0f, LIMIT_CEILING_DB / 20.0f);
+
+    for (size_t seg = 0; seg < frames; seg += SEGMENT_FRAMES) {
+        size_t n = (frames - seg < SEGMENT_FRAMES) ? frames - seg : SEGMENT_FRAMES;
+        int32_t *p = &x[seg * 2];
+
+        int32_t peak = 0;
+        for (size_t i = 0; i < n * 2; i++) {
+            int32_t v = (p[i] < 0) ? -p[i] : p[i];
+            if (v > peak) {
+                peak = v;
+            }
+        }
+
+        float g = 1.0f;
+        if (normalizer) {
+            float level_db = (peak > 0) ? 20.0f * log10f((float)peak / FULL_SCALE) : COMP_FLOOR_DB;
+            float k = (level_db > e->comp_env_db) ? e->comp_attack : e->comp_release;
+            e->comp_env_db += (level_db - e->comp_env_db) * k;
+            float over = e->comp_env_db - COMP_THRESHOLD_DB;
+            float gain_db = COMP_MAKEUP_DB - ((over > 0.0f) ? over * (1.0f - 1.0f / COMP_RATIO) : 0.0f);
+            g = powf(10.0f, gain_db / 20.0f);
+        }
+
+        /* Limiter: recover towards unity, clamp at once to what this segment needs */
+        e->limit_gain += (1.0f - e->limit_gain) * e->limit_release;
+        if (e->limit_gain > 0.9999f) {
+            e->limit_gain = 1.0f;
+        }
+        if ((float)peak * g * e->limit_gain > ceiling) {
+            e->limit_gain = ceiling / ((float)peak * g);
+        }
+
+        int32_t target = (int32_t)(g * e->limit_gain * GAIN_UNITY);
+        if (target == GAIN_UNITY && e->gain == GAIN_UNITY) {
+            continue;               /* Unity: skip the multiply */
+        }
+
+        /* Gain reductions apply from the segment's first sample (instant
+         * attack), so the peak that asked for them never passes unattenuated;
+         * only increases are ramped */
+        int32_t gain = (target < e->gain) ? target : e->gain;
+        int32_t step = (target - gain) / (int32_t)n;
+        for (size_t i = 0; i < n; i++) {
+            gain += step;
+            p[2 * i] = (int32_t)(((int64_t)p[2 * i] * gain) >> GAIN_SHIFT);
+            p[2 * i + 1] = (int32_t)(((int64_t)p[2 * i + 1] * gain) >> GAIN_SHIFT);
+        }
+        e->gain = target;
+    }
+}
+
+/*
+ * Add one block to the cost window; publish and check it once per second
+ */
+static void engine_account(engine_t *e, uint32_t cycles, size_t frames, uint32_t sample_rate,
+                           bool normalizer)
+{
+    e->cycles += cycles;
+    e->frames += frames;
+    if (e->frames < sample_rate) {
+        return;
+    }
+
+    uint32_t per_frame = (uint32_t)(e->cycles / e->frames);
+    atomic_store_explicit(&s_cycles_per_frame, per_frame, memory_order_relaxed);
+    if (per_frame > LOCAL_DSP_CYCLE_BUDGET && !e->over_budget) {
+        e->over_budget = true;
+        ESP_LOGW(TAG, "%lu cycles per frame (%d sections%s), over the %d budget",
+                 (unsigned long)per_frame, e->sections, normalizer ? ", normalizer" : "",
+                 LOCAL_DSP_CYCLE_BUDGET);
+    } else {
+        ESP_LOGD(TAG, "%lu cycles per frame (%d sections%s)", (unsigned long)per_frame,
+                 e->sections, normalizer ? ", normalizer" : "");
+    }
+    e->cycles = 0;
+    e->frames = 0;
+}
+
+/*
+ * Whether the engine should run now
+ */
+static bool want_active(void)
+{
+    switch (atomic_load_explicit(&s_mode, memory_order_relaxed)) {
+    case LOCAL_DSP_ON:
+        return true;
+
+    case LOCAL_DSP_AUTO: {
+        if (!atomic_load_explicit(&s_alive_seen, memory_order_acquire)) {
+            return true;
+        }
+        uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        return now_ms - atomic_load_explicit(&s_alive_ms, memory_order_relaxed) >=
+               LOCAL_DSP_PRESENCE_TIMEOUT_MS;
+    }
+
+    default:
+        return false;
+    }
+}
+
+/*
+ * EQ word the writer should be running
+ */
+static uint32_t wanted_eq(void)
+{
+    if (!want_active()) {
+        return 0;
+    }
+    return (atomic_load_explicit(&s_state, memory_order_relaxed) & ST_EQ_MASK) | EQ_ACTIVE;
+}
+
+/*
+ * Public API Implementation
+ */
+
+esp_err_t local_dsp_set_mode(local_dsp_mode_t mode)
+{
+    if (mode >= LOCAL_DSP_MODE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    atomic_store_explicit(&s_mode, (int)mode, memory_order_relaxed);
+    return ESP_OK;
+}
+
+local_dsp_mode_t local_dsp_get_mode(void)
+{
+    return (local_dsp_mode_t)atomic_load_explicit(&s_mode, memory_order_relaxed);
+}
+
+void local_dsp_set_state(const local_dsp_state_t *state)
+{
+    if (state == NULL) {
+        return;
+    }
+    uint32_t packed = (state->preset < PRESET_COUNT) ? state->preset : 0;
+    if (state->loudness) {
+        packed |= ST_LOUDNESS;
+    }
+    if (state->bass_boost) {
+        packed |= ST_BASS;
+    }
+    if (state->normalizer) {
+        packed |= ST_NORMALIZER;
+    }
+    if (state->bypass) {
+        packed |= ST_BYPASS;
+    }
+    atomic_store_explicit(&s_state, packed, memory_order_relaxed);
+}
+
+void local_dsp_note_dsp_alive(void)
+{
+    atomic_store_explicit(&s_alive_ms, (uint32_t)(esp_timer_get_time() / 1000),
+                          memory_order_relaxed);
+    atomic_store_explicit(&s_alive_seen, true, memory_order_release);
+}
+
+bool local_dsp_is_active(void)
+{
+    return atomic_load_explicit(&s_active, memory_order_relaxed);
+}
+
+bool local_dsp_pending(void)
+{
+    return wanted_eq() != s_eng.eq;
+}
+
+void local_dsp_commit(void)
+{
+    engine_t *e = &s_eng;
+    bool was_active = (e->eq & EQ_ACTIVE) != 0;
+
+    e->eq = wanted_eq();
+    e->sample_rate = 0;             /* Redesign and clear on the next block */
+    e->cycles = 0;
+    e->frames = 0;
+    e->over_budget = false;
+
+    bool active = (e->eq & EQ_ACTIVE) != 0;
+    if (active != was_active) {
+        atomic_store_explicit(&s_active, active, memory_order_relaxed);
+        audio_gain_set_local_stage(active);
+        if (!active) {
+            atomic_store_explicit(&s_cycles_per_frame, 0, memory_order_relaxed);
+        }
+        ESP_LOGI(TAG, "Local DSP %s%s", active ? "on" : "off",
+                 (local_dsp_get_mode() == LOCAL_DSP_AUTO) ?
+                 (active ? " (no STM32 activity)" : " (STM32 active)") : "");
+    }
+    if (active) {
+        ESP_LOGI(TAG, "Local DSP: preset %u, loudness %s, bass boost %s%s",
+                 (unsigned)(e->eq & ST_PRESET_MASK), (e->eq & ST_LOUDNESS) ? "on" : "off",
+                 (e->eq & ST_BASS) ? "on" : "off", (e->eq & ST_BYPASS) ? ", EQ bypassed" : "");
+    }
+}
+
+/*
+ * Run the EQ and dynamics over one block into e->work (writer task)
+ *
+ * @return false if the engine is off (work untouched)
+ */
+static bool engine_run(engine_t *e, const int16_t *block, size_t frames, uint32_t sample_rate,
+                       bool *normalizer)
+{
+    if (!(e->eq & EQ_ACTIVE) || frames == 0 || frames > BLOCK_FRAMES_MAX) {
+        return false;
+    }
+    if (sample_rate != e->sample_rate) {
+        engine_design(e, sample_rate);
+    }
+
+    *normalizer = (atomic_load_explicit(&s_state, memory_order_relaxed) & ST_NORMALIZER) != 0;
+    int32_t *work = e->work;
+
+    for (size_t i = 0; i < frames * 2; i++) {
+        work[i] = (int32_t)block[i] * (1 << SAMPLE_SHIFT);
+    }
+
+    for (int s = 0; s < e->sections; s++) {
+        biquad_run(&work[0], frames, &e->coef[s], &e->hist[s][0]);
+        biquad_run(&work[1], frames, &e->coef[s], &e->hist[s][1]);
+    }
+
+    engine_dynamics(e, work, frames, *normalizer);
+    return true;
+}
+
+/*
+ * Round the working block back to 16 bits
+ */
+static void engine_narrow(const int32_t *work, int16_t *block, size_t frames)
+{
+    for (size_t i = 0; i < frames * 2; i++) {
+        int32_t v = (work[i] + (1 << (SAMPLE_SHIFT - 1))) >> SAMPLE_SHIFT;
+        block[i] = (int16_t)((v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : v);
+    }
+}
+
+void local_dsp_process(int16_t *block, size_t frames, uint32_t sample_rate)
+{
+    engine_t *e = &s_eng;
+    uint32_t start = esp_cpu_get_cycle_count();
+    bool normalizer;
+
+    if (!engine_run(e, block, frames, sample_rate, &normalizer)) {
+        return;
+    }
+    engine_narrow(e->work, block, frames);
+
+    engine_account(e, esp_cpu_get_cycle_count() - start, frames, sample_rate, normalizer);
+}
+
+bool local_dsp_process_wide(int16_t *block, int32_t *out, size_t frames, uint32_t sample_rate)
+{
+    engine_t *e = &s_eng;
+    uint32_t start = esp_cpu_get_cycle_count();
+    bool normalizer;
+
+    if (!engine_run(e, block, frames, sample_rate, &normalizer)) {
+        return false;
+    }
+
+    /* The limiter holds the working block below full scale; saturate anyway */
+    const int32_t work_max = INT32_MAX >> (32 - 16 - SAMPLE_SHIFT);
+    for (size_t i = 0; i < frames * 2; i++) {
+        int32_t v = e->work[i];
+        v = (v > work_max) ? work_max : (v < -work_max - 1) ? -work_max - 1 : v;
+        out[i] = (int32_t)((uint32_t)v << (32 - 16 - SAMPLE_SHIFT));
+    }
+    engine_narrow(e->work, block, frames);
+
+    engine_account(e, esp_cpu_get_cycle_count() - start, frames, sample_rate, normalizer);
+    return true;
+}
+
+uint32_t local_dsp_get_cycles_per_frame(void)
+{
+    return atomic_load_explicit(&s_cycles_per_frame, memory_order_relaxed);
+}
@@ -0,0 +1,163 @@
+/*
+ * Local Fallback DSP Engine
+ * Preset EQ, loudness, bass boost and a limiter on the bridge's own output
+ *
+ * For units without the STM32 (dev kits, PCM5102A-only SKUs) or with one
+ * that has stopped answering: the presets, loudness, bass boost and
+ * normalizer commands would otherwise do nothing. The engine follows the
+ * same control state the BLE handler forwards to the STM32, so switching
+ * between the two is invisible to the app.
+ *
+ * Signal chain (fixed point, 24-bit samples in 32-bit words):
+ * - preset EQ: a high-pass plus up to two shelving / peaking sections
+ * - loudness contour: +6 dB low shelf at 100 Hz, +3 dB high shelf at 10 kHz
+ * - bass boost: +8 dB peak at 100 Hz
+ * - normalizer (when enabled): 4:1 compressor above -20 dBFS, +6 dB makeup
+ * - limiter: -1 dBFS ceiling, always on while the engine runs
+ * Bypass skips the EQ sections and keeps the dynamics, as on the STM32.
+ *
+ * Modes:
+ * - OFF: the STM32 does all processing (default).
+ * - ON: the engine always runs.
+ * - AUTO: the engine runs while nothing has been received from the STM32
+ *   for LOCAL_DSP_PRESENCE_TIMEOUT_MS. Any line the DSP engine prints
+ *   counts, so its firmware must print at least one line (a heartbeat or
+ *   a log line) within that time.
+ *
+ * EQ changes reshape the signal, so, as for routing, the writer fades out
+ * before committing them (local_dsp_pending() / local_dsp_commit()). The
+ * dynamics pick up normalizer changes on the next block.
+ *
+ * Threading: local_dsp_pending(), local_dsp_commit() and
+ * local_dsp_process() belong to the I2S writer task. Everything else is
+ * lock-free and safe from any task.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef LOCAL_DSP_H
+#define LOCAL_DSP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* AUTO: STM32 considered gone after this long without a received line */
+#define LOCAL_DSP_PRESENCE_TIMEOUT_MS   5000
+
+/* CPU budget per output frame; exceeding it is logged (~20% of a 240 MHz
+ * core at 48 kHz) */
+#define LOCAL_DSP_CYCLE_BUDGET          1000
+
+/*
+ * Engine modes (BLE command 0x0F)
+ */
+typedef enum {
+    LOCAL_DSP_OFF = 0,
+    LOCAL_DSP_ON,
+    LOCAL_DSP_AUTO,
+    LOCAL_DSP_MODE_COUNT,
+} local_dsp_mode_t;
+
+/*
+ * Control state the engine follows (mirrors what is sent to the STM32)
+ */
+typedef struct {
+    uint8_t preset;                 /* 0-3: OFFICE / FULL / NIGHT / SPEECH */
+    bool loudness;
+    bool bass_boost;
+    bool normalizer;
+    bool bypass;
+} local_dsp_state_t;
+
+/*
+ * Select the engine mode
+ *
+ * @param mode Engine mode
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for an unknown mode
+ */
+esp_err_t local_dsp_set_mode(local_dsp_mode_t mode);
+
+/*
+ * Get the selected engine mode
+ *
+ * @return Engine mode
+ */
+local_dsp_mode_t local_dsp_get_mode(void);
+
+/*
+ * Update the control state (BLE / UART control handler)
+ *
+ * @param state New control state; unknown presets fall back to OFFICE
+ */
+void local_dsp_set_state(const local_dsp_state_t *state);
+
+/*
+ * Note a line received from the STM32 (UART RX task)
+ */
+void local_dsp_note_dsp_alive(void);
+
+/*
+ * Whether the engine is processing the output
+ *
+ * @return true while committed active by the writer
+ */
+bool local_dsp_is_active(void);
+
+/*
+ * Whether an EQ change or an engine start/stop waits for a commit (writer task)
+ *
+ * @return true if the writer should fade out and call local_dsp_commit()
+ */
+bool local_dsp_pending(void);
+
+/*
+ * Take the pending EQ settings (writer task)
+ * Clears the filter state, so call it while the output is silent.
+ */
+void local_dsp_commit(void);
+
+/*
+ * Process one output block in place (writer task)
+ * A change of sample rate redesigns the filters (the output is silent
+ * across a rate switch).
+ *
+ * @param block Interleaved 16-bit stereo block
+ * @param frames Block length in frames
+ * @param sample_rate Output sample rate in Hz
+ */
+void local_dsp_process(int16_t *block, size_t frames, uint32_t sample_rate);
+
+/*
+ * Process one output block into 32-bit samples (writer task)
+ * For I2S_32BIT_OUTPUT: the engine's 24-bit result goes to out
+ * left-justified instead of being rounded to 16 bits and widened again, so
+ * EQ cuts and dynamics keep their resolution through the gain stage.
+ * block still receives the 16-bit rounding, for taps such as the spectrum.
+ *
+ * @param block Interleaved 16-bit stereo block
+ * @param out Interleaved 32-bit stereo block (left-justified)
+ * @param frames Block length in frames
+ * @param sample_rate Output sample rate in Hz
+ * @return true if the engine ran and out holds the block, false if it is
+ *         off (out untouched)
+ */
+bool local_dsp_process_wide(int16_t *block, int32_t *out, size_t frames, uint32_t sample_rate);
+
+/*
+ * Get the measured cost of the current configuration
+ *
+ * @return CPU cycles per output frame over the last second, 0 if inactive
+ */
+uint32_t local_dsp_get_cycles_per_frame(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOCAL_DSP_H */
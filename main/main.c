@@ -2,7 +2,8 @@
  * ESP32 A2DP Sink + BLE GATT Controller for External DSP
  * V4 Architecture: A2DP audio → I2S → STM32 DSP, BLE GATT control + UART forwarding
  *
- * Core 0: BT controller + Bluedroid + A2DP + BLE GATT + I2S write + UART + OTA + NVS
+ * Core 0: BT controller + Bluedroid + A2DP + BLE GATT + UART + OTA + NVS
+ * Core 1: I2S writer (see audio_pipeline.c)
  *
  * Audio path: Phone (SBC) → ESP32 A2DP sink → I2S → STM32 → PCM5102A
  * Control path: BLE GATT → UART → STM32
@@ -16,11 +17,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/ringbuf.h"
 
 #include "esp_log.h"
 #include "esp_system.h"
@@ -35,16 +34,13 @@
 #include "esp_a2dp_api.h"
 #include "esp_avrc_api.h"
 
-#include "driver/i2s_std.h"
-#include "driver/gpio.h"
-
 /* Project modules */
 #include "ble_gatt_dsp.h"
 #include "nvs_settings.h"
 #include "ota_manager.h"
-
-/* Uncomment to enable I2S sine test mode (bypasses all Bluetooth) */
-// #define I2S_SINE_TEST
+#include "audio_pipeline.h"
+#include "audio_route.h"
+#include "local_dsp.h"
 
 static const char *TAG = "BT_SPEAKER";
 
@@ -55,44 +51,20 @@ static const char *TAG = "BT_SPEAKER";
 /* Dynamic device name with MAC suffix (e.g., "42 Decibels-A7B3") */
 static char s_device_name[BT_DEVICE_NAME_MAX_LEN] = BT_DEVICE_NAME_BASE;
 
-/* I2S GPIO Configuration (shared clocks to STM32 + PCM5102A) */
-#define I2S_BCK_PIN     GPIO_NUM_26
-#define I2S_WS_PIN      GPIO_NUM_25
-#define I2S_DATA_PIN    GPIO_NUM_22
-
-/* I2S configuration */
-#define I2S_SAMPLE_RATE     44100
-#define I2S_BITS_PER_SAMPLE I2S_DATA_BIT_WIDTH_16BIT
-
-/* Ring buffer for A2DP → I2S decoupling */
-#define RINGBUF_SIZE        (32 * 1024)
-
-/* Pre-buffer: accumulate this much audio before starting I2S output.
- * 44100 Hz * 2ch * 2 bytes * 0.050s = 8820 bytes ≈ 50ms */
-#define PREBUF_BYTES        8820
-
 /* Watchdog timeout in seconds */
 #define WDT_TIMEOUT_SEC     30
 
-/* I2S channel handle */
-static i2s_chan_handle_t i2s_tx_handle = NULL;
-
-/* Ring buffer handle */
-static RingbufHandle_t s_ringbuf = NULL;
-
 /* Connection state tracking */
 static bool s_a2dp_connected = false;
 static bool s_audio_started = false;
 static esp_bd_addr_t s_peer_bda = {0};
 
-/* Current sample rate */
-static uint32_t s_current_sample_rate = I2S_SAMPLE_RATE;
-
 /* Forward declarations */
 static void bt_app_gap_cb(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_param_t *param);
 static void bt_app_a2d_cb(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param);
 static void bt_app_a2d_data_cb(const uint8_t *data, uint32_t len);
 static void bt_app_avrc_ct_cb(esp_avrc_ct_cb_event_t event, esp_avrc_ct_cb_param_t *param);
+static void report_sink_delay(uint32_t latency_us);
 
 /*
  * Build device name with MAC address suffix for unique identification
@@ -118,97 +90,6 @@ const char *bt_get_device_name(void)
     return s_device_name;
 }
 
-/*
- * Initialize I2S for audio output
- * ESP32 is I2S master — BCK/LRCK shared to STM32 and PCM5102A
- */
-static esp_err_t i2s_init(void)
-{
-    ESP_LOGI(TAG, "Initializing I2S...");
-
-    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
-    chan_cfg.dma_desc_num = 8;       /* 8 DMA descriptors (default: 6) */
-    chan_cfg.dma_frame_num = 480;    /* 480 frames per descriptor (default: 240) */
-    chan_cfg.auto_clear = true;      /* Output silence on underrun */
-
-    esp_err_t ret = i2s_new_channel(&chan_cfg, &i2s_tx_handle, NULL);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create I2S channel: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    i2s_std_config_t std_cfg = {
-        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(I2S_SAMPLE_RATE),
-        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_BITS_PER_SAMPLE, I2S_SLOT_MODE_STEREO),
-        .gpio_cfg = {
-            .mclk = I2S_GPIO_UNUSED,
-            .bclk = I2S_BCK_PIN,
-            .ws = I2S_WS_PIN,
-            .dout = I2S_DATA_PIN,
-            .din = I2S_GPIO_UNUSED,
-            .invert_flags = {
-                .mclk_inv = false,
-                .bclk_inv = false,
-                .ws_inv = false,
-            },
-        },
-    };
-
-    ret = i2s_channel_init_std_mode(i2s_tx_handle, &std_cfg);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to init I2S std mode: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    ret = i2s_channel_enable(i2s_tx_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to enable I2S channel: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    ESP_LOGI(TAG, "I2S initialized: BCK=GPIO%d, WS=GPIO%d, DOUT=GPIO%d @ %dHz",
-             I2S_BCK_PIN, I2S_WS_PIN, I2S_DATA_PIN, I2S_SAMPLE_RATE);
-    return ESP_OK;
-}
-
-/*
- * Reconfigure I2S sample rate based on A2DP stream parameters
- */
-static esp_err_t i2s_reconfigure(uint32_t sample_rate)
-{
-    if (i2s_tx_handle == NULL) {
-        return ESP_ERR_INVALID_STATE;
-    }
-
-    if (sample_rate == s_current_sample_rate) {
-        return ESP_OK;
-    }
-
-    ESP_LOGI(TAG, "Reconfiguring I2S to %lu Hz", (unsigned long)sample_rate);
-
-    esp_err_t ret = i2s_channel_disable(i2s_tx_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to disable I2S: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    i2s_std_clk_config_t clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(sample_rate);
-    ret = i2s_channel_reconfig_std_clock(i2s_tx_handle, &clk_cfg);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to reconfigure I2S clock: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    ret = i2s_channel_enable(i2s_tx_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to enable I2S: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    s_current_sample_rate = sample_rate;
-    return ESP_OK;
-}
-
 /*
  * GAP callback for handling Bluetooth connection events and pairing
  */
@@ -269,10 +150,13 @@ static void bt_app_a2d_cb(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param)
             memcpy(s_peer_bda, param->conn_stat.remote_bda, sizeof(esp_bd_addr_t));
             /* Set low poll interval to prevent sniff mode during audio */
             esp_bt_gap_set_qos(s_peer_bda, 40);
+            /* Let the source delay video by our output latency from the start */
+            report_sink_delay(audio_pipeline_get_latency_us());
         } else if (param->conn_stat.state == ESP_A2D_CONNECTION_STATE_DISCONNECTED) {
             ESP_LOGI(TAG, "A2DP disconnected");
             s_a2dp_connected = false;
             s_audio_started = false;
+            audio_pipeline_stream_event(AUDIO_STREAM_DISCONNECTED);
         }
         break;
 
@@ -280,9 +164,11 @@ static void bt_app_a2d_cb(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param)
         if (param->audio_stat.state == ESP_A2D_AUDIO_STATE_STARTED) {
             ESP_LOGI(TAG, "Audio stream started");
             s_audio_started = true;
+            audio_pipeline_stream_event(AUDIO_STREAM_STARTED);
         } else if (param->audio_stat.state == ESP_A2D_AUDIO_STATE_SUSPEND) {
             ESP_LOGI(TAG, "Audio stream suspended");
             s_audio_started = false;
+            audio_pipeline_stream_event(AUDIO_STREAM_SUSPENDED);
         }
         break;
 
@@ -309,7 +195,18 @@ static void bt_app_a2d_cb(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param)
             }
 
             ESP_LOGI(TAG, "SBC codec, sample rate: %lu Hz", (unsigned long)sample_rate);
-            i2s_reconfigure(sample_rate);
+            audio_pipeline_set_sample_rate(sample_rate);
+        }
+        break;
+
+    case ESP_A2D_SNK_SET_DELAY_VALUE_EVT:
+        if (param->a2d_set_delay_value_stat.set_state == ESP_A2D_SET_SUCCESS) {
+            ESP_LOGI(TAG, "Sink delay reported: %u.%u ms",
+                     param->a2d_set_delay_value_stat.delay_value / 10,
+                     param->a2d_set_delay_value_stat.delay_value % 10);
+        } else {
+            ESP_LOGW(TAG, "Sink delay rejected: %u",
+                     param->a2d_set_delay_value_stat.delay_value);
         }
         break;
 
@@ -332,51 +229,31 @@ static void bt_app_a2d_cb(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param)
  */
 static void bt_app_a2d_data_cb(const uint8_t *data, uint32_t len)
 {
-    if (s_ringbuf == NULL || data == NULL || len == 0) {
-        return;
-    }
-
-    if (xRingbufferSend(s_ringbuf, data, len, 0) != pdTRUE) {
-        ESP_LOGW(TAG, "Ring buffer full, dropping %lu bytes", (unsigned long)len);
-    }
+    audio_pipeline_push(data, len);
 }
 
 /*
- * I2S writer task — pinned to Core 1
- * Pre-buffers audio data, then writes continuously to keep DMA always fed.
- * This eliminates DMA underruns that cause crackling.
+ * Report end-to-end output latency to the A2DP source (AVDTP delay report)
+ * Called by the audio pipeline whenever the latency changes.
  */
-static void i2s_writer_task(void *arg)
+static void report_sink_delay(uint32_t latency_us)
 {
-    ESP_LOGI(TAG, "I2S writer task started on Core %d", xPortGetCoreID());
-    ESP_LOGI(TAG, "Waiting for pre-buffer (%d bytes / ~%d ms)...",
-             PREBUF_BYTES, PREBUF_BYTES * 1000 / (I2S_SAMPLE_RATE * 4));
+    if (!s_a2dp_connected || latency_us == 0) {
+        return;
+    }
 
-    /* Wait until ring buffer has enough data to prevent initial underrun */
-    while (1) {
-        UBaseType_t items_waiting = 0;
-        vRingbufferGetInfo(s_ringbuf, NULL, NULL, NULL, NULL, &items_waiting);
-        if (items_waiting >= PREBUF_BYTES) {
-            ESP_LOGI(TAG, "Pre-buffer filled (%lu bytes), starting I2S output",
-                     (unsigned long)items_waiting);
-            break;
-        }
-        vTaskDelay(pdMS_TO_TICKS(5));
+    /* Delay reports are in 1/10 ms */
+    uint32_t delay = (latency_us + 50) / 100;
+    if (delay > UINT16_MAX) {
+        delay = UINT16_MAX;
     }
 
-    /* Continuously drain ring buffer to I2S — keeps DMA always fed */
-    size_t item_size = 0;
-    size_t bytes_written = 0;
-    while (1) {
-        void *data = xRingbufferReceive(s_ringbuf, &item_size, portMAX_DELAY);
-        if (data != NULL && item_size > 0) {
-            i2s_channel_write(i2s_tx_handle, data, item_size, &bytes_written, portMAX_DELAY);
-            vRingbufferReturnItem(s_ringbuf, data);
-        }
+    esp_err_t ret = esp_a2d_sink_set_delay_value((uint16_t)delay);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to set sink delay: %s", esp_err_to_name(ret));
     }
 }
 
-
 /*
  * AVRCP Controller callback for media control events
  */
@@ -560,58 +437,11 @@ static void watchdog_task(void *arg)
     }
 }
 
-#ifdef I2S_SINE_TEST
-/*
- * I2S sine wave test — generates 1kHz tone directly to I2S
- * Bypasses Bluetooth entirely to isolate the I2S data path
- */
-static void sine_test_task(void *arg)
-{
-    const int freq = 1000;
-    const int samples_per_period = I2S_SAMPLE_RATE / freq;
-    const int16_t amplitude = 16000;  /* ~50% of int16_t max */
-
-    /* Pre-compute one period of stereo sine wave */
-    int16_t sine_buf[samples_per_period * 2];
-    for (int i = 0; i < samples_per_period; i++) {
-        int16_t sample = (int16_t)(amplitude * sinf(2.0f * M_PI * i / samples_per_period));
-        sine_buf[i * 2]     = sample;  /* Left */
-        sine_buf[i * 2 + 1] = sample;  /* Right */
-    }
-
-    ESP_LOGI(TAG, "Sine test running: %d Hz, %d samples/period, amplitude=%d",
-             freq, samples_per_period, amplitude);
-
-    size_t bytes_written;
-    while (1) {
-        i2s_channel_write(i2s_tx_handle, sine_buf, sizeof(sine_buf),
-                          &bytes_written, portMAX_DELAY);
-    }
-}
-#endif
-
 /*
  * Application entry point
  */
 void app_main(void)
 {
-#ifdef I2S_SINE_TEST
-    {
-        ESP_LOGW(TAG, "=== I2S SINE TEST MODE ===");
-        ESP_LOGW(TAG, "Bluetooth disabled — testing I2S data path only");
-
-        esp_err_t err = i2s_init();
-        if (err != ESP_OK) {
-            ESP_LOGE(TAG, "I2S init failed, restarting...");
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            esp_restart();
-        }
-
-        xTaskCreatePinnedToCore(sine_test_task, "sine_test", 4096, NULL, 10, NULL, 1);
-        return;
-    }
-#endif
-
     ESP_LOGI(TAG, "=== ESP32 A2DP Sink + BLE GATT Controller (V4) ===");
     ESP_LOGI(TAG, "A2DP audio → I2S → STM32 DSP, BLE GATT control + UART");
     ESP_LOGI(TAG, "Firmware version: %s", ota_mgr_get_version());
@@ -645,22 +475,45 @@ void app_main(void)
     };
     ESP_ERROR_CHECK(esp_task_wdt_reconfigure(&wdt_config));
 
-    /* Create ring buffer for A2DP → I2S decoupling */
-    s_ringbuf = xRingbufferCreate(RINGBUF_SIZE, RINGBUF_TYPE_BYTEBUF);
-    if (s_ringbuf == NULL) {
-        ESP_LOGE(TAG, "Failed to create ring buffer, restarting...");
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        esp_restart();
+    /* Restore the audio profile before the I2S DMA layout is fixed */
+    nvs_dsp_settings_t stored;
+    nvs_settings_get(&stored);
+    ret = audio_pipeline_set_profile((audio_profile_t)stored.audio_profile);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Stored audio profile %d not usable (%s), using default",
+                 stored.audio_profile, esp_err_to_name(ret));
+    }
+    audio_pipeline_set_standby_timeout(stored.standby_s);
+
+    audio_route_config_t route = {
+        .flags = stored.route_flags,
+        .trim_l = stored.trim_l,
+        .trim_r = stored.trim_r,
+        .delay_l = stored.delay_l,
+        .delay_r = stored.delay_r,
+    };
+    if (audio_route_set(&route) != ESP_OK) {
+        ESP_LOGW(TAG, "Invalid stored channel routing, using passthrough");
+    }
+    if (local_dsp_set_mode((local_dsp_mode_t)stored.local_dsp) != ESP_OK) {
+        ESP_LOGW(TAG, "Invalid stored local DSP mode %d, using off", stored.local_dsp);
     }
+    if (audio_pipeline_set_overflow_policy((audio_overflow_policy_t)stored.overflow) != ESP_OK) {
+        ESP_LOGW(TAG, "Invalid stored overflow policy %d, using default", stored.overflow);
+    }
+    audio_pipeline_set_dsp_latency_us((uint32_t)stored.dsp_latency * 100);
 
-    /* Initialize I2S for audio output */
-    ret = i2s_init();
+    /* Initialize audio pipeline (A2DP → I2S ring + I2S output) */
+    ret = audio_pipeline_init();
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "I2S initialization failed, restarting...");
+        ESP_LOGE(TAG, "Audio pipeline initialization failed, restarting...");
         vTaskDelay(pdMS_TO_TICKS(1000));
         esp_restart();
     }
 
+    /* Report output latency to the A2DP source as it changes */
+    audio_pipeline_set_latency_callback(report_sink_delay);
+
     /* Initialize Bluetooth (Classic A2DP + BLE GATT) */
     ret = bluetooth_init();
     if (ret != ESP_OK) {
@@ -681,7 +534,12 @@ void app_main(void)
     }
 
     /* Create I2S writer task pinned to Core 1 (with pre-buffering) */
-    xTaskCreatePinnedToCore(i2s_writer_task, "i2s_writer", 4096, NULL, 10, NULL, 1);
+    ret = audio_pipeline_start();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start I2S writer, restarting...");
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        esp_restart();
+    }
 
     /* Create watchdog monitoring task */
     xTaskCreate(watchdog_task, "watchdog", 2048, NULL, 5, NULL);
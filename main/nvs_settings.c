@@ -23,6 +23,16 @@ static const char *TAG = "NVS_SETTINGS";
 #define NVS_KEY_BASS        "bass"
 #define NVS_KEY_TREBLE      "treble"
 #define NVS_KEY_VERSION     "version"
+#define NVS_KEY_PROFILE     "audio_prof"
+#define NVS_KEY_STANDBY     "standby_s"
+#define NVS_KEY_ROUTE       "route"
+#define NVS_KEY_TRIM_L      "trim_l"
+#define NVS_KEY_TRIM_R      "trim_r"
+#define NVS_KEY_DELAY_L     "delay_l"
+#define NVS_KEY_DELAY_R     "delay_r"
+#define NVS_KEY_LOCAL_DSP   "local_dsp"
+#define NVS_KEY_OVERFLOW    "overflow"
+#define NVS_KEY_DSP_LATENCY "dsp_lat"
 
 /* Module state */
 typedef struct {
@@ -52,6 +62,16 @@ static void set_defaults(nvs_dsp_settings_t *settings)
     settings->bass_level = 0;
     settings->treble_level = 0;
     settings->config_version = NVS_CONFIG_VERSION;
+    settings->audio_profile = 0;
+    settings->standby_s = NVS_STANDBY_DEFAULT_S;
+    settings->route_flags = 0;
+    settings->trim_l = 0;
+    settings->trim_r = 0;
+    settings->delay_l = 0;
+    settings->delay_r = 0;
+    settings->local_dsp = 0;
+    settings->overflow = 0;
+    settings->dsp_latency = NVS_DSP_LATENCY_DEFAULT;
 }
 
 /*
@@ -100,6 +120,54 @@ static esp_err_t do_save(void)
         return ret;
     }
 
+    ret = nvs_set_u8(s_nvs.nvs_handle, NVS_KEY_PROFILE, s_nvs.settings.audio_profile);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save audio profile: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = nvs_set_u8(s_nvs.nvs_handle, NVS_KEY_STANDBY, s_nvs.settings.standby_s);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save standby timeout: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = nvs_set_u8(s_nvs.nvs_handle, NVS_KEY_ROUTE, s_nvs.settings.route_flags);
+    if (ret == ESP_OK) {
+        ret = nvs_set_u8(s_nvs.nvs_handle, NVS_KEY_TRIM_L, s_nvs.settings.trim_l);
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_set_u8(s_nvs.nvs_handle, NVS_KEY_TRIM_R, s_nvs.settings.trim_r);
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_set_u16(s_nvs.nvs_handle, NVS_KEY_DELAY_L, s_nvs.settings.delay_l);
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_set_u16(s_nvs.nvs_handle, NVS_KEY_DELAY_R, s_nvs.settings.delay_r);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save channel routing: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = nvs_set_u8(s_nvs.nvs_handle, NVS_KEY_LOCAL_DSP, s_nvs.settings.local_dsp);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save local DSP mode: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = nvs_set_u8(s_nvs.nvs_handle, NVS_KEY_OVERFLOW, s_nvs.settings.overflow);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save overflow policy: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = nvs_set_u16(s_nvs.nvs_handle, NVS_KEY_DSP_LATENCY, s_nvs.settings.dsp_latency);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save DSP latency: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
     ret = nvs_set_u8(s_nvs.nvs_handle, NVS_KEY_VERSION, s_nvs.settings.config_version);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to save version: %s", esp_err_to_name(ret));
@@ -217,6 +285,48 @@ esp_err_t nvs_settings_load(nvs_dsp_settings_t *settings)
         settings->treble_level = 0;
     }
 
+    /* Load audio profile (absent in settings saved by older firmware) */
+    ret = nvs_get_u8(s_nvs.nvs_handle, NVS_KEY_PROFILE, &value);
+    if (ret == ESP_OK) {
+        settings->audio_profile = value;
+    } else {
+        settings->audio_profile = 0;
+    }
+
+    /* Load standby timeout (absent in settings saved by older firmware) */
+    ret = nvs_get_u8(s_nvs.nvs_handle, NVS_KEY_STANDBY, &value);
+    if (ret == ESP_OK) {
+        settings->standby_s = value;
+    } else {
+        settings->standby_s = NVS_STANDBY_DEFAULT_S;
+    }
+
+    /* Load channel routing (absent in settings saved by older firmware;
+     * a missing key leaves that field at passthrough) */
+    uint16_t value16;
+    settings->route_flags = (nvs_get_u8(s_nvs.nvs_handle, NVS_KEY_ROUTE, &value) == ESP_OK) ?
+                            value : 0;
+    settings->trim_l = (nvs_get_u8(s_nvs.nvs_handle, NVS_KEY_TRIM_L, &value) == ESP_OK) ?
+                       value : 0;
+    settings->trim_r = (nvs_get_u8(s_nvs.nvs_handle, NVS_KEY_TRIM_R, &value) == ESP_OK) ?
+                       value : 0;
+    settings->delay_l = (nvs_get_u16(s_nvs.nvs_handle, NVS_KEY_DELAY_L, &value16) == ESP_OK) ?
+                        value16 : 0;
+    settings->delay_r = (nvs_get_u16(s_nvs.nvs_handle, NVS_KEY_DELAY_R, &value16) == ESP_OK) ?
+                        value16 : 0;
+
+    /* Load local DSP mode (absent in settings saved by older firmware) */
+    settings->local_dsp = (nvs_get_u8(s_nvs.nvs_handle, NVS_KEY_LOCAL_DSP, &value) == ESP_OK) ?
+                          value : 0;
+
+    /* Load overflow policy (absent in settings saved by older firmware) */
+    settings->overflow = (nvs_get_u8(s_nvs.nvs_handle, NVS_KEY_OVERFLOW, &value) == ESP_OK) ?
+                         value : 0;
+
+    /* Load DSP latency (absent in settings saved by older firmware) */
+    settings->dsp_latency = (nvs_get_u16(s_nvs.nvs_handle, NVS_KEY_DSP_LATENCY, &value16) ==
+                             ESP_OK) ? value16 : NVS_DSP_LATENCY_DEFAULT;
+
     /* Load version */
     ret = nvs_get_u8(s_nvs.nvs_handle, NVS_KEY_VERSION, &value);
     if (ret == ESP_OK) {
@@ -287,6 +397,59 @@ void nvs_settings_update(uint8_t preset, uint8_t loudness)
     nvs_settings_request_save();
 }
 
+void nvs_settings_set_audio_profile(uint8_t profile)
+{
+    s_nvs.settings.audio_profile = profile;
+
+    /* Request debounced save */
+    nvs_settings_request_save();
+}
+
+void nvs_settings_set_standby_timeout(uint8_t seconds)
+{
+    s_nvs.settings.standby_s = seconds;
+
+    /* Request debounced save */
+    nvs_settings_request_save();
+}
+
+void nvs_settings_set_route(uint8_t flags, uint8_t trim_l, uint8_t trim_r,
+                            uint16_t delay_l, uint16_t delay_r)
+{
+    s_nvs.settings.route_flags = flags;
+    s_nvs.settings.trim_l = trim_l;
+    s_nvs.settings.trim_r = trim_r;
+    s_nvs.settings.delay_l = delay_l;
+    s_nvs.settings.delay_r = delay_r;
+
+    /* Request debounced save */
+    nvs_settings_request_save();
+}
+
+void nvs_settings_set_local_dsp(uint8_t mode)
+{
+    s_nvs.settings.local_dsp = mode;
+
+    /* Request debounced save */
+    nvs_settings_request_save();
+}
+
+void nvs_settings_set_overflow_policy(uint8_t policy)
+{
+    s_nvs.settings.overflow = policy;
+
+    /* Request debounced save */
+    nvs_settings_request_save();
+}
+
+void nvs_settings_set_dsp_latency(uint16_t tenths_ms)
+{
+    s_nvs.settings.dsp_latency = tenths_ms;
+
+    /* Request debounced save */
+    nvs_settings_request_save();
+}
+
 bool nvs_settings_save_pending(void)
 {
     return s_nvs.save_pending;
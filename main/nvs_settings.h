@@ -29,11 +29,27 @@ typedef struct {
     uint8_t bass_level;     /* Optional: bass boost (0-3) */
     uint8_t treble_level;   /* Optional: treble level (0-2) */
     uint8_t config_version; /* Configuration version for migrations */
+    uint8_t audio_profile;  /* Audio profile (0 = robust, 1 = low-latency, 2 = deep) */
+    uint8_t standby_s;      /* Silence before output standby (s, 0 = never) */
+    uint8_t route_flags;    /* Channel routing flags (swap / mono) */
+    uint8_t trim_l;         /* Left trim, 0.5 dB steps of attenuation */
+    uint8_t trim_r;         /* Right trim */
+    uint16_t delay_l;       /* Left delay in frames */
+    uint16_t delay_r;       /* Right delay in frames */
+    uint8_t local_dsp;      /* Local DSP engine mode (0 = off, 1 = on, 2 = auto) */
+    uint8_t overflow;       /* Ring overflow policy (audio_overflow_policy_t) */
+    uint16_t dsp_latency;   /* STM32 DSP latency after I2S, 0.1 ms units */
 } nvs_dsp_settings_t;
 
 /* Current config version */
 #define NVS_CONFIG_VERSION  1
 
+/* Standby timeout until one is stored */
+#define NVS_STANDBY_DEFAULT_S   30
+
+/* DSP latency until one is stored (0.1 ms, DSP_DOWNSTREAM_LATENCY_US) */
+#define NVS_DSP_LATENCY_DEFAULT 30
+
 /* Debounce time in milliseconds (Section 12.2) */
 #define NVS_DEBOUNCE_MS     1500
 
@@ -83,6 +99,53 @@ void nvs_settings_get(nvs_dsp_settings_t *settings);
  */
 void nvs_settings_update(uint8_t preset, uint8_t loudness);
 
+/*
+ * Update audio profile in memory and request save
+ *
+ * @param profile New audio profile
+ */
+void nvs_settings_set_audio_profile(uint8_t profile);
+
+/*
+ * Update standby timeout in memory and request save
+ *
+ * @param seconds Silence before output standby, 0 = never
+ */
+void nvs_settings_set_standby_timeout(uint8_t seconds);
+
+/*
+ * Update channel routing in memory and request save
+ *
+ * @param flags Routing flags (swap / mono)
+ * @param trim_l Left trim, 0.5 dB steps of attenuation
+ * @param trim_r Right trim
+ * @param delay_l Left delay in frames
+ * @param delay_r Right delay in frames
+ */
+void nvs_settings_set_route(uint8_t flags, uint8_t trim_l, uint8_t trim_r,
+                            uint16_t delay_l, uint16_t delay_r);
+
+/*
+ * Update local DSP engine mode in memory and request save
+ *
+ * @param mode Engine mode (0 = off, 1 = on, 2 = auto)
+ */
+void nvs_settings_set_local_dsp(uint8_t mode);
+
+/*
+ * Update ring overflow policy in memory and request save
+ *
+ * @param policy Overflow policy (0 = drop newest, 1 = drop oldest, 2 = compress)
+ */
+void nvs_settings_set_overflow_policy(uint8_t policy);
+
+/*
+ * Update STM32 DSP latency in memory and request save
+ *
+ * @param tenths_ms Latency after I2S in 0.1 ms units
+ */
+void nvs_settings_set_dsp_latency(uint16_t tenths_ms);
+
 /*
  * Check if a save is pending (debounce active)
  *
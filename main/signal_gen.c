@@ -0,0 +1,299 @@
+/*
+ * Test Signal Generator Implementation
+ *
+ * Sines come from a 1024-point Q15 table with linear interpolation, driven
+ * by 32-bit phase accumulators, so any frequency up to Nyquist is exact to
+ * a fraction of a hertz. The log sweep multiplies its phase increment by a
+ * constant every SWEEP_STEP samples. Noise is xorshift32; pink noise is
+ * Voss-McCartney (16 octave rows, one row updated per sample), which is
+ * integer-only and close to -3 dB/octave over the audio band.
+ *
+ * The selection is packed into one 32-bit atomic, so a command is always
+ * seen whole by the writer.
+ *
+ * Date: 2026-10-16
+ */
+
+#include "signal_gen.h"
+#include <math.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+
+static const char *TAG = "SIGNAL_GEN";
+
+#define GAIN_ONE            (1 << 15)
+
+/* Sine table: SINE_SIZE points over one period, plus a guard point */
+#define SINE_BITS           10
+#define SINE_SIZE           (1 << SINE_BITS)
+#define SINE_FRAC_BITS      (32 - SINE_BITS)
+
+/* Sweep increment is stepped once per this many samples (power of two):
+ * a per-sample factor would be too close to 1 for float precision */
+#define SWEEP_STEP          64
+
+/* Voss-McCartney rows (octaves of pink noise) */
+#define PINK_ROWS           16
+
+/* Packed selection: type | attenuation | parameter */
+#define CFG_PACK(t, a, p)   (((uint32_t)(t) << 24) | ((uint32_t)(a) << 16) | (uint32_t)(p))
+#define CFG_TYPE(c)         ((signal_gen_type_t)((c) >> 24))
+#define CFG_ATTEN(c)        ((uint8_t)((c) >> 16))
+#define CFG_PARAM(c)        ((uint16_t)(c))
+
+/* Multitone frequencies: primes, so no tone's harmonics land on another */
+static const uint16_t s_tone_hz[SIGNAL_GEN_TONES] = {
+    61, 149, 331, 757, 1499, 3371, 7523, 14983,
+};
+
+/* Generator state — owned by the writer task */
+typedef struct {
+    uint32_t config;                /* Selection being played */
+    signal_gen_type_t type;
+    uint32_t sample_rate;           /* Rate the increments were derived for */
+    int32_t level;                  /* Q15 peak level */
+    int32_t gain;                   /* Q15 fade gain */
+    int32_t gain_step;
+    bool fading_out;
+    uint32_t phase[SIGNAL_GEN_TONES];
+    uint32_t inc[SIGNAL_GEN_TONES];
+    float sweep_inc;                /* Sweep: current increment, its bounds and factor */
+    float sweep_lo;
+    float sweep_hi;
+    float sweep_k;
+    uint32_t noise;                 /* xorshift32 state */
+    uint32_t count;                 /* Sweep step / pink row selector / ramp counter */
+    int32_t pink_rows[PINK_ROWS];
+    int32_t pink_sum;
+} gen_state_t;
+
+static gen_state_t s_gen;
+static int16_t s_sine[SINE_SIZE + 1];
+static bool s_sine_ready;
+
+/* Selection (any task writes, writer reads) and writer-published activity */
+static _Atomic uint32_t s_config = CFG_PACK(SIGNAL_GEN_OFF, 0, 0);
+static atomic_bool s_running = false;
+
+static inline uint32_t xorshift32(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static inline int32_t sine_at(uint32_t phase)
+{
+    uint32_t idx = phase >> SINE_FRAC_BITS;
+    int32_t frac = (int32_t)((phase >> (SINE_FRAC_BITS - 15)) & 0x7FFF);
+    int32_t a = s_sine[idx];
+    return a + (((s_sine[idx + 1] - a) * frac) >> 15);
+}
+
+static uint32_t phase_inc(float hz, uint32_t sample_rate)
+{
+    float nyquist = 0.5f * (float)sample_rate;
+    if (hz >= nyquist) {
+        hz = nyquist * 0.99f;
+    }
+    return (uint32_t)(hz / (float)sample_rate * 4294967296.0f);
+}
+
+/*
+ * Derive rate-dependent increments (start, or output rate changed)
+ */
+static void gen_configure_rate(gen_state_t *g, uint32_t sample_rate)
+{
+    g->sample_rate = sample_rate;
+
+    uint32_t fade_frames = sample_rate * SIGNAL_GEN_FADE_MS / 1000;
+    g->gain_step = (g->type == SIGNAL_GEN_RAMP) ? GAIN_ONE :
+                   GAIN_ONE / (int32_t)(fade_frames ? fade_frames : 1);
+
+    uint16_t param = CFG_PARAM(g->config);
+    switch (g->type) {
+    case SIGNAL_GEN_SINE:
+        g->inc[0] = phase_inc(param ? param : SIGNAL_GEN_DEFAULT_HZ, sample_rate);
+        break;
+
+    case SIGNAL_GEN_SWEEP: {
+        float seconds = param ? param : SIGNAL_GEN_DEFAULT_SWEEP_S;
+        g->sweep_lo = (float)phase_inc(SIGNAL_GEN_SWEEP_LO_HZ, sample_rate);
+        g->sweep_hi = (float)phase_inc(SIGNAL_GEN_SWEEP_HI_HZ, sample_rate);
+        g->sweep_k = powf(g->sweep_hi / g->sweep_lo,
+                          (float)SWEEP_STEP / (seconds * (float)sample_rate));
+        g->sweep_inc = g->sweep_lo;
+        break;
+    }
+
+    case SIGNAL_GEN_MULTITONE:
+        for (int i = 0; i < SIGNAL_GEN_TONES; i++) {
+            g->inc[i] = phase_inc(s_tone_hz[i], sample_rate);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*
+ * Start playing a selection from silence
+ */
+static void gen_start(gen_state_t *g, uint32_t config, uint32_t sample_rate)
+{
+    if (!s_sine_ready) {
+        for (int i = 0; i <= SINE_SIZE; i++) {
+            s_sine[i] = (int16_t)lroundf(32767.0f * sinf(2.0f * (float)M_PI * i / SINE_SIZE));
+        }
+        s_sine_ready = true;
+    }
+
+    memset(g, 0, sizeof(*g));
+    g->config = config;
+    g->type = CFG_TYPE(config);
+    g->level = (int32_t)lroundf(32767.0f * powf(10.0f, -(float)CFG_ATTEN(config) / 20.0f));
+    g->noise = 0x9E3779B9u;
+    gen_configure_rate(g, sample_rate);
+
+    ESP_LOGI(TAG, "Signal %d, -%u dBFS, param %u", (int)g->type,
+             (unsigned)CFG_ATTEN(config), (unsigned)CFG_PARAM(config));
+}
+
+/*
+ * Next mono sample at full level (every type but RAMP)
+ */
+static int32_t gen_sample(gen_state_t *g)
+{
+    switch (g->type) {
+    case SIGNAL_GEN_SINE: {
+        int32_t v = sine_at(g->phase[0]);
+        g->phase[0] += g->inc[0];
+        return v;
+    }
+
+    case SIGNAL_GEN_SWEEP: {
+        int32_t v = sine_at(g->phase[0]);
+        g->phase[0] += (uint32_t)g->sweep_inc;
+        if ((++g->count & (SWEEP_STEP - 1)) == 0) {
+            g->sweep_inc *= g->sweep_k;
+            if (g->sweep_inc > g->sweep_hi) {
+                g->sweep_inc = g->sweep_lo;     /* Restart; phase stays continuous */
+            }
+        }
+        return v;
+    }
+
+    case SIGNAL_GEN_WHITE:
+        return (int16_t)(xorshift32(&g->noise) >> 16);
+
+    case SIGNAL_GEN_PINK: {
+        /* Row k changes every 2^(k+1) samples; rows are ±1024 */
+        uint32_t n = ++g->count;
+        int k = __builtin_ctz(n | (1u << (PINK_ROWS - 1)));
+        int32_t fresh = (int32_t)xorshift32(&g->noise) >> 21;
+        g->pink_sum += fresh - g->pink_rows[k];
+        g->pink_rows[k] = fresh;
+        int32_t white = (int32_t)xorshift32(&g->noise) >> 21;
+        /* 17 sources of ±1024 → scale to just under full scale */
+        return ((g->pink_sum + white) * 15) >> 3;
+    }
+
+    case SIGNAL_GEN_MULTITONE: {
+        int32_t v = 0;
+        for (int i = 0; i < SIGNAL_GEN_TONES; i++) {
+            v += sine_at(g->phase[i]);
+            g->phase[i] += g->inc[i];
+        }
+        return v / SIGNAL_GEN_TONES;
+    }
+
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Public API Implementation
+ */
+
+esp_err_t signal_gen_set(signal_gen_type_t type, uint8_t atten_db, uint16_t param)
+{
+    if (type >= SIGNAL_GEN_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    atomic_store_explicit(&s_config, CFG_PACK(type, atten_db, param), memory_order_relaxed);
+    return ESP_OK;
+}
+
+signal_gen_type_t signal_gen_get_type(void)
+{
+    return CFG_TYPE(atomic_load_explicit(&s_config, memory_order_relaxed));
+}
+
+bool signal_gen_is_active(void)
+{
+    return signal_gen_get_type() != SIGNAL_GEN_OFF ||
+           atomic_load_explicit(&s_running, memory_order_relaxed);
+}
+
+bool signal_gen_process(int16_t *block, size_t frames, uint32_t sample_rate)
+{
+    gen_state_t *g = &s_gen;
+    uint32_t want = atomic_load_explicit(&s_config, memory_order_relaxed);
+
+    if (!atomic_load_explicit(&s_running, memory_order_relaxed)) {
+        if (CFG_TYPE(want) == SIGNAL_GEN_OFF) {
+            memset(block, 0, frames * 2 * sizeof(int16_t));
+            return false;
+        }
+        gen_start(g, want, sample_rate);
+        atomic_store_explicit(&s_running, true, memory_order_relaxed);
+    }
+
+    /* A new selection fades the current one out first */
+    if (want != g->config) {
+        g->fading_out = true;
+    }
+    if (sample_rate != g->sample_rate) {
+        gen_configure_rate(g, sample_rate);
+    }
+
+    for (size_t i = 0; i < frames; i++) {
+        if (g->fading_out) {
+            g->gain = (g->gain > g->gain_step) ? g->gain - g->gain_step : 0;
+        } else if (g->gain < GAIN_ONE) {
+            g->gain = (g->gain < GAIN_ONE - g->gain_step) ? g->gain + g->gain_step : GAIN_ONE;
+        }
+
+        if (g->type == SIGNAL_GEN_RAMP) {
+            /* Bit-exact: unscaled, and cut rather than faded */
+            int16_t n = (int16_t)g->count++;
+            block[2 * i] = (g->gain != 0) ? n : 0;
+            block[2 * i + 1] = (g->gain != 0) ? (int16_t)~n : 0;
+            continue;
+        }
+
+        int32_t v = (gen_sample(g) * g->level) >> 15;
+        if (g->gain < GAIN_ONE) {
+            v = (v * g->gain) >> 15;
+        }
+        block[2 * i] = (int16_t)v;
+        block[2 * i + 1] = (int16_t)v;
+    }
+
+    if (g->fading_out && g->gain == 0) {
+        if (CFG_TYPE(want) == SIGNAL_GEN_OFF) {
+            atomic_store_explicit(&s_running, false, memory_order_relaxed);
+            ESP_LOGI(TAG, "Signal stopped");
+            return false;
+        }
+        gen_start(g, want, sample_rate);     /* Fades in from the next block */
+    }
+
+    return true;
+}
@@ -0,0 +1,102 @@
+/*
+ * Test Signal Generator
+ * Diagnostic signals injected into the I2S writer in place of A2DP audio
+ *
+ * Used on the production line and in the field to check the I2S link and
+ * the STM32 chain without a phone: selected at runtime over BLE (command
+ * 0x0C) or the DSP UART, while Bluetooth stays up. While a signal plays,
+ * incoming A2DP audio is discarded; stopping hands the output back to the
+ * pre-buffer, so the stream resumes cleanly.
+ *
+ * Signals start and stop with a short fade, except RAMP, which is a
+ * bit-exactness pattern and is never scaled: L carries a free-running
+ * 16-bit sample counter and R its bitwise inverse, so any dropped, repeated
+ * or swapped sample and any stuck data bit shows up downstream.
+ *
+ * Threading: signal_gen_process() belongs to the I2S writer task.
+ * signal_gen_set() and the getters are lock-free and safe from any task.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef SIGNAL_GEN_H
+#define SIGNAL_GEN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Signal types (BLE/UART command byte 1)
+ */
+typedef enum {
+    SIGNAL_GEN_OFF = 0,
+    SIGNAL_GEN_SINE,                /* param: frequency in Hz */
+    SIGNAL_GEN_SWEEP,               /* Log sweep 20 Hz → 20 kHz, param: seconds per sweep */
+    SIGNAL_GEN_WHITE,
+    SIGNAL_GEN_PINK,
+    SIGNAL_GEN_MULTITONE,           /* SIGNAL_GEN_TONES sines at prime frequencies */
+    SIGNAL_GEN_RAMP,                /* L: sample counter, R: ~counter; level ignored */
+    SIGNAL_GEN_COUNT,
+} signal_gen_type_t;
+
+/* Defaults when a command leaves the parameter out (0) */
+#define SIGNAL_GEN_DEFAULT_HZ       1000
+#define SIGNAL_GEN_DEFAULT_SWEEP_S  10
+
+/* Log sweep range */
+#define SIGNAL_GEN_SWEEP_LO_HZ      20
+#define SIGNAL_GEN_SWEEP_HI_HZ      20000
+
+/* Multitone tone count (each at 1/SIGNAL_GEN_TONES of the level) */
+#define SIGNAL_GEN_TONES            8
+
+/* Start/stop fade */
+#define SIGNAL_GEN_FADE_MS          5
+
+/*
+ * Select the test signal
+ * The writer fades the current output out and the new signal in.
+ *
+ * @param type Signal type, SIGNAL_GEN_OFF to hand the output back to A2DP
+ * @param atten_db Level below full scale in dB (peak)
+ * @param param Type-specific parameter (see signal_gen_type_t), 0 = default
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for an unknown type
+ */
+esp_err_t signal_gen_set(signal_gen_type_t type, uint8_t atten_db, uint16_t param);
+
+/*
+ * Get the selected signal type
+ *
+ * @return Requested type (the writer may still be fading towards it)
+ */
+signal_gen_type_t signal_gen_get_type(void);
+
+/*
+ * Whether the generator owns the output
+ * True while a signal is selected and until its fade-out has finished.
+ *
+ * @return true if the writer must call signal_gen_process()
+ */
+bool signal_gen_is_active(void);
+
+/*
+ * Generate one output block (writer task)
+ *
+ * @param block Interleaved 16-bit stereo output
+ * @param frames Frames to generate
+ * @param sample_rate Output sample rate in Hz
+ * @return true while still active, false once stopped and faded out
+ */
+bool signal_gen_process(int16_t *block, size_t frames, uint32_t sample_rate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIGNAL_GEN_H */
@@ -0,0 +1,322 @@
+/*
+ * Spectrum Analyser Feed Implementation
+ *
+ * The writer fills one of two frame buffers. A finished frame is handed
+ * over only while the analysis task is idle (s_busy clear); the writer
+ * then switches to the other buffer, so the two never touch the same one.
+ *
+ * The FFT is radix-2 decimation in time on 32-bit integers with Q15
+ * twiddles, halving at every stage so it cannot overflow. Each frame is
+ * first scaled up to use the full 16 bits (block floating point) and the
+ * shift is taken back out in dB, so quiet passages keep their resolution.
+ * Band sums and the dB conversion run in float, 16 per frame.
+ *
+ * The analysis task sits on the writer's core below every audio task, so
+ * it only runs in the time the writer spends blocked on I2S.
+ *
+ * Date: 2026-10-16
+ */
+
+#include "spectrum.h"
+#include "ble_gatt_dsp.h"
+#include <math.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "SPECTRUM";
+
+#define SPECTRUM_TASK_STACK_SIZE    3072
+#define SPECTRUM_TASK_PRIORITY      2       /* Below everything audio related */
+#define SPECTRUM_TASK_CORE          1       /* The I2S writer's core */
+
+#define FFT_BITS                    8
+#define FFT_HALF                    (SPECTRUM_FFT_SIZE / 2)
+
+#if (1 << FFT_BITS) != SPECTRUM_FFT_SIZE
+#error "FFT_BITS must match SPECTRUM_FFT_SIZE"
+#endif
+#if SPECTRUM_DECIMATION != 2
+#error "spectrum_feed() averages frame pairs"
+#endif
+
+/* One frame of decimated mono output */
+typedef struct {
+    int16_t pcm[SPECTRUM_FFT_SIZE];
+    uint32_t sample_rate;
+} spectrum_frame_t;
+
+/* Collection state — owned by the writer task */
+typedef struct {
+    uint32_t sample_rate;
+    uint32_t wait_frames;           /* Output frames until the next frame starts */
+    size_t fill;                    /* Samples in the frame being collected */
+    int buf;                        /* Frame buffer being filled */
+} spectrum_feed_t;
+
+/* Analysis state — owned by the analysis task */
+typedef struct {
+    int16_t window[SPECTRUM_FFT_SIZE];      /* Hann, Q15 */
+    int16_t cos_q15[FFT_HALF];
+    int16_t sin_q15[FFT_HALF];
+    int32_t re[SPECTRUM_FFT_SIZE];
+    int32_t im[SPECTRUM_FFT_SIZE];
+    uint8_t band_lo[SPECTRUM_BANDS];        /* First bin of each band */
+    uint8_t band_hi[SPECTRUM_BANDS];        /* One past the last bin */
+    uint32_t bands_rate;                    /* Rate the band edges were set for */
+    float full_scale;                       /* Band power of a full-scale sine */
+} spectrum_dsp_t;
+
+static spectrum_frame_t s_frames[2];
+static spectrum_feed_t s_feed;
+static spectrum_dsp_t s_dsp;
+static TaskHandle_t s_task = NULL;
+
+static atomic_bool s_enabled = false;
+static _Atomic uint32_t s_rate_hz = SPECTRUM_DEFAULT_RATE_HZ;
+static atomic_bool s_busy = false;          /* Analysis task owns s_frames[s_ready] */
+static int s_ready;
+static _Atomic uint32_t s_skipped;          /* Frames dropped since the last notification */
+
+static uint32_t bit_reverse(uint32_t v)
+{
+    uint32_t r = 0;
+    for (int i = 0; i < FFT_BITS; i++) {
+        r = (r << 1) | ((v >> i) & 1);
+    }
+    return r;
+}
+
+/*
+ * Map the band edges to FFT bins for one output rate
+ * The lowest bands are narrower than a bin; each still gets at least one.
+ */
+static void bands_design(spectrum_dsp_t *d, uint32_t sample_rate)
+{
+    float bin_hz = (float)sample_rate / SPECTRUM_DECIMATION / SPECTRUM_FFT_SIZE;
+    float top_hz = (float)sample_rate / SPECTRUM_DECIMATION / 2.0f;
+    float ratio = powf(top_hz / SPECTRUM_LOW_HZ, 1.0f / SPECTRUM_BANDS);
+    float edge = SPECTRUM_LOW_HZ;
+
+    for (int b = 0; b < SPECTRUM_BANDS; b++) {
+        int lo = (int)lroundf(edge / bin_hz);
+        edge *= ratio;
+        int hi = (b == SPECTRUM_BANDS - 1) ? FFT_HALF : (int)lroundf(edge / bin_hz);
+        if (lo < 1) {
+            lo = 1;
+        }
+        if (lo > FFT_HALF - 1) {
+            lo = FFT_HALF - 1;
+        }
+        if (hi <= lo) {
+            hi = lo + 1;
+        }
+        d->band_lo[b] = (uint8_t)lo;
+        d->band_hi[b] = (uint8_t)hi;
+    }
+    d->bands_rate = sample_rate;
+}
+
+/*
+ * In-place FFT of bit-reversed input, scaled by 1/N
+ */
+static void fft_run(spectrum_dsp_t *d)
+{
+    int32_t *re = d->re;
+    int32_t *im = d->im;
+
+    for (size_t len = 2; len <= SPECTRUM_FFT_SIZE; len <<= 1) {
+        size_t half = len >> 1;
+        size_t step = SPECTRUM_FFT_SIZE / len;
+        for (size_t i = 0; i < SPECTRUM_FFT_SIZE; i += len) {
+            for (size_t j = 0; j < half; j++) {
+                int32_t wr = d->cos_q15[j * step];
+                int32_t wi = -d->sin_q15[j * step];
+                size_t a = i + j;
+                size_t b = a + half;
+                int32_t tr = (int32_t)(((int64_t)wr * re[b] - (int64_t)wi * im[b] + (1 << 14)) >> 15);
+                int32_t ti = (int32_t)(((int64_t)wr * im[b] + (int64_t)wi * re[b] + (1 << 14)) >> 15);
+                re[b] = (re[a] - tr + 1) >> 1;
+                im[b] = (im[a] - ti + 1) >> 1;
+                re[a] = (re[a] + tr + 1) >> 1;
+                im[a] = (im[a] + ti + 1) >> 1;
+            }
+        }
+    }
+}
+
+/*
+ * Window, transform and reduce one frame to band levels
+ */
+static void spectrum_analyse(spectrum_dsp_t *d, const spectrum_frame_t *fr, uint8_t *levels)
+{
+    int32_t peak = 0;
+    for (size_t n = 0; n < SPECTRUM_FFT_SIZE; n++) {
+        int32_t v = (fr->pcm[n] < 0) ? -fr->pcm[n] : fr->pcm[n];
+        if (v > peak) {
+            peak = v;
+        }
+    }
+    if (peak == 0) {
+        memset(levels, 0, SPECTRUM_BANDS);
+        return;
+    }
+
+    /* Block floating point: use the full 16 bits, remember the gain */
+    int shift = 0;
+    while (shift < 15 && (peak << (shift + 1)) <= INT16_MAX) {
+        shift++;
+    }
+
+    for (size_t n = 0; n < SPECTRUM_FFT_SIZE; n++) {
+        int32_t x = fr->pcm[n] * (1 << shift);
+        size_t r = bit_reverse((uint32_t)n);
+        d->re[r] = (x * d->window[n] + (1 << 14)) >> 15;
+        d->im[r] = 0;
+    }
+
+    fft_run(d);
+
+    if (fr->sample_rate != d->bands_rate) {
+        bands_design(d, fr->sample_rate);
+    }
+
+    float shift_db = 6.0206f * (float)shift;
+    for (int b = 0; b < SPECTRUM_BANDS; b++) {
+        uint64_t power = 0;
+        for (int k = d->band_lo[b]; k < d->band_hi[b]; k++) {
+            power += (uint64_t)((int64_t)d->re[k] * d->re[k] + (int64_t)d->im[k] * d->im[k]);
+        }
+        float db = (power > 0) ? 10.0f * log10f((float)power / d->full_scale) - shift_db :
+                   SPECTRUM_FLOOR_DB;
+        float level = 2.0f * (db - SPECTRUM_FLOOR_DB);
+        if (level < 0.0f) {
+            level = 0.0f;
+        } else if (level > SPECTRUM_LEVEL_FULL_SCALE) {
+            level = SPECTRUM_LEVEL_FULL_SCALE;
+        }
+        levels[b] = (uint8_t)lroundf(level);
+    }
+}
+
+static void spectrum_task(void *arg)
+{
+    (void)arg;
+    uint8_t levels[SPECTRUM_BANDS];
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!atomic_load_explicit(&s_busy, memory_order_acquire)) {
+            continue;
+        }
+
+        spectrum_analyse(&s_dsp, &s_frames[s_ready], levels);
+        atomic_store_explicit(&s_busy, false, memory_order_release);
+
+        uint32_t skipped = atomic_exchange_explicit(&s_skipped, 0, memory_order_relaxed);
+        if (atomic_load_explicit(&s_enabled, memory_order_relaxed)) {
+            ble_gatt_dsp_notify_spectrum(levels, SPECTRUM_BANDS,
+                                         (skipped > UINT8_MAX) ? UINT8_MAX : (uint8_t)skipped);
+        }
+    }
+}
+
+/*
+ * Public API Implementation
+ */
+
+esp_err_t spectrum_init(void)
+{
+    spectrum_dsp_t *d = &s_dsp;
+
+    for (size_t n = 0; n < SPECTRUM_FFT_SIZE; n++) {
+        float w = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * (float)n / SPECTRUM_FFT_SIZE);
+        d->window[n] = (int16_t)lroundf(w * INT16_MAX);
+    }
+    for (size_t k = 0; k < FFT_HALF; k++) {
+        float phase = 2.0f * (float)M_PI * (float)k / SPECTRUM_FFT_SIZE;
+        d->cos_q15[k] = (int16_t)lroundf(cosf(phase) * INT16_MAX);
+        d->sin_q15[k] = (int16_t)lroundf(sinf(phase) * INT16_MAX);
+    }
+
+    /* A full-scale sine through the Hann window and the 1/N FFT puts
+     * 3/32 of A^2 into its band (one-sided) */
+    d->full_scale = 3.0f / 32.0f * (float)INT16_MAX * (float)INT16_MAX;
+    d->bands_rate = 0;
+
+    if (xTaskCreatePinnedToCore(spectrum_task, "spectrum", SPECTRUM_TASK_STACK_SIZE, NULL,
+                                SPECTRUM_TASK_PRIORITY, &s_task, SPECTRUM_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create analysis task");
+        s_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void spectrum_set_enabled(bool enabled)
+{
+    atomic_store_explicit(&s_enabled, enabled && s_task != NULL, memory_order_relaxed);
+}
+
+esp_err_t spectrum_set_rate(uint8_t hz)
+{
+    if (hz == 0 || hz > SPECTRUM_MAX_RATE_HZ) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    atomic_store_explicit(&s_rate_hz, hz, memory_order_relaxed);
+    return ESP_OK;
+}
+
+void spectrum_feed(const int16_t *block, size_t frames, uint32_t sample_rate)
+{
+    spectrum_feed_t *f = &s_feed;
+
+    if (!atomic_load_explicit(&s_enabled, memory_order_relaxed)) {
+        f->fill = 0;
+        f->wait_frames = 0;
+        return;
+    }
+    if (sample_rate != f->sample_rate) {
+        f->sample_rate = sample_rate;
+        f->fill = 0;                /* Never mix two rates in one frame */
+    }
+
+    size_t i = 0;
+    if (f->fill == 0) {
+        if (f->wait_frames >= frames) {
+            f->wait_frames -= frames;
+            return;
+        }
+        i = f->wait_frames;
+        f->wait_frames = 0;
+    }
+
+    /* Mono, two frames per sample */
+    spectrum_frame_t *fr = &s_frames[f->buf];
+    for (; i + 1 < frames && f->fill < SPECTRUM_FFT_SIZE; i += SPECTRUM_DECIMATION) {
+        int32_t sum = block[2 * i] + block[2 * i + 1] + block[2 * i + 2] + block[2 * i + 3];
+        fr->pcm[f->fill++] = (int16_t)(sum >> 2);
+    }
+    if (f->fill < SPECTRUM_FFT_SIZE) {
+        return;
+    }
+
+    /* Frame complete: hand it over, or drop it while the task is busy */
+    if (!atomic_load_explicit(&s_busy, memory_order_acquire)) {
+        fr->sample_rate = sample_rate;
+        s_ready = f->buf;
+        atomic_store_explicit(&s_busy, true, memory_order_release);
+        xTaskNotifyGive(s_task);
+        f->buf ^= 1;
+    } else {
+        atomic_fetch_add_explicit(&s_skipped, 1, memory_order_relaxed);
+    }
+    f->fill = 0;
+
+    /* Space frames at the requested rate; the rest of this block counts */
+    uint32_t interval = sample_rate / atomic_load_explicit(&s_rate_hz, memory_order_relaxed);
+    uint32_t spent = SPECTRUM_FFT_SIZE * SPECTRUM_DECIMATION + (uint32_t)(frames - i);
+    f->wait_frames = (interval > spent) ? interval - spent : 0;
+}
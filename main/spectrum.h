@@ -0,0 +1,93 @@
+/*
+ * Spectrum Analyser Feed
+ * Band levels of the output for the companion app's visualiser
+ *
+ * The writer task copies a mono, 2:1 decimated excerpt of the output into
+ * a SPECTRUM_FFT_SIZE frame, a few times per second, and hands it to a
+ * low-priority analysis task on the same core. That task applies a Hann
+ * window, runs a fixed-point FFT, sums the bins into SPECTRUM_BANDS
+ * log-spaced bands and sends them as a BLE notification (Spectrum
+ * characteristic, see ble_gatt_dsp.h).
+ *
+ * The writer never waits for the analysis: a frame completed while the
+ * task is still busy is dropped and counted, and the next notification
+ * reports how many were lost.
+ *
+ * Nothing runs until a client subscribes. Between frames the writer pays
+ * one atomic load per block, and while collecting one a decimating copy.
+ *
+ * Band levels are in 0.5 dB steps: SPECTRUM_LEVEL_FULL_SCALE is a
+ * full-scale sine in the band, 0 is SPECTRUM_FLOOR_DB or below.
+ *
+ * Threading: spectrum_feed() belongs to the I2S writer task. The setters
+ * are lock-free and safe from any task.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* FFT length, in decimated samples (~11.6 ms of output per frame at 44.1 kHz) */
+#define SPECTRUM_FFT_SIZE           256
+
+/* Output frames averaged into one analysed sample */
+#define SPECTRUM_DECIMATION         2
+
+/* Bands, log-spaced from SPECTRUM_LOW_HZ to the decimated Nyquist */
+#define SPECTRUM_BANDS              16
+#define SPECTRUM_LOW_HZ             100.0f
+
+/* Level scale */
+#define SPECTRUM_FLOOR_DB           (-80.0f)
+#define SPECTRUM_LEVEL_FULL_SCALE   160
+
+/* Notification rate */
+#define SPECTRUM_DEFAULT_RATE_HZ    10
+#define SPECTRUM_MAX_RATE_HZ        25
+
+/*
+ * Start the analysis task
+ *
+ * @return ESP_OK, or ESP_ERR_NO_MEM if the task cannot be created
+ */
+esp_err_t spectrum_init(void);
+
+/*
+ * Start or stop the feed (client subscribed / unsubscribed)
+ *
+ * @param enabled true to analyse and notify
+ */
+void spectrum_set_enabled(bool enabled);
+
+/*
+ * Set the notification rate
+ *
+ * @param hz Frames per second, 1..SPECTRUM_MAX_RATE_HZ
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG
+ */
+esp_err_t spectrum_set_rate(uint8_t hz);
+
+/*
+ * Collect output for the next frame (writer task)
+ *
+ * @param block Interleaved 16-bit stereo block
+ * @param frames Block length in frames
+ * @param sample_rate Output sample rate in Hz
+ */
+void spectrum_feed(const int16_t *block, size_t frames, uint32_t sample_rate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPECTRUM_H */
@@ -0,0 +1,191 @@
+/*
+ * Polyphase Sample Rate Converter Implementation
+ *
+ * Prototype filter h[n], n = 0 .. L*SRC_TAPS-1, at L × input rate.
+ * Branch p holds h[p + j*L] for j = 0 .. SRC_TAPS-1 and is applied to the
+ * SRC_TAPS newest input frames (newest first). Per output frame:
+ *   while phase >= L: shift in one input frame, phase -= L
+ *   y = sum_j h_phase[j] * x[n - j]
+ *   phase += M
+ *
+ * Date: 2026-10-16
+ */
+
+#include "src_polyphase.h"
+#include <math.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "SRC";
+
+/* Coefficient format */
+#define COEF_SHIFT          14
+#define COEF_ONE            (1 << COEF_SHIFT)
+
+/* Kaiser window shape (~70 dB stopband) */
+#define KAISER_BETA         7.0f
+
+static inline int16_t sat16(int32_t v)
+{
+    if (v > INT16_MAX) return INT16_MAX;
+    if (v < INT16_MIN) return INT16_MIN;
+    return (int16_t)v;
+}
+
+static uint32_t gcd_u32(uint32_t a, uint32_t b)
+{
+    while (b != 0) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* Zeroth-order modified Bessel function (series, converges fast for beta < 10) */
+static float bessel_i0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    float q = x * x / 4.0f;
+    for (int k = 1; k < 25; k++) {
+        term *= q / (float)(k * k);
+        sum += term;
+        if (term < sum * 1e-7f) {
+            break;
+        }
+    }
+    return sum;
+}
+
+/*
+ * Public API Implementation
+ */
+
+esp_err_t src_polyphase_init(src_polyphase_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->coefs = heap_caps_malloc(SRC_MAX_PHASES * SRC_TAPS * sizeof(int16_t),
+                                MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (s->coefs == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate coefficient table");
+        return ESP_ERR_NO_MEM;
+    }
+    s->L = 1;
+    s->M = 1;
+    s->bypass = 1;
+    src_polyphase_reset(s);
+    return ESP_OK;
+}
+
+esp_err_t src_polyphase_configure(src_polyphase_t *s, uint32_t in_rate, uint32_t out_rate)
+{
+    if (s->coefs == NULL || in_rate == 0 || out_rate == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t g = gcd_u32(in_rate, out_rate);
+    uint32_t L = out_rate / g;
+    uint32_t M = in_rate / g;
+
+    if (L > SRC_MAX_PHASES || M > UINT16_MAX) {
+        ESP_LOGE(TAG, "Unsupported ratio %lu -> %lu Hz", (unsigned long)in_rate,
+                 (unsigned long)out_rate);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    s->L = (uint16_t)L;
+    s->M = (uint16_t)M;
+    s->bypass = (L == M);
+
+    if (!s->bypass) {
+        /* Cutoff at the lower Nyquist, in cycles per sample at L × in_rate */
+        uint32_t n_taps = L * SRC_TAPS;
+        float fc = 0.5f / (float)((L > M) ? L : M);
+        float center = (float)(n_taps - 1) / 2.0f;
+        float i0_beta = bessel_i0(KAISER_BETA);
+
+        for (uint32_t p = 0; p < L; p++) {
+            float h[SRC_TAPS];
+            float sum = 0.0f;
+
+            for (uint32_t j = 0; j < SRC_TAPS; j++) {
+                float t = (float)(p + j * L) - center;
+                float sinc = (t == 0.0f) ? 2.0f * fc
+                                         : sinf(2.0f * (float)M_PI * fc * t) / ((float)M_PI * t);
+                float r = t / center;
+                float w = bessel_i0(KAISER_BETA * sqrtf(fmaxf(0.0f, 1.0f - r * r))) / i0_beta;
+                h[j] = sinc * w;
+                sum += h[j];
+            }
+
+            /* Normalize every branch to exact unity DC gain */
+            for (uint32_t j = 0; j < SRC_TAPS; j++) {
+                s->coefs[p * SRC_TAPS + j] = sat16((int32_t)lrintf(h[j] / sum * COEF_ONE));
+            }
+        }
+    }
+
+    src_polyphase_reset(s);
+
+    ESP_LOGI(TAG, "Configured %lu -> %lu Hz (L=%lu, M=%lu%s)", (unsigned long)in_rate,
+             (unsigned long)out_rate, (unsigned long)L, (unsigned long)M,
+             s->bypass ? ", bypass" : "");
+    return ESP_OK;
+}
+
+void src_polyphase_reset(src_polyphase_t *s)
+{
+    memset(s->hist, 0, sizeof(s->hist));
+    s->hist_idx = 0;
+    s->phase = s->L;
+}
+
+size_t src_polyphase_process(src_polyphase_t *s, const int16_t *in, size_t in_frames,
+                             size_t *in_used, int16_t *out, size_t out_frames)
+{
+    if (s->bypass) {
+        size_t n = (in_frames < out_frames) ? in_frames : out_frames;
+        memcpy(out, in, n * 2 * sizeof(int16_t));
+        *in_used = n;
+        return n;
+    }
+
+    size_t in_i = 0;
+    size_t out_n = 0;
+
+    while (out_n < out_frames) {
+        while (s->phase >= s->L) {
+            if (in_i == in_frames) {
+                goto done;
+            }
+            /* Newest frame goes in front; the doubled copy keeps the
+             * SRC_TAPS window contiguous without wrap checks */
+            s->hist_idx = (s->hist_idx == 0) ? SRC_TAPS - 1 : s->hist_idx - 1;
+            s->hist[0][s->hist_idx] = s->hist[0][s->hist_idx + SRC_TAPS] = in[2 * in_i];
+            s->hist[1][s->hist_idx] = s->hist[1][s->hist_idx + SRC_TAPS] = in[2 * in_i + 1];
+            in_i++;
+            s->phase -= s->L;
+        }
+
+        const int16_t *h = &s->coefs[s->phase * SRC_TAPS];
+        const int16_t *xl = &s->hist[0][s->hist_idx];
+        const int16_t *xr = &s->hist[1][s->hist_idx];
+        int32_t acc_l = 1 << (COEF_SHIFT - 1);
+        int32_t acc_r = 1 << (COEF_SHIFT - 1);
+        for (int j = 0; j < SRC_TAPS; j++) {
+            acc_l += (int32_t)h[j] * xl[j];
+            acc_r += (int32_t)h[j] * xr[j];
+        }
+        out[2 * out_n] = sat16(acc_l >> COEF_SHIFT);
+        out[2 * out_n + 1] = sat16(acc_r >> COEF_SHIFT);
+        out_n++;
+
+        s->phase += s->M;
+    }
+
+done:
+    *in_used = in_i;
+    return out_n;
+}
@@ -0,0 +1,96 @@
+/*
+ * Polyphase Sample Rate Converter (fixed ratio)
+ * A2DP stream rate → fixed I2S output rate (16/32/44.1 kHz → 48 kHz)
+ *
+ * Rational L/M resampler: the prototype low-pass is a Kaiser-windowed sinc
+ * of SRC_TAPS taps per phase, generated once per rate change and stored as
+ * Q14 int16 phases. Each output frame is one SRC_TAPS-tap dot product per
+ * channel, so the cost does not depend on L (160 phases for 44.1 → 48 kHz).
+ *
+ * Filter: cutoff at the input Nyquist, ~70 dB stopband. Passband is flat
+ * to within ±0.05 dB up to ~19 kHz for 44.1 kHz input; the transition band
+ * folds into 20–24 kHz at 48 kHz output, above the audible band.
+ *
+ * Equal rates are passed through untouched.
+ *
+ * Not thread safe: one instance is owned by the I2S writer task.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef SRC_POLYPHASE_H
+#define SRC_POLYPHASE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Taps per polyphase branch */
+#define SRC_TAPS            32
+
+/* Largest supported interpolation factor L (44.1 → 48 kHz needs 160) */
+#define SRC_MAX_PHASES      160
+
+/*
+ * Converter state
+ */
+typedef struct {
+    int16_t *coefs;                 /* [L][SRC_TAPS] Q14, allocated by init */
+    uint16_t L;                     /* Interpolation factor */
+    uint16_t M;                     /* Decimation factor */
+    uint16_t phase;                 /* Current branch, >= L means "need input" */
+    uint16_t hist_idx;              /* Newest frame position in hist */
+    uint8_t bypass;                 /* Input rate == output rate */
+    int16_t hist[2][2 * SRC_TAPS];  /* Per-channel history, stored twice */
+} src_polyphase_t;
+
+/*
+ * Allocate the coefficient table (SRC_MAX_PHASES × SRC_TAPS)
+ *
+ * @param s Converter state
+ * @return ESP_OK on success, ESP_ERR_NO_MEM on allocation failure
+ */
+esp_err_t src_polyphase_init(src_polyphase_t *s);
+
+/*
+ * Design the filter for a rate pair and reset history
+ * Takes a few ms (float filter design); call from the writer task.
+ *
+ * @param s Converter state
+ * @param in_rate Input sample rate in Hz
+ * @param out_rate Output sample rate in Hz
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if L exceeds SRC_MAX_PHASES
+ */
+esp_err_t src_polyphase_configure(src_polyphase_t *s, uint32_t in_rate, uint32_t out_rate);
+
+/*
+ * Clear history (keeps the current filter)
+ *
+ * @param s Converter state
+ */
+void src_polyphase_reset(src_polyphase_t *s);
+
+/*
+ * Resample interleaved 16-bit stereo
+ * Stops when either the input is exhausted or the output is full.
+ *
+ * @param s Converter state
+ * @param in Input frames
+ * @param in_frames Number of input frames available
+ * @param in_used Out: number of input frames consumed
+ * @param out Output buffer
+ * @param out_frames Output capacity in frames
+ * @return Number of output frames produced
+ */
+size_t src_polyphase_process(src_polyphase_t *s, const int16_t *in, size_t in_frames,
+                             size_t *in_used, int16_t *out, size_t out_frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_POLYPHASE_H */
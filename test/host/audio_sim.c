@@ -0,0 +1,688 @@
+/*
+ * Audio Path Simulator
+ * The A2DP callback → ring → I2S writer path on a virtual clock
+ *
+ * Drives the firmware's own audio_ring.c, jitter_buffer.c and asrc.c with
+ * a packet arrival trace (captured on target, a2dp_trace.h, or synthesized
+ * with drift, random delay, bursts and stalls), against an I2S clock that
+ * may drift itself. The writer is modelled on i2s_writer_task():
+ *
+ * - PREBUFFER until the ring holds the jitter target; the DMA plays
+ *   silence meanwhile, and is filled with silence when the target is
+ *   reached (writer_prebuffer())
+ * - then one block per DMA descriptor played, pulled through the ASRC
+ * - a short block is an underrun: concealment completes it and the writer
+ *   re-buffers (the fade-out is not modelled, so it re-buffers at once)
+ * - after each full block: overflow policy, then ASRC steering on the fill
+ *   error, with the constants of audio_pipeline.c
+ *
+ * Reports underruns, dropped and skipped audio, packet latency to the I2S
+ * output (arrival to the start of the block that plays it) as percentiles,
+ * and ring fill statistics.
+ *
+ * Usage:
+ *   audio_sim [options] [trace.log]    one run, report printed
+ *   audio_sim --suite                  built-in scenarios with pass/fail
+ *
+ * Options (synthetic source unless a trace is given):
+ *   --profile robust|low-latency|deep   --policy drop-newest|drop-oldest|compress
+ *   --rate HZ  --seconds S  --packet-bytes N  --seed N
+ *   --drift-ppm P (source clock)  --sink-ppm P (I2S clock)
+ *   --jitter-us N  --burst N  --gap-every-ms N  --gap-ms N
+ *
+ * Date: 2026-10-16
+ */
+
+#include "audio_ring.h"
+#include "jitter_buffer.h"
+#include "asrc.h"
+#include "host_trace.h"
+#include "host_stubs.h"
+#include "host_test.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <getopt.h>
+
+#define FRAME_BYTES             4
+
+/* As in audio_pipeline.c */
+#define RINGBUF_SIZE            (32 * 1024)
+#define DEEP_RINGBUF_SIZE       (512 * 1024)
+#define OVERFLOW_MARGIN_MS      60
+#define OVERFLOW_COMPRESS_PPM   4000
+
+/* Audio past the last packet that is still simulated */
+#define DRAIN_US                1000000
+
+/*
+ * Latency profiles (s_profiles in audio_pipeline.c)
+ */
+typedef struct {
+    const char *name;
+    uint32_t dma_desc_num;
+    uint32_t block_frames;
+    uint32_t jb_min_ms;
+    uint32_t jb_default_ms;
+    uint32_t jb_max_ms;
+    uint32_t ring_bytes;
+} sim_profile_t;
+
+static const sim_profile_t s_profiles[] = {
+    {"robust", 8, 480, JB_TARGET_MIN_MS, JB_TARGET_DEFAULT_MS, JB_TARGET_MAX_MS, RINGBUF_SIZE},
+    {"low-latency", 4, 240, 10, 25, 60, RINGBUF_SIZE},
+    {"deep", 8, 480, 1000, 1000, 2000, DEEP_RINGBUF_SIZE},
+};
+
+typedef enum {
+    POLICY_DROP_NEWEST = 0,
+    POLICY_DROP_OLDEST,
+    POLICY_COMPRESS,
+} sim_policy_t;
+
+static const char *const s_policy_names[] = {"drop-newest", "drop-oldest", "compress"};
+
+typedef struct {
+    const sim_profile_t *profile;
+    sim_policy_t policy;
+    double sink_ppm;                /* I2S clock error (+: plays fast) */
+} sim_config_t;
+
+/* Growable sample set for percentiles */
+typedef struct {
+    double *v;
+    size_t n;
+    size_t cap;
+} sim_samples_t;
+
+typedef struct {
+    double seconds;                 /* Simulated time */
+    size_t packets;
+    size_t dropped_packets;         /* Ring full (drop-newest, or last resort) */
+    uint64_t dropped_bytes;
+    uint64_t skipped_bytes;         /* Discarded by drop-oldest */
+    uint32_t underruns;             /* Until the last packet: not the final drain */
+    uint32_t late_underruns;        /* More than a second into the stream */
+    double last_underrun_s;
+    double silent_ms;               /* Output gaps between first play and last packet */
+    double compress_ms;
+    uint32_t target_ms_end;
+    uint32_t target_ms_max;
+    uint32_t jitter_us_end;
+    int32_t ppm_end;
+    int32_t ppm_min;
+    int32_t ppm_max;
+    sim_samples_t latency_ms;
+    sim_samples_t fill_ms;
+} sim_report_t;
+
+/* Packet in the ring, waiting to be played */
+typedef struct {
+    size_t start_pos;               /* Ring write position of its first byte */
+    size_t end_pos;
+    int64_t arrival_us;
+} sim_packet_t;
+
+typedef enum {
+    SIM_PREBUFFER = 0,
+    SIM_PLAYING,
+} sim_state_t;
+
+/* Simulation state */
+typedef struct {
+    const sim_config_t *cfg;
+    sim_report_t *r;
+    audio_ring_t ring;
+    uint8_t *storage;
+    asrc_t asrc;
+    uint32_t rate;
+    size_t limit;
+    sim_state_t state;
+    bool compressing;
+    bool started;                   /* Stream has played at least once */
+    int64_t first_play_us;
+    int64_t source_end_us;          /* Last packet arrival */
+
+    /* DMA: blocks queued, the first one playing until next_tick_us */
+    uint32_t queued;
+    double period_us;
+    double next_tick_us;
+
+    /* Packets in the ring, oldest first */
+    sim_packet_t *fifo;
+    size_t fifo_head;
+    size_t fifo_count;
+    size_t fifo_cap;
+
+    int16_t *block;
+} sim_t;
+
+static void samples_add(sim_samples_t *s, double v)
+{
+    if (s->n == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 4096;
+        s->v = realloc(s->v, s->cap * sizeof(double));
+        if (s->v == NULL) {
+            abort();
+        }
+    }
+    s->v[s->n++] = v;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Percentile of a sorted set (0 when empty) */
+static double percentile(const sim_samples_t *s, double p)
+{
+    if (s->n == 0) {
+        return 0.0;
+    }
+    size_t i = (size_t)(p / 100.0 * (double)(s->n - 1) + 0.5);
+    return s->v[i];
+}
+
+static double mean(const sim_samples_t *s)
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < s->n; i++) {
+        sum += s->v[i];
+    }
+    return s->n ? sum / (double)s->n : 0.0;
+}
+
+static void fifo_push(sim_t *sim, size_t start, size_t end, int64_t arrival_us)
+{
+    if (sim->fifo_count == sim->fifo_cap) {
+        size_t cap = sim->fifo_cap ? sim->fifo_cap * 2 : 1024;
+        sim_packet_t *f = malloc(cap * sizeof(*f));
+        if (f == NULL) {
+            abort();
+        }
+        for (size_t i = 0; i < sim->fifo_count; i++) {
+            f[i] = sim->fifo[(sim->fifo_head + i) % sim->fifo_cap];
+        }
+        free(sim->fifo);
+        sim->fifo = f;
+        sim->fifo_head = 0;
+        sim->fifo_cap = cap;
+    }
+    sim->fifo[(sim->fifo_head + sim->fifo_count) % sim->fifo_cap] =
+        (sim_packet_t) { start, end, arrival_us };
+    sim->fifo_count++;
+}
+
+/*
+ * Retire packets the writer has read into
+ *
+ * @param play_us Start of the block they play in, or < 0 if discarded unplayed
+ */
+static void fifo_retire(sim_t *sim, double play_us)
+{
+    size_t read_pos = audio_ring_read_pos(&sim->ring);
+    while (sim->fifo_count > 0) {
+        sim_packet_t *p = &sim->fifo[sim->fifo_head];
+        /* Discards only retire packets they swallowed whole */
+        size_t edge = (play_us < 0) ? p->end_pos : p->start_pos;
+        if ((ptrdiff_t)(read_pos - edge) < ((play_us < 0) ? 0 : 1)) {
+            break;
+        }
+        if (play_us >= 0) {
+            samples_add(&sim->r->latency_ms, (play_us - (double)p->arrival_us) / 1000.0);
+        }
+        sim->fifo_head = (sim->fifo_head + 1) % sim->fifo_cap;
+        sim->fifo_count--;
+    }
+}
+
+/* audio_pipeline_push(): the A2DP data callback */
+static void sim_push(sim_t *sim, int64_t now_us, uint32_t len)
+{
+    static const uint8_t zeros[8192];
+
+    len &= ~(uint32_t)(FRAME_BYTES - 1);
+    if (len == 0 || len > sizeof(zeros)) {
+        return;
+    }
+    sim->r->packets++;
+    jitter_buffer_on_packet(now_us, len);
+
+    size_t start = audio_ring_write_pos(&sim->ring);
+    if (audio_ring_fill(&sim->ring) + len > sim->limit ||
+        !audio_ring_write(&sim->ring, zeros, len)) {
+        sim->r->dropped_packets++;
+        sim->r->dropped_bytes += len;
+        return;
+    }
+    fifo_push(sim, start, start + len, now_us);
+}
+
+/* writer_handle_overflow() */
+static bool sim_overflow(sim_t *sim, size_t fill, size_t target)
+{
+    size_t high = target + (size_t)sim->rate * OVERFLOW_MARGIN_MS / 1000 * FRAME_BYTES;
+    if (high > sim->limit / 8 * 7) {
+        high = sim->limit / 8 * 7;
+    }
+
+    switch (sim->cfg->policy) {
+    case POLICY_DROP_OLDEST:
+        size_t mid = (high > target) ? target + (high - target) / 2 : target;
+        if (fill > high && fill > mid) {
+            size_t len = (fill - mid) & ~(size_t)(FRAME_BYTES - 1);
+            sim->r->skipped_bytes += audio_ring_read_discard(&sim->ring, len);
+            fifo_retire(sim, -1.0);
+        }
+        return false;
+
+    case POLICY_COMPRESS:
+        if (fill > high) {
+            sim->compressing = true;
+        } else if (fill <= target) {
+            sim->compressing = false;
+        }
+        if (sim->compressing) {
+            asrc_set_ppm(&sim->asrc, OVERFLOW_COMPRESS_PPM);
+            sim->r->compress_ms += sim->period_us / 1000.0;
+        }
+        return sim->compressing;
+
+    default:
+        return false;
+    }
+}
+
+/*
+ * Write one block into the DMA queue (writer_pull_asrc() and the tail of
+ * the i2s_writer_task() loop)
+ */
+static void sim_write_block(sim_t *sim, int64_t now_us)
+{
+    size_t want = sim->cfg->profile->block_frames;
+    size_t frames = 0;
+
+    while (frames < want) {
+        size_t len = sim->ring.capacity;
+        const uint8_t *span = audio_ring_read_peek(&sim->ring, &len);
+        if (span == NULL || len < FRAME_BYTES) {
+            break;
+        }
+        size_t used = 0;
+        frames += asrc_process(&sim->asrc, (const int16_t *)span, len / FRAME_BYTES, &used,
+                               &sim->block[frames * 2], want - frames);
+        audio_ring_read_release(&sim->ring, used * FRAME_BYTES);
+    }
+
+    /* Plays once the blocks queued ahead of it have */
+    double play_us = sim->next_tick_us + (double)(sim->queued - 1) * sim->period_us;
+    sim->queued++;
+    fifo_retire(sim, play_us);
+
+    if (frames < want) {
+        if (now_us <= sim->source_end_us) {
+            sim->r->underruns++;
+            sim->r->last_underrun_s = now_us / 1e6;
+            if (now_us - sim->first_play_us > 1000000) {
+                sim->r->late_underruns++;
+            }
+        }
+        sim->state = SIM_PREBUFFER;
+        return;
+    }
+
+    size_t fill = audio_ring_fill(&sim->ring);
+    size_t target = jitter_buffer_get_target_bytes();
+    samples_add(&sim->r->fill_ms, (double)fill / FRAME_BYTES * 1000.0 / sim->rate);
+
+    if (sim_overflow(sim, fill, target)) {
+        return;
+    }
+    int32_t fill_error = ((int32_t)fill - (int32_t)target) / FRAME_BYTES;
+    int32_t ppm = asrc_steer(&sim->asrc, fill_error, (uint32_t)frames, sim->rate);
+    if (ppm < sim->r->ppm_min) {
+        sim->r->ppm_min = ppm;
+    }
+    if (ppm > sim->r->ppm_max) {
+        sim->r->ppm_max = ppm;
+    }
+}
+
+/* Writer side at time now: start playing, or top up the DMA queue */
+static void sim_writer(sim_t *sim, int64_t now_us)
+{
+    if (sim->state == SIM_PREBUFFER) {
+        if (audio_ring_fill(&sim->ring) < jitter_buffer_get_target_bytes()) {
+            return;
+        }
+        /* Free descriptors filled with silence: a gap, after a re-buffer */
+        uint32_t primed = sim->cfg->profile->dma_desc_num - sim->queued;
+        if (sim->started && now_us <= sim->source_end_us) {
+            sim->r->silent_ms += primed * sim->period_us / 1000.0;
+        }
+        sim->state = SIM_PLAYING;
+        sim->queued += primed;
+        if (!sim->started) {
+            sim->started = true;
+            sim->first_play_us = now_us;
+        }
+        return;
+    }
+    while (sim->state == SIM_PLAYING && sim->queued < sim->cfg->profile->dma_desc_num) {
+        sim_write_block(sim, now_us);
+    }
+}
+
+/* One DMA descriptor finished playing */
+static void sim_tick(sim_t *sim, int64_t now_us)
+{
+    sim->queued--;
+    if (sim->queued == 0) {
+        /* Nothing written: the DMA replays a cleared descriptor */
+        sim->queued = 1;
+        if (sim->started && now_us <= sim->source_end_us) {
+            sim->r->silent_ms += sim->period_us / 1000.0;
+        }
+    }
+    sim->next_tick_us += sim->period_us;
+}
+
+/*
+ * Run a trace through the path
+ *
+ * @param trace Packet arrivals
+ * @param cfg Profile, overflow policy and I2S clock
+ * @param r Report to fill (released with report_free())
+ */
+static void sim_run(const host_trace_t *trace, const sim_config_t *cfg, sim_report_t *r)
+{
+    const sim_profile_t *prof = cfg->profile;
+    sim_t sim = {
+        .cfg = cfg,
+        .r = r,
+        .rate = trace->sample_rate,
+        .limit = prof->ring_bytes,
+        .queued = 1,
+    };
+    memset(r, 0, sizeof(*r));
+
+    sim.storage = malloc(prof->ring_bytes);
+    sim.block = malloc(prof->block_frames * FRAME_BYTES);
+    if (sim.storage == NULL || sim.block == NULL) {
+        abort();
+    }
+    audio_ring_init(&sim.ring, sim.storage, prof->ring_bytes);
+    jitter_buffer_set_bounds(prof->jb_min_ms, prof->jb_default_ms, prof->jb_max_ms);
+    jitter_buffer_reset(sim.rate);
+    asrc_reset(&sim.asrc);
+
+    double out_rate = sim.rate * (1.0 + cfg->sink_ppm * 1e-6);
+    sim.period_us = prof->block_frames * 1e6 / out_rate;
+    sim.next_tick_us = sim.period_us;
+
+    sim.source_end_us = trace->count ? trace->packets[trace->count - 1].arrival_us : 0;
+    int64_t end_us = sim.source_end_us + DRAIN_US;
+    size_t next = 0;
+    int64_t now_us = 0;
+    while (now_us < end_us) {
+        if (next < trace->count && (double)trace->packets[next].arrival_us <= sim.next_tick_us) {
+            now_us = trace->packets[next].arrival_us;
+            host_clock_set_us(now_us);
+            sim_push(&sim, now_us, trace->packets[next].len);
+            next++;
+        } else {
+            now_us = (int64_t)sim.next_tick_us;
+            host_clock_set_us(now_us);
+            sim_tick(&sim, now_us);
+        }
+        sim_writer(&sim, now_us);
+
+        uint32_t target_ms = jitter_buffer_get_target_ms();
+        if (target_ms > r->target_ms_max) {
+            r->target_ms_max = target_ms;
+        }
+    }
+
+    r->seconds = now_us / 1e6;
+    r->target_ms_end = jitter_buffer_get_target_ms();
+    r->jitter_us_end = jitter_buffer_get_jitter_us();
+    r->ppm_end = sim.asrc.ppm;
+    qsort(r->latency_ms.v, r->latency_ms.n, sizeof(double), cmp_double);
+    qsort(r->fill_ms.v, r->fill_ms.n, sizeof(double), cmp_double);
+
+    free(sim.fifo);
+    free(sim.block);
+    free(sim.storage);
+    jitter_buffer_set_bounds(JB_TARGET_MIN_MS, JB_TARGET_DEFAULT_MS, JB_TARGET_MAX_MS);
+}
+
+static void report_print(const char *name, const sim_config_t *cfg, uint32_t rate,
+                         const sim_report_t *r)
+{
+    printf("%s (%s, %s, sink %+.0f ppm): %.1f s @ %lu Hz\n", name, cfg->profile->name,
+           s_policy_names[cfg->policy], cfg->sink_ppm, r->seconds, (unsigned long)rate);
+    printf("  packets %zu, dropped %zu (%llu bytes), skipped %llu bytes, compressed %.0f ms\n",
+           r->packets, r->dropped_packets, (unsigned long long)r->dropped_bytes,
+           (unsigned long long)r->skipped_bytes, r->compress_ms);
+    printf("  underruns %lu (%lu after the first second, last at %.1f s), output gaps %.0f ms\n",
+           (unsigned long)r->underruns, (unsigned long)r->late_underruns, r->last_underrun_s,
+           r->silent_ms);
+    printf("  latency ms  p50 %.1f  p95 %.1f  p99 %.1f  max %.1f\n",
+           percentile(&r->latency_ms, 50), percentile(&r->latency_ms, 95),
+           percentile(&r->latency_ms, 99), percentile(&r->latency_ms, 100));
+    printf("  fill ms     min %.1f  p5 %.1f  mean %.1f  p95 %.1f  max %.1f\n",
+           percentile(&r->fill_ms, 0), percentile(&r->fill_ms, 5), mean(&r->fill_ms),
+           percentile(&r->fill_ms, 95), percentile(&r->fill_ms, 100));
+    printf("  target %lu ms (max %lu), jitter %lu us, ASRC %+ld ppm (range %+ld..%+ld)\n",
+           (unsigned long)r->target_ms_end, (unsigned long)r->target_ms_max,
+           (unsigned long)r->jitter_us_end, (long)r->ppm_end, (long)r->ppm_min,
+           (long)r->ppm_max);
+}
+
+static void report_free(sim_report_t *r)
+{
+    free(r->latency_ms.v);
+    free(r->fill_ms.v);
+    memset(r, 0, sizeof(*r));
+}
+
+/*
+ * Built-in scenarios
+ */
+static const sim_profile_t *profile_by_name(const char *name)
+{
+    for (size_t i = 0; i < sizeof(s_profiles) / sizeof(s_profiles[0]); i++) {
+        if (strcasecmp(name, s_profiles[i].name) == 0) {
+            return &s_profiles[i];
+        }
+    }
+    return NULL;
+}
+
+static host_trace_model_t source(double seconds)
+{
+    return (host_trace_model_t) {
+        .sample_rate = 44100,
+        .packet_bytes = 4096,
+        .seconds = seconds,
+        .seed = 1,
+    };
+}
+
+static void scenario(const char *name, const host_trace_model_t *m, const sim_config_t *cfg,
+                     sim_report_t *r)
+{
+    host_trace_t t;
+    host_trace_generate(&t, m);
+    sim_run(&t, cfg, r);
+    report_print(name, cfg, t.sample_rate, r);
+    host_trace_free(&t);
+}
+
+static int run_suite(void)
+{
+    sim_config_t robust = { .profile = &s_profiles[0], .policy = POLICY_DROP_NEWEST };
+    sim_report_t r;
+
+    /* Steady source: plays through at the lowest target */
+    host_trace_model_t m = source(60.0);
+    scenario("steady", &m, &robust, &r);
+    CHECK(r.late_underruns == 0 && r.dropped_packets == 0);
+    CHECK(r.target_ms_end == JB_TARGET_MIN_MS);
+    CHECK(percentile(&r.latency_ms, 99) < 150.0);
+    double robust_p50 = percentile(&r.latency_ms, 50);
+    report_free(&r);
+
+    /* Clock drift inside the ASRC range, either side: absorbed */
+    m = source(300.0);
+    m.drift_ppm = 200.0;
+    scenario("source +200 ppm", &m, &robust, &r);
+    CHECK(r.late_underruns == 0 && r.dropped_packets == 0);
+    CHECK(r.ppm_end > 150);         /* Plus what drains the start-up excess */
+    report_free(&r);
+
+    sim_config_t slow_sink = robust;
+    slow_sink.sink_ppm = 200.0;
+    m = source(300.0);
+    scenario("sink +200 ppm", &m, &slow_sink, &r);
+    CHECK(r.late_underruns == 0 && r.dropped_packets == 0);
+    CHECK(r.ppm_end < -150 && r.ppm_end > -250);
+    report_free(&r);
+
+    /* Bursts and random delay: the target rises to cover them, and once it
+     * has there are no more underruns */
+    m = source(60.0);
+    m.burst_packets = 4;
+    m.jitter_us = 10000;
+    scenario("bursty", &m, &robust, &r);
+    CHECK(r.last_underrun_s < 5.0 && r.dropped_packets == 0);
+    CHECK(r.target_ms_end > 60);
+    report_free(&r);
+
+    /* Delivery stalls longer than any target: each one is an underrun, and
+     * the backlog delivered at its end overflows the 32 KB ring */
+    m = source(30.0);
+    m.gap_every_ms = 5000;
+    m.gap_ms = 400;
+    scenario("stalls", &m, &robust, &r);
+    CHECK(r.late_underruns >= 4 && r.dropped_packets > 0);
+    CHECK(r.silent_ms > 4 * 100.0);
+    report_free(&r);
+
+    /* Drift beyond the ASRC: each overflow policy */
+    m = source(120.0);
+    m.drift_ppm = 3000.0;
+    scenario("source +3000 ppm", &m, &robust, &r);
+    CHECK(r.dropped_packets > 0 && r.skipped_bytes == 0);
+    report_free(&r);
+
+    sim_config_t oldest = robust;
+    oldest.policy = POLICY_DROP_OLDEST;
+    scenario("source +3000 ppm", &m, &oldest, &r);
+    CHECK(r.dropped_packets == 0 && r.skipped_bytes > 0 && r.late_underruns == 0);
+    CHECK(percentile(&r.fill_ms, 100) < 150.0);
+    report_free(&r);
+
+    sim_config_t compress = robust;
+    compress.policy = POLICY_COMPRESS;
+    scenario("source +3000 ppm", &m, &compress, &r);
+    CHECK(r.dropped_packets == 0 && r.skipped_bytes == 0 && r.late_underruns == 0);
+    CHECK(r.compress_ms > 0.0);
+    report_free(&r);
+
+    /* Low-latency profile on a steady source */
+    sim_config_t low = { .profile = &s_profiles[1], .policy = POLICY_DROP_NEWEST };
+    m = source(60.0);
+    scenario("steady", &m, &low, &r);
+    CHECK(r.late_underruns == 0 && r.dropped_packets == 0);
+    CHECK(percentile(&r.latency_ms, 50) < robust_p50);
+    report_free(&r);
+
+    return host_test_result("audio_sim");
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option options[] = {
+        {"suite", no_argument, NULL, 'S'},
+        {"profile", required_argument, NULL, 'p'},
+        {"policy", required_argument, NULL, 'o'},
+        {"rate", required_argument, NULL, 'r'},
+        {"seconds", required_argument, NULL, 's'},
+        {"packet-bytes", required_argument, NULL, 'b'},
+        {"seed", required_argument, NULL, 'e'},
+        {"drift-ppm", required_argument, NULL, 'd'},
+        {"sink-ppm", required_argument, NULL, 'k'},
+        {"jitter-us", required_argument, NULL, 'j'},
+        {"burst", required_argument, NULL, 'u'},
+        {"gap-every-ms", required_argument, NULL, 'g'},
+        {"gap-ms", required_argument, NULL, 'G'},
+        {NULL, 0, NULL, 0},
+    };
+    sim_config_t cfg = { .profile = &s_profiles[0], .policy = POLICY_DROP_NEWEST };
+    host_trace_model_t m = source(60.0);
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+        case 'S':
+            return run_suite();
+        case 'p':
+            cfg.profile = profile_by_name(optarg);
+            if (cfg.profile == NULL) {
+                fprintf(stderr, "Unknown profile %s\n", optarg);
+                return 2;
+            }
+            break;
+        case 'o':
+            for (cfg.policy = 0; cfg.policy <= POLICY_COMPRESS; cfg.policy++) {
+                if (strcasecmp(optarg, s_policy_names[cfg.policy]) == 0) {
+                    break;
+                }
+            }
+            if (cfg.policy > POLICY_COMPRESS) {
+                fprintf(stderr, "Unknown policy %s\n", optarg);
+                return 2;
+            }
+            break;
+        case 'r': m.sample_rate = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 's': m.seconds = atof(optarg); break;
+        case 'b': m.packet_bytes = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'e': m.seed = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'd': m.drift_ppm = atof(optarg); break;
+        case 'k': cfg.sink_ppm = atof(optarg); break;
+        case 'j': m.jitter_us = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'u': m.burst_packets = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'g': m.gap_every_ms = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'G': m.gap_ms = (uint32_t)strtoul(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Usage: %s [--suite] [options] [trace.log]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    host_trace_t t;
+    const char *name = "synthetic";
+    if (optind < argc) {
+        name = argv[optind];
+        if (host_trace_load(&t, name) != 0) {
+            fprintf(stderr, "%s: no A2DPTRACE packets\n", name);
+            return 1;
+        }
+    } else {
+        if (m.sample_rate == 0 || m.packet_bytes == 0 || m.seconds <= 0) {
+            fprintf(stderr, "Bad source model\n");
+            return 2;
+        }
+        host_trace_generate(&t, &m);
+    }
+
+    sim_report_t r;
+    sim_run(&t, &cfg, &r);
+    report_print(name, &cfg, t.sample_rate, &r);
+    report_free(&r);
+    host_trace_free(&t);
+    return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * ASRC Host Benchmark
+ * CPU cost and THD+N of asrc.c across its steering range
+ *
+ * A -1 dBFS sine is resampled at fixed ratios in 480-frame output blocks,
+ * as the I2S writer does. Cost is the time spent in asrc_process() per
+ * output frame (both channels); THD+N is everything in the output but the
+ * sine at its resampled frequency, after the first block has settled.
+ *
+ * Fails if THD+N exceeds the limits below (never on timing).
+ *
+ * Usage: bench_asrc [seconds]   (default 10 of audio per run)
+ */
+
+#include "asrc.h"
+#include "host_test.h"
+#include <stdlib.h>
+
+#define RATE            44100
+#define BLOCK_FRAMES    480                     /* As AUDIO_BLOCK_FRAMES */
+#define AMPLITUDE       (32767.0 * 0.891)       /* -1 dBFS */
+
+/* The windowed-sinc kernel holds its error flat across the audio band */
+static const struct {
+    double hz;
+    double thdn_limit_db;
+} s_tones[] = {
+    {1000.0, -85.0},
+    {5000.0, -80.0},
+    {10000.0, -80.0},
+};
+
+typedef struct {
+    double cycles_per_frame;
+    double thdn_db;
+} bench_result_t;
+
+static int16_t *make_sine(size_t frames, double hz)
+{
+    int16_t *x = malloc(frames * 2 * sizeof(int16_t));
+    if (x == NULL) {
+        abort();
+    }
+    for (size_t i = 0; i < frames; i++) {
+        int16_t v = (int16_t)lrint(AMPLITUDE * sin(2.0 * M_PI * hz * (double)i / RATE));
+        x[2 * i] = v;
+        x[2 * i + 1] = (int16_t)-v;
+    }
+    return x;
+}
+
+static bench_result_t run(const int16_t *in, size_t in_frames, double hz, int32_t ppm)
+{
+    asrc_t s;
+    asrc_reset(&s);
+    asrc_set_ppm(&s, ppm);
+
+    size_t out_cap = in_frames + in_frames / 1000 + BLOCK_FRAMES;
+    int16_t *out = malloc(out_cap * 2 * sizeof(int16_t));
+    if (out == NULL) {
+        abort();
+    }
+
+    size_t in_pos = 0, out_n = 0;
+    uint64_t cycles = 0;
+    while (in_pos < in_frames && out_n + BLOCK_FRAMES <= out_cap) {
+        size_t used;
+        uint64_t t0 = host_cycles();
+        size_t got = asrc_process(&s, in + 2 * in_pos, in_frames - in_pos, &used,
+                                  out + 2 * out_n, BLOCK_FRAMES);
+        cycles += host_cycles() - t0;
+        in_pos += used;
+        out_n += got;
+    }
+
+    /* Positive ppm consumes input faster: the sine comes out higher */
+    double out_hz = hz * (1.0 + ppm * 1e-6);
+    bench_result_t r = {
+        .cycles_per_frame = (double)cycles / (double)out_n,
+        .thdn_db = host_thdn_db(out + 2 * BLOCK_FRAMES, 2, out_n - BLOCK_FRAMES,
+                                out_hz, RATE),
+    };
+    free(out);
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 10.0;
+    size_t frames = (size_t)((seconds > 0 ? seconds : 10.0) * RATE);
+    static const int32_t ppms[] = {0, 50, -50, ASRC_MAX_PPM, -ASRC_MAX_PPM};
+
+    printf("asrc: %zu frames @ %d Hz, %d-frame blocks\n", frames, RATE, BLOCK_FRAMES);
+    printf("  %8s  %6s  %12s  %10s\n", "tone", "ppm", HOST_CYCLES_UNIT "/frame", "THD+N");
+    for (size_t t = 0; t < sizeof(s_tones) / sizeof(s_tones[0]); t++) {
+        double hz = s_tones[t].hz;
+        int16_t *in = make_sine(frames, hz);
+        for (size_t p = 0; p < sizeof(ppms) / sizeof(ppms[0]); p++) {
+            bench_result_t r = run(in, frames, hz, ppms[p]);
+            printf("  %6.0f Hz  %+6ld  %12.1f  %7.1f dB\n", hz, (long)ppms[p],
+                   r.cycles_per_frame, r.thdn_db);
+            CHECK(r.thdn_db < s_tones[t].thdn_limit_db);
+        }
+        free(in);
+    }
+
+    return host_test_result("asrc");
+}
@@ -0,0 +1,186 @@
+/*
+ * Local DSP Engine Host Benchmark
+ * Cost per frame of each local_dsp.c configuration, and its limiter ceiling
+ *
+ * Every preset runs plain, with loudness, with bass boost, with both, and
+ * with both plus the normalizer (and EQ bypass once), each on two seconds
+ * of pink-ish noise in 480-frame blocks. The figure reported is the one
+ * the engine itself publishes (local_dsp_get_cycles_per_frame(),
+ * here in host TSC cycles, so compare configurations rather than against
+ * LOCAL_DSP_CYCLE_BUDGET).
+ *
+ * First the limiter is driven with a full-scale 100 Hz sine through the
+ * FULL preset, loudness and bass boost: no output sample may exceed
+ * -1 dBFS. Then the 32-bit output path must round to the 16-bit one.
+ *
+ * Usage: bench_local_dsp [seconds]   (default 2 of audio per configuration)
+ */
+
+#include "local_dsp.h"
+#include "host_test.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RATE            48000
+#define BLOCK_FRAMES    480
+#define CEILING         (int32_t)(32768.0 * 0.8913)    /* -1 dBFS */
+
+static const char *const s_preset_names[] = {"OFFICE", "FULL", "NIGHT", "SPEECH"};
+
+static uint32_t s_rng = 1;
+
+/* Sum of a few octave-spaced random walks: more low end than white noise */
+static void fill_noise(int16_t *block, size_t frames, int32_t *state)
+{
+    for (size_t i = 0; i < frames; i++) {
+        s_rng = s_rng * 1103515245u + 12345u;
+        int32_t white = (int16_t)(s_rng >> 16);
+        state[0] = (state[0] * 31 + white) / 32;
+        state[1] = (state[1] * 3 + white) / 4;
+        int32_t v = state[0] * 4 + state[1] + white / 4;
+        v = (v > INT16_MAX / 2) ? INT16_MAX / 2 : (v < INT16_MIN / 2) ? INT16_MIN / 2 : v;
+        block[2 * i] = (int16_t)v;
+        block[2 * i + 1] = (int16_t)-v;
+    }
+}
+
+/* Switch the engine to a state the way the writer does */
+static void apply_state(const local_dsp_state_t *st)
+{
+    local_dsp_set_state(st);
+    if (local_dsp_pending()) {
+        local_dsp_commit();
+    }
+}
+
+static uint32_t run_config(const local_dsp_state_t *st, double seconds)
+{
+    static int16_t block[BLOCK_FRAMES * 2];
+    int32_t noise[2] = {0};
+    size_t blocks = (size_t)(seconds * RATE / BLOCK_FRAMES);
+
+    apply_state(st);
+    for (size_t k = 0; k < blocks; k++) {
+        fill_noise(block, BLOCK_FRAMES, noise);
+        local_dsp_process(block, BLOCK_FRAMES, RATE);
+    }
+    return local_dsp_get_cycles_per_frame();
+}
+
+static void bench(double seconds)
+{
+    printf("local_dsp: %s per frame over the last second, %d-frame blocks @ %d Hz\n",
+           HOST_CYCLES_UNIT, BLOCK_FRAMES, RATE);
+    printf("  %-8s  %8s  %8s  %8s  %8s  %8s\n", "preset", "plain", "+loud", "+bass",
+           "+both", "+all");
+    for (uint8_t p = 0; p < 4; p++) {
+        local_dsp_state_t st = { .preset = p };
+        uint32_t plain = run_config(&st, seconds);
+        st.loudness = true;
+        uint32_t loud = run_config(&st, seconds);
+        st.loudness = false;
+        st.bass_boost = true;
+        uint32_t bass = run_config(&st, seconds);
+        st.loudness = true;
+        uint32_t both = run_config(&st, seconds);
+        st.normalizer = true;
+        uint32_t norm = run_config(&st, seconds);
+        printf("  %-8s  %8lu  %8lu  %8lu  %8lu  %8lu\n", s_preset_names[p],
+               (unsigned long)plain, (unsigned long)loud, (unsigned long)bass,
+               (unsigned long)both, (unsigned long)norm);
+        CHECK(plain > 0 && norm > 0);
+    }
+
+    local_dsp_state_t bypass = { .bypass = true, .loudness = true, .bass_boost = true };
+    printf("  %-8s  %8lu (dynamics only)\n", "bypass",
+           (unsigned long)run_config(&bypass, seconds));
+}
+
+static void test_limiter(void)
+{
+    static int16_t block[BLOCK_FRAMES * 2];
+    local_dsp_state_t st = { .preset = 1, .loudness = true, .bass_boost = true };
+    int32_t peak = 0;
+    size_t over = 0;
+    size_t n = 0;
+
+    apply_state(&st);
+    for (size_t k = 0; k < RATE / BLOCK_FRAMES; k++) {
+        for (size_t i = 0; i < BLOCK_FRAMES; i++, n++) {
+            int16_t v = (int16_t)lrint(32767.0 * sin(2.0 * M_PI * 100.0 * (double)n / RATE));
+            block[2 * i] = v;
+            block[2 * i + 1] = v;
+        }
+        local_dsp_process(block, BLOCK_FRAMES, RATE);
+        for (size_t i = 0; i < BLOCK_FRAMES * 2; i++) {
+            int32_t a = (block[i] < 0) ? -block[i] : block[i];
+            if (a > peak) {
+                peak = a;
+            }
+            if (a > CEILING) {
+                over++;
+            }
+        }
+    }
+    printf("limiter: 0 dBFS 100 Hz, FULL + loudness + bass -> peak %ld (ceiling %ld), %zu over\n",
+           (long)peak, (long)CEILING, over);
+    CHECK(over == 0);
+    CHECK(peak > CEILING * 9 / 10);         /* Limited, not silenced */
+}
+
+/*
+ * The 32-bit path carries the same audio as the 16-bit one, with the
+ * bits below 16 kept: rounding it gives the 16-bit output exactly
+ */
+static void test_wide(void)
+{
+    static int16_t block[BLOCK_FRAMES * 2], narrow[BLOCK_FRAMES * 2];
+    static int32_t wide[BLOCK_FRAMES * 2];
+    local_dsp_state_t st = { .preset = 2, .loudness = true, .normalizer = true };
+    int32_t noise[2] = {0};
+    size_t mismatched = 0, fine = 0;
+
+    apply_state(&st);
+    for (size_t k = 0; k < RATE / BLOCK_FRAMES; k++) {
+        fill_noise(block, BLOCK_FRAMES, noise);
+        CHECK(local_dsp_process_wide(block, wide, BLOCK_FRAMES, RATE));
+        memcpy(narrow, block, sizeof(narrow));
+        for (size_t i = 0; i < BLOCK_FRAMES * 2; i++) {
+            int32_t v = (int32_t)(((int64_t)wide[i] + (1 << 15)) >> 16);
+            v = (v > INT16_MAX) ? INT16_MAX : v;
+            if (v != narrow[i]) {
+                mismatched++;
+            }
+            if ((wide[i] & 0xFF00) != 0) {
+                fine++;
+            }
+        }
+    }
+    printf("wide output: %zu samples differ from the 16-bit rounding, %zu carry bits below it\n",
+           mismatched, fine);
+    CHECK(mismatched == 0);
+    CHECK(fine > 0);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+
+    /* Publication needs a full second of audio */
+    if (seconds < 1.1) {
+        seconds = 1.1;
+    }
+
+    CHECK(local_dsp_set_mode(LOCAL_DSP_ON) == ESP_OK);
+    CHECK(local_dsp_get_cycles_per_frame() == 0);
+    test_limiter();
+    test_wide();
+    bench(seconds);
+
+    local_dsp_set_mode(LOCAL_DSP_OFF);
+    apply_state(&(local_dsp_state_t) {0});
+    CHECK(!local_dsp_is_active());
+    CHECK(local_dsp_get_cycles_per_frame() == 0);
+
+    return host_test_result("local_dsp");
+}
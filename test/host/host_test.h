@@ -0,0 +1,123 @@
+/*
+ * Host Test Helpers
+ * Check macro and timing shared by the tests and benchmarks in this directory
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HOST_CYCLES_UNIT    "cycles"
+#else
+#define HOST_CYCLES_UNIT    "ns"
+#endif
+
+static int host_test_failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            host_test_failures++; \
+        } \
+    } while (0)
+
+/* Exit status for main(): non-zero if any CHECK failed */
+static inline int host_test_result(const char *name)
+{
+    printf("%s: %s\n", name, host_test_failures ? "FAILED" : "passed");
+    return host_test_failures ? 1 : 0;
+}
+
+/* Wall-clock seconds */
+static inline double host_now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* CPU cycles on x86 (TSC), nanoseconds elsewhere */
+static inline uint64_t host_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/*
+ * Least-squares fit of a sine of known frequency (plus DC) to one channel
+ *
+ * @param x Interleaved samples
+ * @param stride Samples between frames (2: stereo)
+ * @param n Number of frames
+ * @param hz Sine frequency
+ * @param rate Sample rate of x
+ * @param amplitude Out: fitted amplitude (full scale = 32768)
+ * @return Residual power (noise and distortion), in squared sample units
+ */
+static inline double host_sine_fit(const int16_t *x, size_t stride, size_t n, double hz,
+                                   double rate, double *amplitude)
+{
+    double w = 2.0 * M_PI * hz / rate;
+    double ss = 0, sc = 0, cc = 0, s1 = 0, c1 = 0, n1 = (double)n;
+    double xs = 0, xc = 0, x1 = 0;
+    for (size_t i = 0; i < n; i++) {
+        double s = sin(w * (double)i), c = cos(w * (double)i), v = x[i * stride];
+        ss += s * s; sc += s * c; cc += c * c; s1 += s; c1 += c;
+        xs += v * s; xc += v * c; x1 += v;
+    }
+
+    /* Normal equations for v ~ a*sin + b*cos + d (Cramer's rule) */
+    double m[3][3] = {{ss, sc, s1}, {sc, cc, c1}, {s1, c1, n1}};
+    double r[3] = {xs, xc, x1};
+    double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                 m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                 m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    double coef[3];
+    for (int k = 0; k < 3; k++) {
+        double t[3][3];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                t[i][j] = (j == k) ? r[i] : m[i][j];
+            }
+        }
+        coef[k] = (t[0][0] * (t[1][1] * t[2][2] - t[1][2] * t[2][1]) -
+                   t[0][1] * (t[1][0] * t[2][2] - t[1][2] * t[2][0]) +
+                   t[0][2] * (t[1][0] * t[2][1] - t[1][1] * t[2][0])) / det;
+    }
+
+    double resid = 0;
+    for (size_t i = 0; i < n; i++) {
+        double e = x[i * stride] - (coef[0] * sin(w * (double)i) +
+                                    coef[1] * cos(w * (double)i) + coef[2]);
+        resid += e * e;
+    }
+    *amplitude = sqrt(coef[0] * coef[0] + coef[1] * coef[1]);
+    return resid / n1;
+}
+
+/*
+ * THD+N of one channel against a sine of known frequency
+ *
+ * @return Everything but the fitted sine, relative to it, in dB
+ */
+static inline double host_thdn_db(const int16_t *x, size_t stride, size_t n, double hz,
+                                  double rate)
+{
+    double amplitude;
+    double resid = host_sine_fit(x, stride, n, hz, rate, &amplitude);
+    double signal = amplitude * amplitude / 2.0;
+    return 10.0 * log10((resid > 0 ? resid : 1e-12) / signal);
+}
+
+#endif /* HOST_TEST_H */
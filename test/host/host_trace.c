@@ -0,0 +1,134 @@
+/*
+ * A2DP Arrival Traces for Host Tests Implementation
+ *
+ * Date: 2026-10-16
+ */
+
+#include "host_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME_BYTES     4
+
+static void trace_push(host_trace_t *t, int64_t arrival_us, uint32_t len)
+{
+    if (t->count == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 1024;
+        t->packets = realloc(t->packets, t->cap * sizeof(*t->packets));
+        if (t->packets == NULL) {
+            abort();
+        }
+    }
+    t->packets[t->count].arrival_us = arrival_us;
+    t->packets[t->count].len = len;
+    t->count++;
+}
+
+/* Arrival spacing of the last packet, used to join captures */
+static int64_t trace_period_us(const host_trace_t *t)
+{
+    if (t->count == 0 || t->sample_rate == 0) {
+        return 0;
+    }
+    return (int64_t)t->packets[t->count - 1].len * 1000000 / (t->sample_rate * FRAME_BYTES);
+}
+
+int host_trace_load(host_trace_t *t, const char *path)
+{
+    memset(t, 0, sizeof(*t));
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+
+    char line[256];
+    int64_t base_us = 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        /* The tag may follow a log prefix on the same line */
+        const char *p = strstr(line, "A2DPTRACE,");
+        if (p == NULL) {
+            continue;
+        }
+        p += strlen("A2DPTRACE,");
+
+        unsigned long rate, count, index, arrival, len;
+        if (sscanf(p, "BEGIN,%lu,%lu", &rate, &count) == 2) {
+            base_us = (t->count > 0) ?
+                      t->packets[t->count - 1].arrival_us + trace_period_us(t) : 0;
+            t->sample_rate = (uint32_t)rate;
+        } else if (sscanf(p, "%lu,%lu,%lu", &index, &arrival, &len) == 3) {
+            trace_push(t, base_us + (int64_t)arrival, (uint32_t)len);
+        }
+    }
+    fclose(f);
+
+    if (t->count == 0 || t->sample_rate == 0) {
+        host_trace_free(t);
+        return -1;
+    }
+    return 0;
+}
+
+void host_trace_generate(host_trace_t *t, const host_trace_model_t *m)
+{
+    memset(t, 0, sizeof(*t));
+    t->sample_rate = m->sample_rate;
+
+    /* Source clock: one packet per PCM duration, scaled by its drift */
+    double period_us = (double)m->packet_bytes * 1e6 / (m->sample_rate * FRAME_BYTES) /
+                       (1.0 + m->drift_ppm * 1e-6);
+    size_t packets = (size_t)(m->seconds * 1e6 / period_us);
+    uint32_t burst = (m->burst_packets > 1) ? m->burst_packets : 1;
+    uint32_t rng = m->seed ? m->seed : 1;
+    int64_t last_us = 0;
+
+    for (size_t i = 0; i < packets; i++) {
+        /* A burst goes out when its last packet is ready */
+        size_t group_end = (i / burst + 1) * burst - 1;
+        if (group_end >= packets) {
+            group_end = packets - 1;        /* Short last burst */
+        }
+        double send_us = (double)group_end * period_us;
+
+        if (m->gap_every_ms > 0) {
+            /* Inside a stall: held until it ends */
+            double every_us = m->gap_every_ms * 1000.0;
+            double gap_start = (double)(int64_t)(send_us / every_us) * every_us;
+            if (gap_start > 0 && send_us < gap_start + m->gap_ms * 1000.0) {
+                send_us = gap_start + m->gap_ms * 1000.0;
+            }
+        }
+
+        if (m->jitter_us > 0) {
+            rng = rng * 1103515245u + 12345u;
+            send_us += (double)((rng >> 8) % (m->jitter_us + 1));
+        }
+
+        /* The link delivers in order */
+        int64_t arrival_us = (int64_t)send_us;
+        if (arrival_us < last_us) {
+            arrival_us = last_us;
+        }
+        last_us = arrival_us;
+        trace_push(t, arrival_us, m->packet_bytes);
+    }
+}
+
+void host_trace_append(host_trace_t *t, const host_trace_t *tail)
+{
+    int64_t base_us = (t->count > 0) ?
+                      t->packets[t->count - 1].arrival_us + trace_period_us(t) : 0;
+    if (t->sample_rate == 0) {
+        t->sample_rate = tail->sample_rate;
+    }
+    for (size_t i = 0; i < tail->count; i++) {
+        trace_push(t, base_us + tail->packets[i].arrival_us, tail->packets[i].len);
+    }
+}
+
+void host_trace_free(host_trace_t *t)
+{
+    free(t->packets);
+    memset(t, 0, sizeof(*t));
+}
@@ -0,0 +1,86 @@
+/*
+ * A2DP Arrival Traces for Host Tests
+ * Load traces captured on target (a2dp_trace.h) or synthesize them
+ *
+ * A loaded trace is the A2DPTRACE lines grepped out of a monitor log (any
+ * other lines are skipped, so a raw log works too). A synthetic trace
+ * models a source sending fixed-size packets on its own clock, with
+ * optional clock drift, random delivery delay, bursts and delivery gaps.
+ *
+ * Date: 2026-10-16
+ */
+
+#ifndef HOST_TRACE_H
+#define HOST_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * One packet arrival
+ */
+typedef struct {
+    int64_t arrival_us;             /* Relative to the first packet */
+    uint32_t len;                   /* Bytes of 16-bit stereo PCM */
+} host_packet_t;
+
+/*
+ * Packet arrival trace
+ */
+typedef struct {
+    uint32_t sample_rate;
+    size_t count;
+    size_t cap;
+    host_packet_t *packets;
+} host_trace_t;
+
+/*
+ * Synthetic source model
+ */
+typedef struct {
+    uint32_t sample_rate;
+    uint32_t packet_bytes;          /* PCM bytes per packet */
+    double seconds;                 /* Stream length */
+    double drift_ppm;               /* Source clock error (+: sends fast) */
+    uint32_t jitter_us;             /* Uniform random delivery delay, 0..jitter_us */
+    uint32_t burst_packets;         /* Packets held and delivered together (0/1: none) */
+    uint32_t gap_every_ms;          /* Delivery stall interval (0: none) */
+    uint32_t gap_ms;                /* Stall length; held packets arrive at its end */
+    uint32_t seed;
+} host_trace_model_t;
+
+/*
+ * Load the A2DPTRACE lines of a monitor log
+ * Packets of several captures in one log are concatenated, each capture
+ * offset to start one packet after the previous one ended.
+ *
+ * @param t Trace to fill (freed with host_trace_free())
+ * @param path Log file
+ * @return 0 on success, -1 if the file cannot be read or has no packets
+ */
+int host_trace_load(host_trace_t *t, const char *path);
+
+/*
+ * Synthesize a trace from a source model
+ *
+ * @param t Trace to fill (freed with host_trace_free())
+ * @param m Source model
+ */
+void host_trace_generate(host_trace_t *t, const host_trace_model_t *m);
+
+/*
+ * Append another trace, starting one packet period after t ends
+ *
+ * @param t Trace to extend
+ * @param tail Trace appended (unchanged)
+ */
+void host_trace_append(host_trace_t *t, const host_trace_t *tail);
+
+/*
+ * Release a trace
+ *
+ * @param t Trace
+ */
+void host_trace_free(host_trace_t *t);
+
+#endif /* HOST_TRACE_H */
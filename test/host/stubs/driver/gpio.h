@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for ESP-IDF driver/gpio.h (pin numbers only)
+ */
+
+#ifndef HOST_DRIVER_GPIO_H
+#define HOST_DRIVER_GPIO_H
+
+#define GPIO_NUM_22     22
+#define GPIO_NUM_25     25
+#define GPIO_NUM_26     26
+
+#endif /* HOST_DRIVER_GPIO_H */
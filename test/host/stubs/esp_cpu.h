@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for ESP-IDF esp_cpu.h
+ */
+
+#ifndef HOST_ESP_CPU_H
+#define HOST_ESP_CPU_H
+
+#include <stdint.h>
+
+uint32_t esp_cpu_get_cycle_count(void);
+
+#endif /* HOST_ESP_CPU_H */
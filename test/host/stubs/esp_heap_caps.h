@@ -0,0 +1,25 @@
+/*
+ * Host stand-in for ESP-IDF esp_heap_caps.h
+ */
+
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT         (1 << 2)
+#define MALLOC_CAP_INTERNAL     (1 << 11)
+#define MALLOC_CAP_SPIRAM       (1 << 10)
+
+static inline void *heap_caps_malloc(size_t size, unsigned caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+static inline void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+#endif /* HOST_ESP_HEAP_CAPS_H */
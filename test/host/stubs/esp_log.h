@@ -0,0 +1,17 @@
+/*
+ * Host stand-in for ESP-IDF esp_log.h
+ * Errors and warnings go to stderr; info and debug are compiled out so
+ * benchmarks measure the kernels, not printf.
+ */
+
+#ifndef HOST_ESP_LOG_H
+#define HOST_ESP_LOG_H
+
+#include <stdio.h>
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ((void)(tag))
+#define ESP_LOGD(tag, fmt, ...) ((void)(tag))
+
+#endif /* HOST_ESP_LOG_H */
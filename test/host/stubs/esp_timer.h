@@ -0,0 +1,13 @@
+/*
+ * Host stand-in for ESP-IDF esp_timer.h
+ * Time is virtual: tests set and advance it (host_stubs.h).
+ */
+
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
+
+#endif /* HOST_ESP_TIMER_H */
@@ -0,0 +1,45 @@
+/*
+ * Host Stub Implementation
+ *
+ * esp_timer_get_time() reads a virtual clock, so time-driven code (jitter
+ * estimator, standby, rate windows) runs deterministically. The cycle
+ * counter is the CPU's own where there is one (TSC on x86), otherwise
+ * nanoseconds, so cycle figures from the firmware's own accounting stay
+ * meaningful as relative costs.
+ */
+
+#include "host_stubs.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static int64_t s_clock_us;
+
+void host_clock_set_us(int64_t us)
+{
+    s_clock_us = us;
+}
+
+void host_clock_advance_us(int64_t us)
+{
+    s_clock_us += us;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return s_clock_us;
+}
+
+uint32_t esp_cpu_get_cycle_count(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#endif
+}
@@ -0,0 +1,25 @@
+/*
+ * Host Stub Controls
+ * Virtual clock behind esp_timer_get_time()
+ */
+
+#ifndef HOST_STUBS_H
+#define HOST_STUBS_H
+
+#include <stdint.h>
+
+/*
+ * Set the virtual time returned by esp_timer_get_time()
+ *
+ * @param us Time in microseconds
+ */
+void host_clock_set_us(int64_t us);
+
+/*
+ * Advance the virtual time
+ *
+ * @param us Microseconds to add
+ */
+void host_clock_advance_us(int64_t us);
+
+#endif /* HOST_STUBS_H */
@@ -0,0 +1,288 @@
+/*
+ * Gain Stage Host Test
+ * Bit-exact golden vectors for the gain kernels and the mute, duck and
+ * volume ramps of audio_gain.c, plus a benchmark of the kernels
+ *
+ * Goldens: a hand-worked block for each kernel; the kernels against the
+ * formula documented in audio_gain.h over random blocks and edge gains;
+ * and the per-block Q15 gains each ramp must land on (worked out from the
+ * dB targets and AUDIO_GAIN_RAMP_DB_PER_SEC), replayed through
+ * audio_gain_process() and compared sample for sample.
+ *
+ * Usage: test_audio_gain [blocks]   (default 20000 per benchmark case)
+ */
+
+#include "audio_gain.h"
+#include "host_test.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RATE            48000
+#define BLOCK_FRAMES    480             /* 10 dB of ramp per block at 48 kHz */
+#define MAX_FRAMES      1024
+
+static uint32_t s_rng = 12345;
+
+static int16_t rand16(void)
+{
+    s_rng = s_rng * 1103515245u + 12345u;
+    return (int16_t)(s_rng >> 16);
+}
+
+static void fill_random(int16_t *x, size_t samples)
+{
+    for (size_t i = 0; i < samples; i++) {
+        x[i] = rand16();
+    }
+    /* Full-scale extremes in every block */
+    x[0] = INT16_MAX;
+    x[1] = INT16_MIN;
+}
+
+/* The documented gain of frame i */
+static int32_t model_gain(size_t i, size_t frames, int32_t g_start, int32_t g_end)
+{
+    if (g_start == g_end) {
+        return g_end;
+    }
+    int32_t step = ((g_end - g_start) * (1 << 15)) / (int32_t)frames;
+    return g_start + (int32_t)(((int64_t)i * step) >> 15);
+}
+
+static void model_apply(const int16_t *in, int16_t *out, size_t frames, int32_t g_start,
+                        int32_t g_end)
+{
+    for (size_t i = 0; i < frames * 2; i++) {
+        int32_t g = model_gain(i / 2, frames, g_start, g_end);
+        out[i] = (int16_t)(((int32_t)in[i] * g + (1 << 14)) >> 15);
+    }
+}
+
+static void model_apply_wide(const int16_t *in, int32_t *out, size_t frames,
+                             int32_t g_start, int32_t g_end)
+{
+    for (size_t i = 0; i < frames * 2; i++) {
+        int32_t g = model_gain(i / 2, frames, g_start, g_end);
+        out[i] = (int32_t)((uint32_t)((int32_t)in[i] * g) << 1);
+    }
+}
+
+static void model_apply_32(const int32_t *in, int32_t *out, size_t frames, int32_t g_start,
+                           int32_t g_end)
+{
+    for (size_t i = 0; i < frames * 2; i++) {
+        int64_t g = model_gain(i / 2, frames, g_start, g_end);
+        out[i] = (int32_t)(((int64_t)in[i] * g + (1 << 14)) >> 15);
+    }
+}
+
+/*
+ * A worked example: unity to silence over four frames
+ */
+static void test_kernel_vectors(void)
+{
+    static const int16_t in[8] = {32767, -32768, 1000, -1000, 3, -3, 12345, -1};
+    /* Frame gains 32768, 24576, 16384, 8192; round half up */
+    static const int16_t expect[8] = {32767, -32768, 750, -750, 2, -1, 3086, 0};
+    static const int32_t expect_wide[8] = {
+        2147418112, INT32_MIN, 49152000, -49152000, 98304, -98304, 202260480, -16384,
+    };
+
+    int16_t block[8];
+    int32_t wide[8];
+    memcpy(block, in, sizeof(block));
+    audio_gain_apply_q15(block, 4, AUDIO_GAIN_UNITY, 0);
+    CHECK(memcmp(block, expect, sizeof(block)) == 0);
+
+    audio_gain_apply_wide_q15(in, wide, 4, AUDIO_GAIN_UNITY, 0);
+    CHECK(memcmp(wide, expect_wide, sizeof(wide)) == 0);
+
+    /* Constant gains: unity untouched, zero silent, others rounded */
+    memcpy(block, in, sizeof(block));
+    audio_gain_apply_q15(block, 4, AUDIO_GAIN_UNITY, AUDIO_GAIN_UNITY);
+    CHECK(memcmp(block, in, sizeof(block)) == 0);
+    audio_gain_apply_q15(block, 4, 16384, 16384);
+    CHECK(block[0] == 16384 && block[1] == -16384 && block[2] == 500 && block[5] == -1);
+    audio_gain_apply_q15(block, 4, 0, 0);
+    CHECK(block[0] == 0 && block[7] == 0);
+}
+
+/*
+ * Kernels against the documented formula over random blocks
+ */
+static void test_kernel_model(void)
+{
+    static const int32_t gains[] = {0, 1, 10, 1036, 10362, 16384, 32767, AUDIO_GAIN_UNITY};
+    static const size_t lengths[] = {1, 3, 240, 256, 480, 1024};
+    static int16_t in[MAX_FRAMES * 2], got[MAX_FRAMES * 2], want[MAX_FRAMES * 2];
+    static int32_t got_wide[MAX_FRAMES * 2], want_wide[MAX_FRAMES * 2];
+    static int32_t in_32[MAX_FRAMES * 2];
+    size_t cases = 0;
+
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        size_t frames = lengths[l];
+        for (size_t a = 0; a < sizeof(gains) / sizeof(gains[0]); a++) {
+            for (size_t b = 0; b < sizeof(gains) / sizeof(gains[0]); b++) {
+                fill_random(in, frames * 2);
+
+                memcpy(got, in, frames * 2 * sizeof(int16_t));
+                audio_gain_apply_q15(got, frames, gains[a], gains[b]);
+                model_apply(in, want, frames, gains[a], gains[b]);
+                CHECK(memcmp(got, want, frames * 2 * sizeof(int16_t)) == 0);
+
+                audio_gain_apply_wide_q15(in, got_wide, frames, gains[a], gains[b]);
+                model_apply_wide(in, want_wide, frames, gains[a], gains[b]);
+                CHECK(memcmp(got_wide, want_wide, frames * 2 * sizeof(int32_t)) == 0);
+
+                /* 32-bit input with bits below the 16-bit word */
+                for (size_t i = 0; i < frames * 2; i++) {
+                    in_32[i] = (int32_t)((uint32_t)(int32_t)in[i] << 16) | (rand16() & 0xFFFF);
+                }
+                memcpy(got_wide, in_32, frames * 2 * sizeof(int32_t));
+                audio_gain_apply_q15_32(got_wide, frames, gains[a], gains[b]);
+                model_apply_32(in_32, want_wide, frames, gains[a], gains[b]);
+                CHECK(memcmp(got_wide, want_wide, frames * 2 * sizeof(int32_t)) == 0);
+                cases++;
+            }
+        }
+    }
+    printf("kernels: %zu cases bit-exact against the documented formula\n", cases);
+}
+
+/*
+ * Replay a ramp through audio_gain_process() and compare every sample
+ * with the model fed the golden block-end gains
+ *
+ * @param name Scenario name
+ * @param start_gain Q15 gain the stage is at when the ramp begins
+ * @param golden Block-end gains, the last one held
+ * @param blocks Number of golden gains
+ * @param frames Block length
+ */
+static void check_ramp(const char *name, int32_t start_gain, const int32_t *golden,
+                       size_t blocks, size_t frames)
+{
+    static int16_t in[MAX_FRAMES * 2], got[MAX_FRAMES * 2], want[MAX_FRAMES * 2];
+    int32_t g = start_gain;
+    size_t mismatched = 0;
+
+    /* One block past the end: the gain must hold */
+    for (size_t k = 0; k <= blocks; k++) {
+        int32_t g_end = golden[(k < blocks) ? k : blocks - 1];
+        fill_random(in, frames * 2);
+        memcpy(got, in, frames * 2 * sizeof(int16_t));
+        audio_gain_process(got, frames, RATE);
+        model_apply(in, want, frames, g, g_end);
+        if (memcmp(got, want, frames * 2 * sizeof(int16_t)) != 0) {
+            fprintf(stderr, "%s: block %zu differs (golden end gain %ld)\n", name, k,
+                    (long)g_end);
+            mismatched++;
+        }
+        g = g_end;
+    }
+    CHECK(mismatched == 0);
+    printf("%-14s %zu blocks of %zu frames: %s\n", name, blocks + 1, frames,
+           mismatched ? "MISMATCH" : "bit-exact");
+}
+
+static void test_ramps(void)
+{
+    /* Block-end gains: round(32768 * 10^(dB / 20)), floor -80 dB -> 0 */
+    static const int32_t mute[] = {10362, 3277, 1036, 328, 104, 33, 10, 0};
+    static const int32_t unmute[] = {10, 33, 104, 328, 1036, 3277, 10362, AUDIO_GAIN_UNITY};
+    static const int32_t duck[] = {10362, 8231};                    /* -10, -12 dB */
+    static const int32_t unduck[] = {26029, AUDIO_GAIN_UNITY};      /* -2, 0 dB */
+    static const int32_t vol_80[] = {16423};                        /* 100 -> 80: -6 dB */
+    static const int32_t vol_40[] = {5193, 3277};                   /* 80 -> 40: -20 dB */
+    static const int32_t vol_30[] = {1382};                         /* 40 -> 30: -27.5 dB */
+    static const int32_t vol_100[] = {4370, 13818, AUDIO_GAIN_UNITY};
+    static const int32_t half_mute[] = {                            /* 5 dB per 240 frames */
+        18427, 10362, 5827, 3277, 1843, 1036, 583, 328, 184, 104, 58, 33, 18, 10, 6, 0,
+    };
+    static const int32_t vol_0[] = {10362, 3277, 1036, 328, 104, 33, 10, 0};
+
+    audio_gain_set_local_stage(true);       /* Duck and volume applied here */
+
+    audio_gain_set_mute(true);
+    check_ramp("mute", AUDIO_GAIN_UNITY, mute, 8, BLOCK_FRAMES);
+    audio_gain_set_mute(false);
+    check_ramp("unmute", 0, unmute, 8, BLOCK_FRAMES);
+
+    audio_gain_set_duck(true);
+    check_ramp("duck", AUDIO_GAIN_UNITY, duck, 2, BLOCK_FRAMES);
+    audio_gain_set_duck(false);
+    check_ramp("unduck", 8231, unduck, 2, BLOCK_FRAMES);
+
+    audio_gain_set_volume(80);
+    check_ramp("volume 80", AUDIO_GAIN_UNITY, vol_80, 1, BLOCK_FRAMES);
+    audio_gain_set_volume(40);
+    check_ramp("volume 40", 16423, vol_40, 2, BLOCK_FRAMES);
+    audio_gain_set_volume(30);              /* Between curve points */
+    check_ramp("volume 30", 3277, vol_30, 1, BLOCK_FRAMES);
+    audio_gain_set_volume(100);
+    check_ramp("volume 100", 1382, vol_100, 3, BLOCK_FRAMES);
+
+    /* Shorter blocks take proportionally smaller steps */
+    audio_gain_set_mute(true);
+    check_ramp("mute 240", AUDIO_GAIN_UNITY, half_mute, 16, BLOCK_FRAMES / 2);
+    audio_gain_set_mute(false);
+    check_ramp("unmute", 0, unmute, 8, BLOCK_FRAMES);
+
+    /* Volume 0 is silence, reached as a fade */
+    audio_gain_set_volume(0);
+    check_ramp("volume 0", AUDIO_GAIN_UNITY, vol_0, 8, BLOCK_FRAMES);
+    audio_gain_set_volume(100);
+    audio_gain_set_local_stage(false);
+}
+
+/*
+ * Kernel cost per frame
+ */
+static void bench(size_t blocks)
+{
+    static int16_t block[BLOCK_FRAMES * 2];
+    static int32_t wide[BLOCK_FRAMES * 2];
+    static const struct {
+        const char *name;
+        int32_t g_start;
+        int32_t g_end;
+        bool widen;
+    } cases[] = {
+        {"unity (skipped)", AUDIO_GAIN_UNITY, AUDIO_GAIN_UNITY, false},
+        {"constant gain", 10362, 10362, false},
+        {"ramp", AUDIO_GAIN_UNITY, 10362, false},
+        {"widen", AUDIO_GAIN_UNITY, AUDIO_GAIN_UNITY, true},
+        {"wide constant", 10362, 10362, true},
+        {"wide ramp", AUDIO_GAIN_UNITY, 10362, true},
+    };
+
+    fill_random(block, BLOCK_FRAMES * 2);
+    printf("kernel cost, %d-frame blocks:\n", BLOCK_FRAMES);
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        uint64_t t0 = host_cycles();
+        for (size_t k = 0; k < blocks; k++) {
+            if (cases[c].widen) {
+                audio_gain_apply_wide_q15(block, wide, BLOCK_FRAMES, cases[c].g_start,
+                                          cases[c].g_end);
+            } else {
+                audio_gain_apply_q15(block, BLOCK_FRAMES, cases[c].g_start, cases[c].g_end);
+            }
+            block[k % (BLOCK_FRAMES * 2)] |= 1;     /* Keep the loop from folding */
+        }
+        uint64_t cycles = host_cycles() - t0;
+        printf("  %-16s %6.2f %s/frame\n", cases[c].name,
+               (double)cycles / ((double)blocks * BLOCK_FRAMES), HOST_CYCLES_UNIT);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t blocks = (argc > 1) ? (size_t)strtoul(argv[1], NULL, 10) : 20000;
+
+    test_kernel_vectors();
+    test_kernel_model();
+    test_ramps();
+    bench(blocks > 0 ? blocks : 20000);
+
+    return host_test_result("audio_gain");
+}
@@ -0,0 +1,314 @@
+/*
+ * Audio Ring Host Test
+ * Unit checks, a two-thread stress test and a throughput benchmark
+ *
+ * Stress: a producer thread pushes packets of varying size (mixing
+ * audio_ring_write() and reserve/commit) carrying a running byte counter;
+ * a consumer thread drains them with peek/release and discard and checks
+ * that every byte arrives once and in order.
+ *
+ * Benchmark: the same two-thread transfer through the SPSC ring and
+ * through a byte ring guarded by a spinlock on every push and pop, which
+ * is what xRingbufferSend()/xRingbufferReceive() pay per packet in the
+ * FreeRTOS byte buffer the ring replaced (that code only runs on target).
+ *
+ * Usage: test_audio_ring [megabytes]   (default 64 per run)
+ */
+
+#include "audio_ring.h"
+#include "host_test.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#define RING_SIZE           (32 * 1024)     /* As RINGBUF_SIZE in the pipeline */
+#define PACKET_MAX          4096            /* Largest SBC frame set seen */
+#define CONSUMER_CHUNK      1920            /* 480 frames, one writer block */
+
+static uint8_t s_storage[RING_SIZE];
+
+/*
+ * Unit checks on a small ring
+ */
+static void test_basic(void)
+{
+    audio_ring_t ring;
+    uint8_t buf[16];
+
+    CHECK(audio_ring_init(&ring, buf, 12) == ESP_ERR_INVALID_ARG);
+    CHECK(audio_ring_init(&ring, NULL, 16) == ESP_ERR_INVALID_ARG);
+    CHECK(audio_ring_init(&ring, buf, 16) == ESP_OK);
+    CHECK(audio_ring_fill(&ring) == 0);
+    CHECK(audio_ring_free(&ring) == 16);
+
+    const uint8_t data[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    CHECK(audio_ring_write(&ring, data, 12));
+    CHECK(!audio_ring_write(&ring, data, 8));       /* All or nothing */
+    CHECK(audio_ring_fill(&ring) == 12);
+
+    /* Consume 10, leaving the tail near the end, then wrap a write */
+    size_t len = 10;
+    const uint8_t *span = audio_ring_read_peek(&ring, &len);
+    CHECK(span != NULL && len == 10 && span[9] == 9);
+    audio_ring_read_release(&ring, 10);
+    CHECK(audio_ring_write(&ring, data, 12));
+    CHECK(audio_ring_fill(&ring) == 14);
+
+    /* Peek never crosses the wrap point */
+    len = 14;
+    span = audio_ring_read_peek(&ring, &len);
+    CHECK(span != NULL && len == 6 && span[0] == 10 && span[2] == 0);
+
+    /* Look-ahead past the wrap */
+    len = 16;
+    span = audio_ring_read_peek_at(&ring, 6, &len);
+    CHECK(span == buf && len == 8 && span[0] == 4);
+    len = 4;
+    CHECK(audio_ring_read_peek_at(&ring, 14, &len) == NULL && len == 0);
+
+    /* Reserve stops at the wrap point and at the free space */
+    CHECK(audio_ring_read_discard(&ring, 100) == 14);
+    CHECK(audio_ring_fill(&ring) == 0);
+    len = 16;
+    uint8_t *w = audio_ring_write_reserve(&ring, &len);
+    CHECK(w != NULL && len == 8);
+    audio_ring_write_commit(&ring, len);
+    CHECK(audio_ring_write_pos(&ring) - audio_ring_read_pos(&ring) == 8);
+}
+
+/*
+ * Stress: producer and consumer threads over the real ring size
+ */
+typedef struct {
+    audio_ring_t ring;
+    size_t total;
+    atomic_bool failed;
+} stress_t;
+
+static void *stress_producer(void *arg)
+{
+    stress_t *st = arg;
+    uint8_t packet[PACKET_MAX];
+    size_t sent = 0;
+    uint32_t rng = 1;
+
+    while (sent < st->total) {
+        rng = rng * 1103515245u + 12345u;
+        size_t len = 1 + (rng >> 8) % PACKET_MAX;
+        if (len > st->total - sent) {
+            len = st->total - sent;
+        }
+
+        if (rng & 0x10000) {
+            /* Whole packet, retried until there is room */
+            for (size_t i = 0; i < len; i++) {
+                packet[i] = (uint8_t)(sent + i);
+            }
+            while (!audio_ring_write(&st->ring, packet, len)) {
+                sched_yield();
+            }
+            sent += len;
+        } else {
+            /* In-place spans */
+            size_t span = len;
+            uint8_t *dst = audio_ring_write_reserve(&st->ring, &span);
+            if (dst == NULL) {
+                sched_yield();
+                continue;
+            }
+            for (size_t i = 0; i < span; i++) {
+                dst[i] = (uint8_t)(sent + i);
+            }
+            audio_ring_write_commit(&st->ring, span);
+            sent += span;
+        }
+    }
+    return NULL;
+}
+
+static void *stress_consumer(void *arg)
+{
+    stress_t *st = arg;
+    size_t received = 0;
+    uint32_t rng = 7;
+
+    while (received < st->total && !atomic_load(&st->failed)) {
+        rng = rng * 1103515245u + 12345u;
+        if ((rng & 0xF000) == 0) {
+            /* Occasionally drop data unread, as the overflow policy does */
+            received += audio_ring_read_discard(&st->ring, (rng >> 20) & 0xFF);
+            continue;
+        }
+
+        size_t len = CONSUMER_CHUNK;
+        const uint8_t *span = audio_ring_read_peek(&st->ring, &len);
+        if (span == NULL) {
+            sched_yield();
+            continue;
+        }
+        for (size_t i = 0; i < len; i++) {
+            if (span[i] != (uint8_t)(received + i)) {
+                fprintf(stderr, "Byte %zu: got %u, expected %u\n", received + i,
+                        span[i], (uint8_t)(received + i));
+                atomic_store(&st->failed, true);
+                return NULL;
+            }
+        }
+        audio_ring_read_release(&st->ring, len);
+        received += len;
+    }
+    return NULL;
+}
+
+static void test_stress(size_t total)
+{
+    stress_t st = { .total = total };
+    CHECK(audio_ring_init(&st.ring, s_storage, RING_SIZE) == ESP_OK);
+
+    pthread_t prod, cons;
+    double t0 = host_now_s();
+    pthread_create(&cons, NULL, stress_consumer, &st);
+    pthread_create(&prod, NULL, stress_producer, &st);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    double t1 = host_now_s();
+
+    CHECK(!atomic_load(&st.failed));
+    CHECK(audio_ring_fill(&st.ring) == 0);
+    CHECK(audio_ring_read_pos(&st.ring) == total);
+    printf("stress: %zu MB verified in %.2f s\n", total >> 20, t1 - t0);
+}
+
+/*
+ * Reference: byte ring with a spinlock around every push and pop
+ */
+typedef struct {
+    pthread_spinlock_t lock;
+    uint8_t *buf;
+    size_t capacity;
+    size_t head;
+    size_t tail;
+} locked_ring_t;
+
+static bool locked_write(locked_ring_t *r, const uint8_t *data, size_t len)
+{
+    bool ok = false;
+    pthread_spin_lock(&r->lock);
+    if (r->capacity - (r->head - r->tail) >= len) {
+        size_t off = r->head % r->capacity;
+        size_t first = (len < r->capacity - off) ? len : r->capacity - off;
+        memcpy(r->buf + off, data, first);
+        memcpy(r->buf, data + first, len - first);
+        r->head += len;
+        ok = true;
+    }
+    pthread_spin_unlock(&r->lock);
+    return ok;
+}
+
+static size_t locked_read(locked_ring_t *r, uint8_t *dst, size_t len)
+{
+    pthread_spin_lock(&r->lock);
+    size_t avail = r->head - r->tail;
+    if (len > avail) {
+        len = avail;
+    }
+    size_t off = r->tail % r->capacity;
+    if (len > r->capacity - off) {
+        len = r->capacity - off;
+    }
+    memcpy(dst, r->buf + off, len);
+    r->tail += len;
+    pthread_spin_unlock(&r->lock);
+    return len;
+}
+
+typedef struct {
+    bool locked;
+    audio_ring_t ring;
+    locked_ring_t lring;
+    size_t total;
+} bench_t;
+
+static void *bench_producer(void *arg)
+{
+    bench_t *b = arg;
+    static uint8_t packet[PACKET_MAX];
+    for (size_t sent = 0; sent < b->total; sent += PACKET_MAX) {
+        if (b->locked) {
+            while (!locked_write(&b->lring, packet, PACKET_MAX)) {
+                sched_yield();
+            }
+        } else {
+            while (!audio_ring_write(&b->ring, packet, PACKET_MAX)) {
+                sched_yield();
+            }
+        }
+    }
+    return NULL;
+}
+
+static void *bench_consumer(void *arg)
+{
+    bench_t *b = arg;
+    static uint8_t block[CONSUMER_CHUNK];
+    size_t received = 0;
+    while (received < b->total) {
+        size_t len = CONSUMER_CHUNK;
+        if (b->locked) {
+            len = locked_read(&b->lring, block, CONSUMER_CHUNK);
+        } else {
+            const uint8_t *span = audio_ring_read_peek(&b->ring, &len);
+            if (span != NULL) {
+                memcpy(block, span, len);
+                audio_ring_read_release(&b->ring, len);
+            }
+        }
+        if (len == 0) {
+            sched_yield();      /* Let the producer run on a single core */
+        }
+        received += len;
+    }
+    return NULL;
+}
+
+static double bench_run(bool locked, size_t total)
+{
+    static uint8_t lbuf[RING_SIZE];
+    bench_t b = { .locked = locked, .total = total };
+    audio_ring_init(&b.ring, s_storage, RING_SIZE);
+    pthread_spin_init(&b.lring.lock, PTHREAD_PROCESS_PRIVATE);
+    b.lring.buf = lbuf;
+    b.lring.capacity = RING_SIZE;
+
+    pthread_t prod, cons;
+    double t0 = host_now_s();
+    pthread_create(&cons, NULL, bench_consumer, &b);
+    pthread_create(&prod, NULL, bench_producer, &b);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    double t1 = host_now_s();
+
+    pthread_spin_destroy(&b.lring.lock);
+    return (double)total / (1 << 20) / (t1 - t0);
+}
+
+int main(int argc, char **argv)
+{
+    size_t mb = (argc > 1) ? (size_t)strtoul(argv[1], NULL, 10) : 64;
+    size_t total = (mb > 0 ? mb : 64) << 20;
+
+    test_basic();
+    test_stress(total);
+
+    /* Whole packets only: total rounded to PACKET_MAX */
+    total -= total % PACKET_MAX;
+    double spsc = bench_run(false, total);
+    double locked = bench_run(true, total);
+    printf("throughput: SPSC ring %.0f MB/s, spinlocked byte ring %.0f MB/s (%.1fx)\n",
+           spsc, locked, spsc / locked);
+
+    return host_test_result("audio_ring");
+}
@@ -0,0 +1,235 @@
+/*
+ * Jitter Buffer Host Test
+ * Replays packet arrival traces through jitter_buffer.c
+ *
+ * Synthetic sources check the estimator's contract: a steady source
+ * settles at the lowest target, a bursty one raises it at once to cover
+ * its bursts, the target decays only slowly once the source calms down,
+ * stalls are clamped to the upper bound, and pauses are not jitter.
+ *
+ * Usage: test_jitter_buffer [trace.log ...]
+ * Each trace given (A2DPTRACE lines from a monitor log, a2dp_trace.h) is
+ * replayed as well, printing target and jitter once per second.
+ */
+
+#include "jitter_buffer.h"
+#include "host_trace.h"
+#include "host_test.h"
+#include <stdbool.h>
+
+#define RATE            44100
+#define PACKET_BYTES    4096                    /* 1024 frames, ~23.2 ms */
+#define PACKET_US       (PACKET_BYTES * 1000000LL / (RATE * 4))
+
+typedef struct {
+    uint32_t target_ms;             /* At the end of the replay */
+    uint32_t jitter_us;
+    uint32_t max_target_ms;
+} replay_result_t;
+
+/*
+ * Feed a trace to a freshly reset estimator
+ *
+ * @param t Trace
+ * @param log_every_us Print target and jitter this often (0: never)
+ * @param until_us Stop at this arrival time (0: whole trace)
+ */
+static replay_result_t replay(const host_trace_t *t, int64_t log_every_us, int64_t until_us)
+{
+    replay_result_t r = {0};
+    int64_t next_log_us = 0;
+
+    jitter_buffer_reset(t->sample_rate);
+    for (size_t i = 0; i < t->count; i++) {
+        const host_packet_t *p = &t->packets[i];
+        if (until_us > 0 && p->arrival_us > until_us) {
+            break;
+        }
+        jitter_buffer_on_packet(p->arrival_us, p->len);
+
+        uint32_t target_ms = jitter_buffer_get_target_ms();
+        if (target_ms > r.max_target_ms) {
+            r.max_target_ms = target_ms;
+        }
+        if (log_every_us > 0 && p->arrival_us >= next_log_us) {
+            printf("  %7.2f s  target %3lu ms (%6lu bytes)  jitter %6lu us\n",
+                   p->arrival_us / 1e6, (unsigned long)target_ms,
+                   (unsigned long)jitter_buffer_get_target_bytes(),
+                   (unsigned long)jitter_buffer_get_jitter_us());
+            next_log_us = p->arrival_us + log_every_us;
+        }
+    }
+    r.target_ms = jitter_buffer_get_target_ms();
+    r.jitter_us = jitter_buffer_get_jitter_us();
+    return r;
+}
+
+static host_trace_model_t model(double seconds)
+{
+    return (host_trace_model_t) {
+        .sample_rate = RATE,
+        .packet_bytes = PACKET_BYTES,
+        .seconds = seconds,
+    };
+}
+
+static void test_steady(void)
+{
+    host_trace_t t;
+    host_trace_model_t m = model(20.0);
+    m.drift_ppm = -80.0;            /* Slow source clock: within the drift allowance */
+    host_trace_generate(&t, &m);
+
+    replay_result_t r = replay(&t, 0, 0);
+    printf("steady:      target %lu ms, jitter %lu us\n", (unsigned long)r.target_ms,
+           (unsigned long)r.jitter_us);
+    CHECK(r.max_target_ms == JB_TARGET_DEFAULT_MS);
+    CHECK(r.target_ms == JB_TARGET_MIN_MS);
+    CHECK(r.jitter_us == 0);
+    CHECK(jitter_buffer_get_target_bytes() == (uint32_t)(JB_TARGET_MIN_MS * RATE / 1000 * 4));
+    host_trace_free(&t);
+}
+
+static void test_bursty(void)
+{
+    host_trace_t t;
+    host_trace_model_t m = model(10.0);
+    m.burst_packets = 4;
+    host_trace_generate(&t, &m);
+
+    /* Three packet durations late before each burst lands */
+    replay_result_t r = replay(&t, 0, 0);
+    int64_t expect_us = 3 * PACKET_US;
+    printf("bursty x4:   target %lu ms, jitter %lu us (expect ~%lld)\n",
+           (unsigned long)r.target_ms, (unsigned long)r.jitter_us, (long long)expect_us);
+    CHECK(r.jitter_us > expect_us * 95 / 100 && r.jitter_us <= expect_us);
+    CHECK(r.target_ms == (r.jitter_us / 1000 + JB_MARGIN_MS) ||
+          r.target_ms == (r.jitter_us + 999) / 1000 + JB_MARGIN_MS - 1);
+
+    /* Fast attack: raised within the first second */
+    replay_result_t early = replay(&t, 0, 1000000);
+    CHECK(early.target_ms + 1 >= r.target_ms);
+    host_trace_free(&t);
+}
+
+static void test_settle(void)
+{
+    host_trace_t t, calm;
+    host_trace_model_t m = model(10.0);
+    m.burst_packets = 4;
+    host_trace_generate(&t, &m);
+    host_trace_generate(&calm, &(host_trace_model_t) {
+        .sample_rate = RATE, .packet_bytes = PACKET_BYTES, .seconds = 60.0
+    });
+    host_trace_append(&t, &calm);
+
+    replay_result_t burst = replay(&t, 0, 10000000);
+    replay_result_t soon = replay(&t, 0, 12000000);
+    replay_result_t later = replay(&t, 0, 0);
+    printf("settle:      %lu ms after bursts, %lu ms 2 s later, %lu ms after 60 s calm\n",
+           (unsigned long)burst.target_ms, (unsigned long)soon.target_ms,
+           (unsigned long)later.target_ms);
+    CHECK(soon.target_ms == burst.target_ms);       /* Window still remembers */
+    CHECK(later.target_ms == JB_TARGET_MIN_MS);
+    host_trace_free(&t);
+    host_trace_free(&calm);
+}
+
+static void test_gaps(void)
+{
+    /* 300 ms stalls: lateness beyond the upper bound is clamped to it */
+    host_trace_t t;
+    host_trace_model_t m = model(10.0);
+    m.gap_every_ms = 3000;
+    m.gap_ms = 300;
+    host_trace_generate(&t, &m);
+    replay_result_t r = replay(&t, 0, 0);
+    printf("stalls:      target %lu ms, jitter %lu us\n", (unsigned long)r.target_ms,
+           (unsigned long)r.jitter_us);
+    CHECK(r.jitter_us > 250000);
+    CHECK(r.target_ms == JB_TARGET_MAX_MS);
+    host_trace_free(&t);
+
+    /* A 1 s silence is a pause, not lateness */
+    m.gap_ms = 1000;
+    host_trace_generate(&t, &m);
+    r = replay(&t, 0, 0);
+    printf("pauses:      target %lu ms, jitter %lu us\n", (unsigned long)r.target_ms,
+           (unsigned long)r.jitter_us);
+    CHECK(r.max_target_ms == JB_TARGET_DEFAULT_MS);
+    host_trace_free(&t);
+}
+
+static void test_bounds(void)
+{
+    /* Low-latency bounds re-derive from what was measured, at once */
+    host_trace_t t;
+    host_trace_model_t m = model(10.0);
+    m.burst_packets = 4;
+    host_trace_generate(&t, &m);
+    replay(&t, 0, 0);
+
+    jitter_buffer_set_bounds(10, 25, 60);
+    jitter_buffer_on_packet(t.packets[t.count - 1].arrival_us + PACKET_US, PACKET_BYTES);
+    CHECK(jitter_buffer_get_target_ms() == 60);
+    jitter_buffer_set_bounds(JB_TARGET_MIN_MS, JB_TARGET_DEFAULT_MS, JB_TARGET_MAX_MS);
+    host_trace_free(&t);
+}
+
+static void test_load(void)
+{
+    /* Two captures in a monitor log, with unrelated lines around them */
+    const char *path = "jitter_buffer_trace.log";
+    FILE *f = fopen(path, "w");
+    CHECK(f != NULL);
+    if (f == NULL) {
+        return;
+    }
+    fprintf(f, "I (1234) AUDIO_PIPE: Pre-buffer filled\n"
+               "A2DPTRACE,BEGIN,44100,3\n"
+               "A2DPTRACE,0,0,4096\n"
+               "A2DPTRACE,1,23187,4096\n"
+               "A2DPTRACE,2,46500,4096\n"
+               "A2DPTRACE,END\n"
+               "A2DPTRACE,BEGIN,48000,2\n"
+               "A2DPTRACE,0,0,3840\n"
+               "A2DPTRACE,1,20000,3840\n"
+               "A2DPTRACE,END\n");
+    fclose(f);
+
+    host_trace_t t;
+    CHECK(host_trace_load(&t, path) == 0);
+    CHECK(t.count == 5);
+    CHECK(t.sample_rate == 48000);
+    CHECK(t.packets[1].arrival_us == 23187);
+    CHECK(t.packets[3].arrival_us == 46500 + PACKET_US);     /* Joined one packet later */
+    CHECK(t.packets[4].len == 3840);
+    host_trace_free(&t);
+    remove(path);
+}
+
+int main(int argc, char **argv)
+{
+    test_load();
+    test_steady();
+    test_bursty();
+    test_settle();
+    test_gaps();
+    test_bounds();
+
+    for (int i = 1; i < argc; i++) {
+        host_trace_t t;
+        if (host_trace_load(&t, argv[i]) != 0) {
+            fprintf(stderr, "%s: no A2DPTRACE packets\n", argv[i]);
+            host_test_failures++;
+            continue;
+        }
+        printf("%s: %zu packets @ %lu Hz\n", argv[i], t.count, (unsigned long)t.sample_rate);
+        replay_result_t r = replay(&t, 1000000, 0);
+        printf("  end: target %lu ms (max %lu), jitter %lu us\n", (unsigned long)r.target_ms,
+               (unsigned long)r.max_target_ms, (unsigned long)r.jitter_us);
+        host_trace_free(&t);
+    }
+
+    return host_test_result("jitter_buffer");
+}